@@ -0,0 +1,57 @@
+#include <base/logging/sinks/binary.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+int main(int argc, char* argv[])
+{
+	bool printTimestamps = false;
+	const char* path = nullptr;
+	bool validArguments = true;
+	for (int index = 1; index < argc; ++index)
+	{
+		if (strcmp(argv[index], "-t") == 0)
+			printTimestamps = true;
+		else if (path == nullptr)
+			path = argv[index];
+		else
+			validArguments = false;
+	}
+	if (path == nullptr || !validArguments)
+	{
+		fprintf(stderr, "Usage: %s [-t] file\n  -t  prefix messages with UTC timestamp and thread id\n", argv[0]);
+		return -1;
+	}
+
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		fprintf(stderr, "Failed to open %s\n", path);
+		return -1;
+	}
+	std::stringstream content;
+	content << file.rdbuf();
+	const std::string data = content.str();
+
+	if (data.size() < sizeof(Base::Logging::Details::binaryLogMagic) ||
+		memcmp(data.data(), Base::Logging::Details::binaryLogMagic, sizeof(Base::Logging::Details::binaryLogMagic)) != 0)
+	{
+		fprintf(stderr, "%s is not a binary log file\n", path);
+		return -2;
+	}
+	const bool decoded = Base::Logging::decodeBinaryLog(data, printTimestamps, [](std::string_view line)
+	{
+		fwrite(line.data(), 1, line.size(), stdout);
+		fputc('\n', stdout);
+	});
+	if (!decoded)
+	{
+		fprintf(stderr, "%s is truncated or corrupted\n", path);
+		return -3;
+	}
+	return 0;
+}
@@ -0,0 +1,69 @@
+#include <base/ext/img_codecs/processing/scaler.h>
+#include <base/ext/img_codecs/thread_pool.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+namespace
+{
+	// best of several runs, the first one also warms up the buffers
+	double measure(const std::function<void()>& function, int numberOfRuns)
+	{
+		double best = 0;
+		for (int run = 0; run < numberOfRuns; ++run)
+		{
+			const auto begin = std::chrono::steady_clock::now();
+			function();
+			const double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+			best = run == 0 ? time : std::min(best, time);
+		}
+		return best;
+	}
+}
+
+// Times ImageScaler on a 3840x2160 RGBA to 2560x1440 BGR24 flipped resize with and without a thread pool,
+// and checks the parallel results against the single-threaded one.
+int main(int argc, char* argv[])
+{
+	int numberOfRuns = 5;
+	if (argc > 2 || (argc == 2 && (numberOfRuns = atoi(argv[1])) <= 0))
+	{
+		fprintf(stderr, "Usage: %s [runs]\n  runs  number of runs of which the fastest is reported, 5 by default\n", argv[0]);
+		return -1;
+	}
+
+	const unsigned width = 3840, height = 2160, scaledWidth = 2560, scaledHeight = 1440;
+	std::vector<uint8_t> image(width * height * 4);
+	for (size_t index = 0; index < image.size(); ++index)
+		image[index] = (uint8_t)(index * 7 / 3 + index % 5 * 40);
+	const Base::ScalerImage source = Base::getScalerImage(Base::ScalerPixelFormat::RGBA, width, height, image.data());
+	for (Base::ImageResizeMethod method : { Base::ImageResizeMethod::BILINEAR, Base::ImageResizeMethod::AREA })
+	{
+		Base::ImageScaler scaler;
+		scaler.setResizeMethod(method);
+		std::vector<uint8_t> reference(scaledWidth * scaledHeight * 3);
+		const Base::ScalerImage referenceImage = Base::getScalerImage(Base::ScalerPixelFormat::BGR24, scaledWidth, scaledHeight, reference.data());
+		printf("%s, 1 thread: %.2fms", method == Base::ImageResizeMethod::AREA ? "area" : "bilinear",
+			measure([&]() { scaler.scale(source, referenceImage, true); }, numberOfRuns));
+		for (unsigned numberOfThreads : { 2, 4, 8 })
+		{
+			Base::WorkStealingThreadPool threadPool(numberOfThreads);
+			std::vector<uint8_t> output(reference.size());
+			const Base::ScalerImage outputImage = Base::getScalerImage(Base::ScalerPixelFormat::BGR24, scaledWidth, scaledHeight, output.data());
+			printf(", %u threads: %.2fms", numberOfThreads,
+				measure([&]() { scaler.scale(source, outputImage, true, threadPool); }, numberOfRuns));
+			if (output != reference)
+			{
+				fprintf(stderr, "\nThe output of %u threads differs from the single-threaded one\n", numberOfThreads);
+				return -2;
+			}
+		}
+		printf("\n");
+	}
+	return 0;
+}
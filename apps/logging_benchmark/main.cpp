@@ -0,0 +1,149 @@
+#include <base/logging.h>
+#include <base/logging/sinks/binary.h>
+#include <base/logging/sinks/file.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <sstream>
+#include <string>
+
+namespace
+{
+	class NullSink : public Base::Logging::Sink
+	{
+	public:
+		std::string_view getName() override { return "null"; }
+		void write(std::string_view message) override { size += message.size(); }
+		void flush() override {}
+		size_t size = 0;
+	};
+
+	// the previous FileSink implementation, one fwrite per call
+	class FWriteFileSink : public Base::Logging::Sink
+	{
+	public:
+		FWriteFileSink(const std::string& path) : _file(fopen(path.c_str(), "w")) {}
+		std::string_view getName() override { return "fwrite"; }
+		void write(std::string_view message) override { fwrite(message.data(), 1, message.size(), _file); }
+		void flush() override { fflush(_file); }
+		~FWriteFileSink() override { fclose(_file); }
+	private:
+		FILE* _file;
+	};
+
+	// best of several runs, the first one also warms up the buffers
+	double measure(const std::function<void()>& function, int numberOfRuns)
+	{
+		double best = 0;
+		for (int run = 0; run < numberOfRuns; ++run)
+		{
+			const auto begin = std::chrono::steady_clock::now();
+			function();
+			const double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+			best = run == 0 ? time : std::min(best, time);
+		}
+		return best;
+	}
+
+	void benchmarkFormatting(int numberOfRuns)
+	{
+		const int iterations = 200000;
+		const int handle = Base::Logging::addSink(new NullSink);
+		printf("formatting %d messages, std::stringstream: %.2fms", iterations, measure([]()
+		{
+			for (int i = 0; i < iterations; ++i)
+			{
+				std::stringstream stream;
+				stream << Base::Logging::Details::generateHeader(__FILE__, __LINE__, __func__) << "iteration " << i << " of " << iterations << ", ratio " << double(i) / iterations;
+				Base::Logging::log(stream.str());
+			}
+		}, numberOfRuns));
+		printf(", LoggingStream: %.2fms", measure([]()
+		{
+			for (int i = 0; i < iterations; ++i)
+			{
+				L_LOG_ERROR << "iteration " << i << " of " << iterations << ", ratio " << double(i) / iterations;
+			}
+		}, numberOfRuns));
+		printf(", filtered: %.2fms\n", measure([]()
+		{
+			for (int i = 0; i < iterations; ++i)
+			{
+				L_LOG_DEBUG << "iteration " << i << " of " << iterations << ", ratio " << double(i) / iterations;
+			}
+		}, numberOfRuns));
+		Base::Logging::removeSink(handle);
+	}
+
+	// writes lines of 120 characters the way the dispatcher does, message and newline separately
+	void writeLines(Base::Logging::Sink& sink, int numberOfLines)
+	{
+		const std::string message(120, 'x');
+		for (int i = 0; i < numberOfLines; ++i)
+		{
+			sink.write(message);
+			sink.write("\n");
+		}
+		sink.flush();
+	}
+
+	void benchmarkFileSink(int numberOfRuns)
+	{
+		const int numberOfLines = 1000000;
+		const std::string path = (std::filesystem::temp_directory_path() / "base_logging_benchmark.log").string();
+		const double size = numberOfLines * 121.0 / (1024 * 1024);
+		printf("writing %.0fMB, fwrite: %.0fMB/s", size, size * 1000 / measure([&]()
+		{
+			FWriteFileSink sink(path);
+			writeLines(sink, numberOfLines);
+		}, numberOfRuns));
+		printf(", FileSink: %.0fMB/s\n", size * 1000 / measure([&]()
+		{
+			Base::Logging::FileSink sink(path);
+			writeLines(sink, numberOfLines);
+		}, numberOfRuns));
+		std::filesystem::remove(path);
+	}
+
+	void benchmarkBinaryFileSink(int numberOfRuns)
+	{
+		const int iterations = 1000000;
+		const std::string path = (std::filesystem::temp_directory_path() / "base_logging_binary_benchmark.log").string();
+		auto logMessages = [&path](bool binary)
+		{
+			const int handle = Base::Logging::addSink(binary ? new Base::Logging::BinaryFileSink(path) : new Base::Logging::FileSink(path));
+			for (int i = 0; i < iterations; ++i)
+			{
+				L_LOG_ERROR << "iteration " << i << " of " << iterations << ", ratio " << double(i) / iterations;
+			}
+			Base::Logging::removeSink(handle);
+		};
+		printf("logging %d messages, FileSink: %.2fms", iterations, measure([&]() { logMessages(false); }, numberOfRuns));
+		const auto fileSinkSize = std::filesystem::file_size(path);
+		printf(" %llu bytes, BinaryFileSink: %.2fms", (unsigned long long)fileSinkSize, measure([&]() { logMessages(true); }, numberOfRuns));
+		printf(" %llu bytes\n", (unsigned long long)std::filesystem::file_size(path));
+		std::filesystem::remove(path);
+	}
+}
+
+// Times the logging macros against formatting with std::stringstream, and messages below the logging level,
+// the throughput of FileSink against one fwrite per message and logging to FileSink against BinaryFileSink,
+// the files are written to the temporary directory
+int main(int argc, char* argv[])
+{
+	int numberOfRuns = 5;
+	if (argc > 2 || (argc == 2 && (numberOfRuns = atoi(argv[1])) <= 0))
+	{
+		fprintf(stderr, "Usage: %s [runs]\n  runs  number of runs of which the fastest is reported, 5 by default\n", argv[0]);
+		return -1;
+	}
+
+	benchmarkFormatting(numberOfRuns);
+	benchmarkFileSink(numberOfRuns);
+	benchmarkBinaryFileSink(numberOfRuns);
+	return 0;
+}
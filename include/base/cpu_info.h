@@ -7,5 +7,9 @@ namespace Base
 	ATTRIBUTE_INTERFACE
 	bool hasAVX();
 	ATTRIBUTE_INTERFACE
+	bool hasAVX2();
+	ATTRIBUTE_INTERFACE
+	bool hasF16C();
+	ATTRIBUTE_INTERFACE
 	bool hasAVX512f();
 }
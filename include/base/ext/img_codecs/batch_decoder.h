@@ -0,0 +1,65 @@
+#pragma once
+
+#include <base/ext/img_codecs/decoder.h>
+#include <base/ext/img_codecs/thread_pool.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Base
+{
+	struct ImageDecodeJob
+	{
+		const void* buffer;
+		size_t size;
+		// ImageFormatType::UNKNOWN detects the format of every image
+		ImageFormatType format;
+		// pixels in the output format of the decoder, the job fails if the image does not fit into outputSize bytes
+		void* output;
+		uint64_t outputSize;
+		// passed to ImageDecoder::setTargetSize unless zero
+		unsigned targetWidth = 0;
+		unsigned targetHeight = 0;
+	};
+
+	struct ImageDecodeResult
+	{
+		bool succeeded;
+		unsigned width;
+		unsigned height;
+		size_t rowStride;
+		// reason of the failure, empty on success
+		std::string error;
+	};
+
+	struct IMAGE_CODECS_INTERFACE BatchImageDecodeStatistics
+	{
+		size_t numberOfImages;
+		size_t numberOfFailures;
+		uint64_t compressedBytes;
+		uint64_t decompressedBytes;
+		double seconds;
+
+		[[nodiscard]] double getImagesPerSecond() const;
+	};
+
+	// Decodes a batch of images on a work-stealing thread pool, every worker reuses its own ImageDecoder.
+	// A failing image is reported in its result and does not stop the rest of the batch.
+	class IMAGE_CODECS_INTERFACE BatchImageDecoder
+	{
+	public:
+		// 0 uses one worker per hardware thread
+		explicit BatchImageDecoder(unsigned numberOfThreads = 0);
+		BatchImageDecoder(const BatchImageDecoder&) = delete;
+		[[nodiscard]] unsigned getNumberOfThreads() const;
+		// see ImageDecoder::setOutputFormat
+		void setOutputFormat(PixelFormat format, unsigned rowAlignment = 1);
+		// results must hold numberOfJobs entries
+		BatchImageDecodeStatistics decode(const ImageDecodeJob* jobs, size_t numberOfJobs, ImageDecodeResult* results);
+		BatchImageDecodeStatistics decode(const std::vector<ImageDecodeJob>& jobs, std::vector<ImageDecodeResult>& results);
+	private:
+		WorkStealingThreadPool _threadPool;
+		std::vector<ImageDecoder> _decoders;
+	};
+}
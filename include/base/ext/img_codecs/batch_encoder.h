@@ -0,0 +1,66 @@
+#pragma once
+
+#ifdef HAVE_LIB_JPEG
+
+#include <base/ext/img_codecs/encoder/jpeg.h>
+#include <base/ext/img_codecs/object_pool.h>
+#include <base/ext/img_codecs/thread_pool.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Base
+{
+	struct JPEGEncodeJob
+	{
+		// packed RGB rows
+		const void* rgb;
+		unsigned width;
+		unsigned height;
+		// the job fails if the image does not fit into outputSize bytes, JPEGEncoder::getMaximumEncodedSize always fits
+		void* output;
+		size_t outputSize;
+	};
+
+	struct JPEGEncodeResult
+	{
+		bool succeeded;
+		// bytes of the encoded image
+		size_t size;
+		// reason of the failure, empty on success
+		std::string error;
+	};
+
+	struct IMAGE_CODECS_INTERFACE BatchJPEGEncodeStatistics
+	{
+		size_t numberOfImages;
+		size_t numberOfFailures;
+		uint64_t uncompressedBytes;
+		uint64_t compressedBytes;
+		double seconds;
+
+		[[nodiscard]] double getImagesPerSecond() const;
+	};
+
+	// Encodes a batch of images on a work-stealing thread pool with JPEGEncoders taken from a pool, so their
+	// jpeg_compress_structs are reused across batches. A failing image does not stop the rest of the batch.
+	class IMAGE_CODECS_INTERFACE BatchJPEGEncoder
+	{
+	public:
+		// 0 uses one worker per hardware thread
+		explicit BatchJPEGEncoder(unsigned numberOfThreads = 0);
+		BatchJPEGEncoder(const BatchJPEGEncoder&) = delete;
+		[[nodiscard]] unsigned getNumberOfThreads() const;
+		// Applies to the following batches
+		void setOptions(const JPEGEncodeOptions& options);
+		// results must hold numberOfJobs entries
+		BatchJPEGEncodeStatistics encode(const JPEGEncodeJob* jobs, size_t numberOfJobs, JPEGEncodeResult* results);
+		BatchJPEGEncodeStatistics encode(const std::vector<JPEGEncodeJob>& jobs, std::vector<JPEGEncodeResult>& results);
+	private:
+		WorkStealingThreadPool _threadPool;
+		ObjectPool<JPEGEncoder> _encoders;
+		JPEGEncodeOptions _options;
+	};
+}
+#endif
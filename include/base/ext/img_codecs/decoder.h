@@ -1,32 +1,94 @@
 #pragma once
 
 #include <stddef.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
+#include <base/ext/img_codecs/decoder/backend.h>
 #include <base/ext/img_codecs/decoder/jpeg.h>
 #include <base/ext/img_codecs/decoder/png.h>
 #include <base/ext/img_codecs/decoder/webp.h>
+#include <base/ext/img_codecs/format_detection.h>
+#include <base/ext/img_codecs/pixel_format.h>
+#include <base/ext/img_codecs/processing/tensor.h>
 #include <base/ext/img_codecs/types.h>
 
 namespace Base
 {
+    // Decodes images with the backends of ImageDecoderBackendRegistry, by default the one of the highest priority
+    // registered for the format. Backend instances are kept for the following images until their registration
+    // is replaced.
     class IMAGE_CODECS_INTERFACE ImageDecoder
     {
     public:
+        ImageDecoder();
+        // Decodes format with the backend registered as name from the next load on, an empty name restores
+        // the choice by selector or priority
+        void setBackend(ImageFormatType format, const std::string &name);
+        // Picks the backend for formats without one set by name
+        void setBackendSelector(ImageDecoderBackendSelector selector);
+        // Unloads the image and restores the options and backend choice of a new decoder, the backend
+        // instances are kept. Called by ObjectPool before the decoder is reused.
+        void reset();
+        // of the loaded image
+		[[nodiscard]] const ImageDecoderBackendInfo &getBackendInfo() const;
         void load(const void *buffer, size_t size, ImageFormatType formatType);
+        // detects the format from the signature of the image
+        void load(const void *buffer, size_t size);
+		[[nodiscard]] ImageFormatType getFormat() const;
+        // Applied to the loaded image by the decode calls, NORMAL unless ImageDecodeOptions::applyOrientation is set.
+        // The sizes, row stride and regions are the ones of the upright image.
+		[[nodiscard]] ImageOrientation getOrientation() const;
+        // Lets formats supporting it decode at a reduced size which is still at least width x height,
+        // must be called after load. Other formats keep decoding at full size.
+        void setTargetSize(unsigned width, unsigned height);
 		[[nodiscard]] unsigned getHeight() const;
 		[[nodiscard]] unsigned getWidth() const;
 		[[nodiscard]] uint64_t getDecompressedSize() const;
+        // Applies to the images loaded afterwards, rows are padded to a multiple of rowAlignment bytes
+        void setOutputFormat(PixelFormat format, unsigned rowAlignment = 1);
+        // Applies to the images loaded afterwards
+        void setOptions(const ImageDecodeOptions &options);
+		[[nodiscard]] const ImageDecodeOptions &getOptions() const;
+		[[nodiscard]] PixelFormat getOutputFormat() const;
+        // 2 for PNG images whose 16-bit samples are preserved, 1 otherwise
+		[[nodiscard]] unsigned getBytesPerChannel() const;
+		[[nodiscard]] size_t getRowStride() const;
         void decode(void *output);
+        // Decodes the width x height rectangle at (x, y) in the output format, the row stride is computed from
+        // the region width. Backends capable of region decoding (JPEG, WebP) skip the parts outside of the region,
+        // the others decode the whole image into an internal buffer first.
+        void decodeRegion(unsigned x, unsigned y, unsigned width, unsigned height, void *output);
+        // Resizes and normalizes the image into the tensor of converter while decoding. Rows of backends capable
+        // of row decoding (JPEG, PNG, WebP) are converted as they are passed, other images are decoded into an internal
+        // buffer first.
+        // The output format has to be a packed one with 8-bit samples.
+        void decode(ImageTensorConverter &converter, void *tensor);
+        // Decodes the image into YUV 4:2:0 planes of getWidth() x getHeight() pixels, e.g. for a video encoder.
+        // Only backends capable of YUV output (WebP) support it.
+        void decodeYUV420(const YUV420Planes &planes);
     private:
-#if (defined HAVE_LIB_JPEG) || (defined HAVE_LIB_JPEG_TURBO)
-        JPEGDecoder _jpegDecoder;
-#endif
-#if (defined HAVE_LIB_PNG)
-        PNGDecoder _pngDecoder;
-#endif
-#if (defined HAVE_LIB_WEBP)
-        WebPDecoder _webpDecoder;
-#endif
+        ImageDecoderBackend &getBackend() const;
+        [[nodiscard]] bool isTransposed() const;
+        void decodeOriented(void *output);
+        // in the coordinates of the stored image
+        void decodeStoredRegion(unsigned x, unsigned y, unsigned width, unsigned height, void *output);
+
+        std::map<ImageFormatType, std::string> _backendNames;
+        ImageDecoderBackendSelector _backendSelector;
+        // the registration an instance was created by, one instance per backend name
+        std::vector<std::pair<std::shared_ptr<const ImageDecoderBackendInfo>, std::unique_ptr<ImageDecoderBackend>>> _backends;
+        // of the loaded image
+        std::shared_ptr<const ImageDecoderBackendInfo> _backendInfo;
+        ImageDecoderBackend *_backend;
         ImageFormatType _format;
+        ImageOrientation _orientation;
+        ImageDecodeOptions _options;
+        std::vector<unsigned char> _regionBuffer;
+        // stored image or region before orienting it
+        std::vector<unsigned char> _orientationBuffer;
     };
 }
\ No newline at end of file
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <base/ext/img_codecs/common.h>
+#include <base/ext/img_codecs/types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Base
+{
+	struct ImageDecoderCapabilities
+	{
+		// decodes at a reduced size with setTargetSize
+		bool scaling = false;
+		// decodeRegion skips parts of the image outside of the region
+		bool regionDecoding = false;
+		// decodeRows passes packed rows, as they are decompressed when streamingRows is set
+		bool rowDecoding = false;
+		bool streamingRows = false;
+		// decodeYUV420 writes YUV 4:2:0 planes
+		bool yuv420Output = false;
+		// decodes on a GPU or another device
+		bool hardwareAccelerated = false;
+		std::vector<PixelFormat> outputFormats;
+	};
+
+	// Decodes one image format for ImageDecoder. The built-in backends wrap the decoder classes of the
+	// codec libraries, others can be added through ImageDecoderBackendRegistry.
+	class IMAGE_CODECS_INTERFACE ImageDecoderBackend
+	{
+	public:
+		virtual ~ImageDecoderBackend() = default;
+		// Applies to the images loaded afterwards
+		virtual void setOptions(const ImageDecodeOptions& options) = 0;
+		virtual void load(const void* image, uint64_t size) = 0;
+		// called only on backends capable of scaling
+		virtual void setTargetSize(unsigned width, unsigned height);
+		[[nodiscard]] virtual unsigned getWidth() const = 0;
+		[[nodiscard]] virtual unsigned getHeight() const = 0;
+		[[nodiscard]] virtual uint64_t getDecompressedSize() const = 0;
+		[[nodiscard]] virtual PixelFormat getOutputFormat() const = 0;
+		[[nodiscard]] virtual unsigned getBytesPerChannel() const;
+		[[nodiscard]] virtual size_t getRowStride() const = 0;
+		virtual void decode(void* buffer) = 0;
+		// called only on backends capable of region decoding
+		virtual void decodeRegion(unsigned x, unsigned y, unsigned width, unsigned height, void* buffer);
+		// called only on backends capable of row decoding
+		virtual void decodeRows(const std::function<void(const unsigned char*)>& function);
+		// called only on backends capable of YUV output
+		virtual void decodeYUV420(const YUV420Planes& planes);
+	};
+
+	struct ImageDecoderBackendInfo
+	{
+		std::string name;
+		ImageFormatType format;
+		ImageDecoderCapabilities capabilities;
+		// backends of higher priority are preferred unless a selector or name picks another one
+		int priority;
+		std::function<std::unique_ptr<ImageDecoderBackend>()> factory;
+	};
+
+	typedef std::vector<std::shared_ptr<const ImageDecoderBackendInfo>> ImageDecoderBackendList;
+
+	// Returns the index of the candidate to decode the image with, the candidates are the backends
+	// registered for format with the highest priority first
+	typedef std::function<size_t(ImageFormatType format, const void* image, uint64_t size,
+		const ImageDecoderBackendList& candidates)> ImageDecoderBackendSelector;
+
+	// The image decoder backends available at runtime, the ones compiled in are registered from the start:
+	// "turbojpeg" and "libjpeg" for JPEG, "libpng" for PNG and "libwebp" for WebP
+	class IMAGE_CODECS_INTERFACE ImageDecoderBackendRegistry
+	{
+	public:
+		static ImageDecoderBackendRegistry& getInstance();
+		// replaces the backend of the same name
+		void registerBackend(ImageDecoderBackendInfo info);
+		void unregisterBackend(const std::string& name);
+		// Highest priority first. The list is sorted when backends are registered, later changes
+		// of the registry replace it instead of modifying it.
+		[[nodiscard]] std::shared_ptr<const ImageDecoderBackendList> getBackends(ImageFormatType format) const;
+		// nullptr if no backend of name is registered
+		[[nodiscard]] std::shared_ptr<const ImageDecoderBackendInfo> getBackend(const std::string& name) const;
+	private:
+		struct Snapshot
+		{
+			// in the order of registration
+			ImageDecoderBackendList backends;
+			ImageDecoderBackendList backendsOfFormat[size_t(ImageFormatType::UNKNOWN) + 1];
+		};
+
+		ImageDecoderBackendRegistry();
+		// called with _mutex held
+		void publish(ImageDecoderBackendList backends);
+
+		// serializes the changes, readers only load _snapshot
+		std::mutex _mutex;
+		// accessed with std::atomic_load and std::atomic_store
+		std::shared_ptr<const Snapshot> _snapshot;
+	};
+}
@@ -1,31 +1,55 @@
 #pragma once
 
 #include <base/ext/img_codecs/common.h>
+#include <base/ext/img_codecs/types.h>
 
 #ifdef HAVE_LIB_JPEG_TURBO
 #include <turbojpeg.h>
+#include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <vector>
 namespace Base {
-	class IMAGE_CODECS_INTERFACE JPEGDecoder {
+	class IMAGE_CODECS_INTERFACE TurboJPEGDecoder {
 	public:
-		JPEGDecoder();
-		JPEGDecoder(const JPEGDecoder&) = delete;
-		JPEGDecoder(JPEGDecoder&& object) noexcept;
-		~JPEGDecoder();
+		TurboJPEGDecoder();
+		TurboJPEGDecoder(const TurboJPEGDecoder&) = delete;
+		TurboJPEGDecoder(TurboJPEGDecoder&& object) noexcept;
+		~TurboJPEGDecoder();
 		void load(const void* pointer, uint64_t size);
-		int getWidth();
-		int getHeight();
-		int getDecompressedSize();
+		// Decodes at the smallest supported scaling factor whose output is still at least width x height,
+		// reset by load. The getters return the scaled size.
+		void setTargetSize(unsigned width, unsigned height);
+		[[nodiscard]] unsigned getWidth() const;
+		[[nodiscard]] unsigned getHeight() const;
+		[[nodiscard]] uint64_t getDecompressedSize() const;
+		// Applies to the following decode calls, rows are padded to a multiple of rowAlignment bytes
+		void setOutputFormat(PixelFormat format, unsigned rowAlignment = 1);
+		[[nodiscard]] PixelFormat getOutputFormat() const;
+		[[nodiscard]] size_t getRowStride() const;
 		void decode(void* buffer);
+		// Decodes the width x height rectangle at (x, y) of the (scaled) image in the output format,
+		// the row stride is computed from the region width.
+		// Unscaled images are losslessly cropped to the covering MCUs before decompression.
+		void decodeRegion(unsigned x, unsigned y, unsigned width, unsigned height, void* buffer);
+		// Passes the rows of the image in the packed output format to function, top to bottom.
+		// The image is decompressed into an internal buffer first.
+		void decodeRows(const std::function<void(const unsigned char*)>& function);
 	private:
 		const unsigned char* _pointer;
 		unsigned long _fileSize;
 		tjhandle _handle;
+		tjhandle _transformHandle;
+		std::vector<unsigned char> _regionBuffer;
 		int _width, _height;
+		int _scaledWidth, _scaledHeight;
 		int _jpegSubsamp, _jpegColorspace;
+		PixelFormat _outputFormat;
+		unsigned _rowAlignment;
 	};
 }
-#elif defined HAVE_LIB_JPEG
+#endif
+#ifdef HAVE_LIB_JPEG
 #ifdef _WIN32
 #define NOMINMAX
 #define WIN32_LEAN_AND_MEAN
@@ -44,26 +68,48 @@ namespace Base {
 #elif defined __GNUC__
 #pragma GCC diagnostic pop
 #endif
+#include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <vector>
 
 namespace Base
 {
-	class IMAGE_CODECS_INTERFACE JPEGDecoder
+	class IMAGE_CODECS_INTERFACE LibJPEGDecoder
 	{
 	public:
-		JPEGDecoder();
-		JPEGDecoder(const JPEGDecoder&) = delete;
-		JPEGDecoder(JPEGDecoder&& object) noexcept;
-		~JPEGDecoder();
+		LibJPEGDecoder();
+		LibJPEGDecoder(const LibJPEGDecoder&) = delete;
+		LibJPEGDecoder(LibJPEGDecoder&& object) noexcept;
+		~LibJPEGDecoder();
 		void load(const void* pointer, uint64_t size);
+		// Decodes at the smallest DCT scaling factor (n/8) whose output is still at least width x height,
+		// reset by load. The getters return the scaled size.
+		void setTargetSize(unsigned width, unsigned height);
 		[[nodiscard]] unsigned getWidth() const;
 		[[nodiscard]] unsigned getHeight() const;
 		[[nodiscard]] uint64_t getDecompressedSize() const;
+		// Applies to the following decode calls, rows are padded to a multiple of rowAlignment bytes
+		void setOutputFormat(PixelFormat format, unsigned rowAlignment = 1);
+		[[nodiscard]] PixelFormat getOutputFormat() const;
+		[[nodiscard]] size_t getRowStride() const;
 		void decode(void* buffer);
+		// Decodes the width x height rectangle at (x, y) of the (scaled) image in the output format,
+		// the row stride is computed from the region width.
+		// With libjpeg-turbo only the iMCU rows and columns covering it are decompressed.
+		void decodeRegion(unsigned x, unsigned y, unsigned width, unsigned height, void* buffer);
+		// Passes the rows of the image in the packed output format to function, top to bottom,
+		// as they are decompressed.
+		void decodeRows(const std::function<void(const unsigned char*)>& function);
 		void close();
 	private:
 		const unsigned char* _pointer;
 		unsigned long _fileSize;
+		std::vector<unsigned char> _rowBuffer;
+		// the (scaled) output size, decInfo.output_width is narrowed by cropped region decodes
+		unsigned _width, _height;
+		PixelFormat _outputFormat;
+		unsigned _rowAlignment;
 
 		jpeg_decompress_struct decInfo;
 		struct jpeg_error_mgr jerr;
@@ -78,6 +124,16 @@ namespace Base
 }
 #endif
 
+namespace Base
+{
+	// TurboJPEG when both libraries are available
+#ifdef HAVE_LIB_JPEG_TURBO
+	typedef TurboJPEGDecoder JPEGDecoder;
+#elif defined HAVE_LIB_JPEG
+	typedef LibJPEGDecoder JPEGDecoder;
+#endif
+}
+
 #ifdef HAVE_INTEL_MEDIA_SDK
 #include <base/memory_alignment.h>
 
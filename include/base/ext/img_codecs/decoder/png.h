@@ -3,9 +3,12 @@
 #ifdef HAVE_LIB_PNG
 
 #include <base/ext/img_codecs/common.h>
+#include <base/ext/img_codecs/types.h>
 #include <png.h>
 #include <vector>
+#include <cstddef>
 #include <cstdint>
+#include <functional>
 
 namespace Base
 {	
@@ -20,14 +23,93 @@ namespace Base
 		[[nodiscard]] unsigned getWidth() const;
 		[[nodiscard]] unsigned getHeight() const;
 		[[nodiscard]] uint64_t getDecompressedSize() const;
+		// Applies to the images loaded afterwards, rows are padded to a multiple of rowAlignment bytes.
+		// 16-bit samples are reduced to 8 bits unless preserve16Bit is set in the options.
+		void setOutputFormat(PixelFormat format, unsigned rowAlignment = 1);
+		// Applies to the images loaded afterwards
+		void setOptions(const ImageDecodeOptions& options);
+		[[nodiscard]] const ImageDecodeOptions& getOptions() const;
+		[[nodiscard]] PixelFormat getOutputFormat() const;
+		// 2 when the 16-bit samples of the loaded image are preserved, 1 otherwise
+		[[nodiscard]] unsigned getBytesPerChannel() const;
+		[[nodiscard]] size_t getRowStride() const;
 		void decode(void* buffer);
+		// Passes the rows of the image in the packed output format to function, top to bottom.
+		// Interlaced images are complete after the last pass only and are read into an internal buffer first.
+		void decodeRows(const std::function<void(const unsigned char*)>& function);
 	private:
+		static void infoCallback(png_structp png_ptr, png_infop info_ptr);
+		static void rowCallback(png_structp png_ptr, png_bytep new_row, png_uint_32 row_num, int pass);
+		static void endCallback(png_structp png_ptr, png_infop info_ptr);
+		// RGB_PLANAR images are passed as RGB rows
+		void readRows(const std::function<void(const unsigned char*)>& function);
+		void readImage();
+
 		unsigned char* _sourceImage;
+		unsigned char* _sourceImageEnd;
+		// first byte not yet processed by the progressive reader of libpng
 		unsigned char* _currentImagePosition;
 		png_structp _png_ptr;
 		png_infop _info_ptr;
 		unsigned long _image_width, _image_height;
-		::std::vector<png_bytep> _row_pointers;
+		// whole image of interlaced images in readRows
+		::std::vector<unsigned char> _rowBuffer;
+		ImageDecodeOptions _options;
+		// output format of the loaded image
+		PixelFormat _imageFormat;
+		unsigned _bytesPerChannel;
+		int _numberOfPasses;
+		// rows are either combined into _destination or passed to _rowFunction
+		unsigned char* _destination;
+		size_t _destinationRowStride;
+		const std::function<void(const unsigned char*)>* _rowFunction;
+		unsigned long _numberOfRows;
+		bool _isComplete;
+	};
+
+	// Decodes PNG images from chunks of input as they arrive, e.g. from a socket or a file read piecewise.
+	// Every row in the packed output format is passed to the row function as soon as it is decoded, so no
+	// image sized buffer is needed, except for interlaced images which are complete after the last pass only.
+	class IMAGE_CODECS_INTERFACE PNGStreamDecoder
+	{
+	public:
+		PNGStreamDecoder();
+		PNGStreamDecoder(const PNGStreamDecoder&) = delete;
+		~PNGStreamDecoder();
+		// Applies to the images started afterwards, planar formats are not supported
+		void setOutputFormat(PixelFormat format);
+		[[nodiscard]] PixelFormat getOutputFormat() const;
+		// function is called once the header is parsed, before the first row
+		void setHeaderFunction(std::function<void(unsigned width, unsigned height)> function);
+		// function gets the rows top to bottom, the data is valid during the call only
+		void setRowFunction(std::function<void(unsigned row, const unsigned char* data)> function);
+		// Discards the current image, the next data fed starts a new one
+		void reset();
+		void feed(const void* data, size_t size);
+		[[nodiscard]] bool isHeaderComplete() const;
+		[[nodiscard]] bool isComplete() const;
+		[[nodiscard]] unsigned getWidth() const;
+		[[nodiscard]] unsigned getHeight() const;
+	private:
+		static void infoCallback(png_structp png_ptr, png_infop info_ptr);
+		static void rowCallback(png_structp png_ptr, png_bytep new_row, png_uint_32 row_num, int pass);
+		static void endCallback(png_structp png_ptr, png_infop info_ptr);
+		void passRows(unsigned endRow);
+
+		png_structp _png_ptr;
+		png_infop _info_ptr;
+		std::function<void(unsigned, unsigned)> _headerFunction;
+		std::function<void(unsigned, const unsigned char*)> _rowFunction;
+		PixelFormat _outputFormat;
+		PixelFormat _imageFormat;
+		unsigned _width, _height;
+		size_t _rowSize;
+		int _numberOfPasses;
+		// whole image of interlaced images
+		std::vector<unsigned char> _interlacedImage;
+		unsigned _nextRow;
+		bool _isHeaderComplete;
+		bool _isComplete;
 	};
 }
 #endif
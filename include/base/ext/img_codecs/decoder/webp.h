@@ -3,22 +3,101 @@
 #ifdef HAVE_LIB_WEBP
 
 #include <base/ext/img_codecs/common.h>
+#include <base/ext/img_codecs/types.h>
+#include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <webp/decode.h>
 
 namespace Base
 {
 	class IMAGE_CODECS_INTERFACE WebPDecoder
 	{
 	public:
+		WebPDecoder();
+		WebPDecoder(const WebPDecoder&) = delete;
 		void load(const void* pointer, uint64_t size);
+		// Decodes at the smallest size of the aspect ratio of the image which is still at least width x height,
+		// reset by load. libwebp scales while decoding. The getters return the scaled size.
+		void setTargetSize(unsigned width, unsigned height);
 		[[nodiscard]] unsigned getWidth() const;
 		[[nodiscard]] unsigned getHeight() const;
 		[[nodiscard]] uint64_t getDecompressedSize() const;
+		// Applies to the following decode calls, rows are padded to a multiple of rowAlignment bytes
+		void setOutputFormat(PixelFormat format, unsigned rowAlignment = 1);
+		// Applies to the following decode calls, multiThreaded sets use_threads of libwebp
+		void setOptions(const ImageDecodeOptions& options);
+		[[nodiscard]] const ImageDecodeOptions& getOptions() const;
+		[[nodiscard]] PixelFormat getOutputFormat() const;
+		[[nodiscard]] size_t getRowStride() const;
 		void decode(void* buffer);
+		// Decodes the width x height rectangle at (x, y) of the (scaled) image in the output format,
+		// the row stride is computed from the region width.
+		// Unscaled images are cropped by libwebp, which decodes the rows and columns around the region only.
+		void decodeRegion(unsigned x, unsigned y, unsigned width, unsigned height, void* buffer);
+		// Passes the rows of the image in the packed output format to function, top to bottom.
+		// The image is decoded into an internal buffer first.
+		void decodeRows(const std::function<void(const unsigned char*)>& function);
+		// Decodes the (scaled) image into the YUV 4:2:0 planes, lossy images are stored as such and skip the RGB conversion
+		void decodeYUV420(const YUV420Planes& planes);
 	private:
-		int _width, _height;
+		void decodeImage(unsigned x, unsigned y, unsigned width, unsigned height, uint8_t* output, size_t rowStride);
+		void initConfig(WebPDecoderConfig& config) const;
+
+		// of the image
+		int _imageWidth, _imageHeight;
+		// after scaling
+		unsigned _width, _height;
 		const void* _pointer;
 		uint64_t _size;
+		ImageDecodeOptions _options;
+		// decoded rectangle before cropping or conversion to the output format
+		std::vector<uint8_t> _rowBuffer;
+		// whole image for decodeRows
+		std::vector<uint8_t> _image;
+	};
+
+	// Decodes WebP images from chunks of input as they arrive with the incremental decoder of libwebp.
+	// Rows in the packed output format are passed to the row function as soon as they are decoded.
+	class IMAGE_CODECS_INTERFACE WebPStreamDecoder
+	{
+	public:
+		WebPStreamDecoder();
+		WebPStreamDecoder(const WebPStreamDecoder&) = delete;
+		~WebPStreamDecoder();
+		// Applies to the images whose first data is fed afterwards, planar formats are not supported
+		void setOutputFormat(PixelFormat format);
+		// of the current image once data of it is fed, the format set otherwise
+		[[nodiscard]] PixelFormat getOutputFormat() const;
+		// function is called once the header is parsed, before the first row
+		void setHeaderFunction(std::function<void(unsigned width, unsigned height)> function);
+		// function gets the rows top to bottom, the data is valid during the call only
+		void setRowFunction(std::function<void(unsigned row, const unsigned char* data)> function);
+		// Discards the current image, the next data fed starts a new one
+		void reset();
+		// data is copied, it need not outlive the call
+		void feed(const void* data, size_t size);
+		[[nodiscard]] bool isHeaderComplete() const;
+		[[nodiscard]] bool isComplete() const;
+		[[nodiscard]] unsigned getWidth() const;
+		[[nodiscard]] unsigned getHeight() const;
+	private:
+		void passRows(unsigned endRow, const uint8_t* image, size_t rowStride);
+
+		// null until the first data of an image is fed
+		WebPIDecoder* _decoder;
+		std::function<void(unsigned, unsigned)> _headerFunction;
+		std::function<void(unsigned, const unsigned char*)> _rowFunction;
+		PixelFormat _outputFormat;
+		PixelFormat _imageFormat;
+		unsigned _width, _height;
+		// of the current image in the output format, for formats libwebp does not decode to
+		std::vector<uint8_t> _row;
+		unsigned _nextRow;
+		bool _isHeaderComplete;
+		bool _isComplete;
 	};
 }
-#endif
\ No newline at end of file
+#endif
@@ -23,9 +23,32 @@
 #elif defined __GNUC__
 #pragma GCC diagnostic pop
 #endif
+#include <cstddef>
 #include <cstdint>
+#include <vector>
 
 namespace Base {
+	enum class JPEGChromaSubsampling
+	{
+		YUV444,
+		// chroma halved horizontally
+		YUV422,
+		// chroma halved in both directions
+		YUV420
+	};
+
+	struct JPEGEncodeOptions
+	{
+		// 1 to 100
+		int quality = 75;
+		JPEGChromaSubsampling subsampling = JPEGChromaSubsampling::YUV420;
+		// computes optimal Huffman tables in an extra pass, files get a few percent smaller
+		bool optimizeCoding = false;
+		bool progressive = false;
+		// the faster, less accurate integer DCT
+		bool fastDCT = false;
+	};
+
 	class IMAGE_CODECS_INTERFACE JPEGEncoder
 	{
 	public:
@@ -38,11 +61,36 @@ namespace Base {
 			virtual ~JPEGImageContainer();
 		};
 		JPEGEncoder();
+		JPEGEncoder(const JPEGEncoder&) = delete;
 		~JPEGEncoder();
+		// Throws for the options setOptions rejects
+		static void validateOptions(const JPEGEncodeOptions& options);
+		// Applies to the following encode calls
+		void setOptions(const JPEGEncodeOptions& options);
+		[[nodiscard]] const JPEGEncodeOptions& getOptions() const;
+		// Restores the default options, called by ObjectPool before the encoder is reused
+		void reset();
+		// Upper bound of the size of a width x height image encoded with any options
+		[[nodiscard]] static uint64_t getMaximumEncodedSize(unsigned width, unsigned height);
+		// The buffer starts small and doubles while libjpeg fills it, so it is copied about once in total
 		[[nodiscard]] JPEGImageContainer encode(const void* rgb, unsigned width, unsigned height);
+		// Encodes into buffer and returns the size of the image, throws if it does not fit into bufferSize bytes
+		size_t encode(const void* rgb, unsigned width, unsigned height, void* buffer, size_t bufferSize);
 	private:
+		// into _jpegCompress.dest
+		void writeImage(const void* rgb, unsigned width, unsigned height);
+		static void initDestination(j_compress_ptr cinfo);
+		static boolean emptyOutputBuffer(j_compress_ptr cinfo);
+		static void termDestination(j_compress_ptr cinfo);
+
 		jpeg_compress_struct _jpegCompress;
 		struct jpeg_error_mgr jerr;
+		jpeg_destination_mgr _destination;
+		// of jpeg_mem_dest, allocated by libjpeg on the first use and reused afterwards
+		jpeg_destination_mgr* _memoryDestination;
+		JPEGEncodeOptions _options;
+		// passed to jpeg_write_scanlines at once
+		std::vector<JSAMPROW> _rows;
 	};
 }
 
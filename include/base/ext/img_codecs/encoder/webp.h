@@ -4,10 +4,51 @@
 
 #include <base/ext/img_codecs/common.h>
 #include <base/ext/img_codecs/encoder.h>
+#include <base/ext/img_codecs/types.h>
 #include <cstddef>
 
+#ifdef _MSC_VER
+#pragma warning(push, 0)
+#elif defined __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wall"
+#endif
+#include <webp/encode.h>
+#ifdef _MSC_VER
+#pragma warning(pop)
+#elif defined __GNUC__
+#pragma GCC diagnostic pop
+#endif
+
 namespace Base
 {
+	// the content hints of WebPConfigPreset
+	enum class WebPEncodePreset
+	{
+		DEFAULT,
+		PICTURE,
+		PHOTO,
+		DRAWING,
+		ICON,
+		TEXT
+	};
+
+	struct WebPEncodeOptions
+	{
+		WebPEncodePreset preset = WebPEncodePreset::DEFAULT;
+		// 0 to 100, in lossy mode the quality factor (larger is better and bigger),
+		// in lossless mode the compression effort (larger is smaller and slower)
+		float quality = 80;
+		// 0 (fastest) to 6 (smallest)
+		int method = 4;
+		bool lossless = false;
+		// 0 (strongest) to 100 (off) preprocessing for smaller lossless files, lossless only
+		int nearLossless = 100;
+		// lets libwebp use a thread of its own where the encoder can
+		bool multiThreaded = false;
+	};
+
+	// Keeps the WebPConfig, WebPPicture and WebPMemoryWriter between the encode calls, not thread-safe.
 	class IMAGE_CODECS_INTERFACE WebPEncoder
 	{
 	public:		
@@ -19,8 +60,27 @@ namespace Base
 			WebPImageContainer(WebPImageContainer&&) = delete;
 			virtual ~WebPImageContainer();
 		};
-		[[nodiscard]] WebPImageContainer encode(const void* rgb, unsigned width, unsigned height);
+		WebPEncoder();
+		WebPEncoder(const WebPEncoder&) = delete;
+		~WebPEncoder();
+		// Applies to the following encode calls
+		void setOptions(const WebPEncodeOptions& options);
+		[[nodiscard]] const WebPEncodeOptions& getOptions() const;
+		// format is one of RGB, BGR, RGBA and BGRA, the rows are packed.
+		// The writer keeps its buffer between the calls, the image is copied into one allocated for the container,
+		// the overload encoding into a buffer of the caller does neither.
+		[[nodiscard]] WebPImageContainer encode(const void* pixels, unsigned width, unsigned height, PixelFormat format = PixelFormat::RGB);
+		// Encodes into buffer and returns the size of the image, throws if it does not fit into bufferSize bytes
+		size_t encode(const void* pixels, unsigned width, unsigned height, PixelFormat format, void* buffer, size_t bufferSize);
+	private:
+		void encodePicture(const void* pixels, unsigned width, unsigned height, PixelFormat format);
+
+		WebPConfig _config;
+		WebPPicture _picture;
+		// grows to the largest image encoded so far
+		WebPMemoryWriter _writer;
+		WebPEncodeOptions _options;
 	};
 }
 
-#endif
\ No newline at end of file
+#endif
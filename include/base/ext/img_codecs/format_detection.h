@@ -0,0 +1,49 @@
+#pragma once
+
+#include <base/ext/img_codecs/common.h>
+#include <base/ext/img_codecs/thread_pool.h>
+#include <base/ext/img_codecs/types.h>
+
+#include <cstddef>
+
+namespace Base
+{
+	// Identifies the image format from the signature at the beginning of buffer, without copying it.
+	// Returns ImageFormatType::UNKNOWN if no signature matches.
+	IMAGE_CODECS_INTERFACE
+	ImageFormatType detectImageFormat(const void* buffer, size_t size);
+
+	struct ImageInfo
+	{
+		ImageFormatType format;
+		unsigned width;
+		unsigned height;
+		// as stored, e.g. 1 for gray JPEGs, 4 for CMYK JPEGs, 3 for palette PNGs, including alpha
+		unsigned numberOfChannels;
+		// bits per sample as stored, palette indices for palette images
+		unsigned bitDepth;
+		// an alpha channel or a transparent color
+		bool hasAlpha;
+		// progressive JPEG or interlaced PNG
+		bool isProgressive;
+		// from the EXIF data of JPEG images, NORMAL for other formats
+		ImageOrientation orientation;
+	};
+
+	// Reads the metadata of a JPEG, PNG, WebP, GIF or BMP image from its headers (SOF, IHDR, VP8/VP8L/VP8X, ...)
+	// without any codec library state. Only the headers are touched, so memory-mapped files are read from the
+	// pages at their beginning, plus the ones up to the SOF marker for JPEG. Returns false if the format is not
+	// recognized or the headers are truncated or invalid.
+	IMAGE_CODECS_INTERFACE
+	bool probeImage(const void* buffer, size_t size, ImageInfo& info);
+
+	// The EXIF orientation of a JPEG image, read from the APP1 segment in front of the frame header.
+	// NORMAL for images without one and other formats.
+	IMAGE_CODECS_INTERFACE
+	ImageOrientation getImageOrientation(const void* buffer, size_t size);
+
+	// Probes numberOfImages images, concurrently on threadPool if given. Images failing to probe get the format
+	// ImageFormatType::UNKNOWN. Returns the number of images probed successfully.
+	IMAGE_CODECS_INTERFACE
+	size_t probeImages(const void* const* buffers, const size_t* sizes, size_t numberOfImages, ImageInfo* infos, WorkStealingThreadPool* threadPool = nullptr);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#ifdef HAVE_LIB_JPEG
+
+#include <base/ext/img_codecs/common.h>
+#include <base/ext/img_codecs/encoder/jpeg.h>
+
+#include <cstddef>
+
+namespace Base
+{
+	enum class JPEGTransformOperation
+	{
+		NONE,
+		FLIP_HORIZONTAL,
+		FLIP_VERTICAL,
+		// across the top-left to bottom-right diagonal
+		TRANSPOSE,
+		// across the top-right to bottom-left diagonal
+		TRANSVERSE,
+		// clockwise
+		ROTATE_90,
+		ROTATE_180,
+		ROTATE_270
+	};
+
+	struct JPEGTransformOptions
+	{
+		JPEGTransformOperation operation = JPEGTransformOperation::NONE;
+		// Crops the transformed image to the cropWidth x cropHeight rectangle at (cropX, cropY) unless cropWidth
+		// or cropHeight is 0. The top-left corner is moved up and left onto the iMCU grid, keeping the bottom-right one.
+		unsigned cropX = 0;
+		unsigned cropY = 0;
+		unsigned cropWidth = 0;
+		unsigned cropHeight = 0;
+		// Partial iMCUs at the edges a flip moves into the image are dropped, like jpegtran -trim does.
+		// perfect throws instead.
+		bool perfect = false;
+		// keeps the APPn and COM markers, e.g. EXIF
+		bool copyMarkers = true;
+		// Sets the EXIF orientation of the copied markers to 1 (upright) unless operation is NONE, as it describes
+		// the source image. Unset, viewers applying it would turn the transformed image once more.
+		bool resetOrientation = true;
+		bool optimizeCoding = false;
+		bool progressive = false;
+	};
+
+	// Rotates, flips and crops JPEG images on their DCT coefficients, like jpegtran. The image is entropy decoded
+	// and encoded again without the inverse and forward DCT, so there is no generation loss and it is much
+	// faster than decoding, transforming and encoding the pixels.
+	class IMAGE_CODECS_INTERFACE JPEGTransformer
+	{
+	public:
+		JPEGTransformer();
+		JPEGTransformer(const JPEGTransformer&) = delete;
+		~JPEGTransformer();
+		[[nodiscard]] JPEGEncoder::JPEGImageContainer transform(const void* image, size_t size, const JPEGTransformOptions& options);
+		// of the last transformed image
+		[[nodiscard]] unsigned getWidth() const;
+		[[nodiscard]] unsigned getHeight() const;
+	private:
+		jpeg_decompress_struct _decompress;
+		jpeg_compress_struct _compress;
+		jpeg_error_mgr _decompressErrorManager;
+		jpeg_error_mgr _compressErrorManager;
+		unsigned _width, _height;
+	};
+}
+#endif
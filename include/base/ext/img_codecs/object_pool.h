@@ -0,0 +1,178 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace Base
+{
+	// Keeps released objects, e.g. ImageDecoder or JPEGEncoder instances with their codec handles, for reuse
+	// instead of creating them again. acquire prefers the object the calling thread released last, so a thread
+	// keeps getting the same warm instance, then the most recently released one of any thread. Released objects
+	// are reset first, so that no settings of one user carry over to the next. Thread-safe.
+	template <typename T>
+	class ObjectPool
+	{
+	public:
+		// Returns the object to the pool when it goes out of scope
+		class Handle
+		{
+		public:
+			Handle() : _pool(nullptr) {}
+			Handle(ObjectPool* pool, std::unique_ptr<T> object) : _pool(pool), _object(std::move(object)) {}
+			Handle(const Handle&) = delete;
+			Handle(Handle&& other) noexcept : _pool(other._pool), _object(std::move(other._object)) {}
+			Handle& operator=(Handle&& other) noexcept
+			{
+				reset();
+				_pool = other._pool;
+				_object = std::move(other._object);
+				return *this;
+			}
+			~Handle()
+			{
+				reset();
+			}
+			void reset()
+			{
+				if (_object)
+					_pool->release(std::move(_object));
+			}
+			[[nodiscard]] T* get() const { return _object.get(); }
+			T* operator->() const { return _object.get(); }
+			T& operator*() const { return *_object; }
+			explicit operator bool() const { return _object != nullptr; }
+		private:
+			ObjectPool* _pool;
+			std::unique_ptr<T> _object;
+		};
+
+		// Keeps up to capacity released objects, factory creates the objects when the pool is empty.
+		// resetter is run on every released object, objects it throws for are freed.
+		explicit ObjectPool(size_t capacity = 64, std::function<std::unique_ptr<T>()> factory = []() { return std::unique_ptr<T>(new T); },
+			std::function<void(T&)> resetter = getDefaultResetter())
+			: _capacity(capacity), _factory(std::move(factory)), _resetter(std::move(resetter)), _numberOfHits(0), _numberOfMisses(0)
+		{
+		}
+		ObjectPool(const ObjectPool&) = delete;
+
+		[[nodiscard]] Handle acquire()
+		{
+			return Handle(this, acquireObject());
+		}
+
+		// The caller owns the object until release
+		std::unique_ptr<T> acquireObject()
+		{
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				if (!_objects.empty())
+				{
+					const std::thread::id threadId = std::this_thread::get_id();
+					auto entry = _objects.begin();
+					while (entry != _objects.end() && entry->threadId != threadId)
+						++entry;
+					if (entry == _objects.end())
+						entry = _objects.begin();
+					std::unique_ptr<T> object = std::move(entry->object);
+					_objects.erase(entry);
+					_numberOfHits.fetch_add(1, std::memory_order_relaxed);
+					return object;
+				}
+			}
+			_numberOfMisses.fetch_add(1, std::memory_order_relaxed);
+			return _factory();
+		}
+
+		// Puts the object back as the most recently released one, the least recently released ones beyond the capacity are freed
+		void release(std::unique_ptr<T> object)
+		{
+			if (_resetter)
+			{
+				try
+				{
+					_resetter(*object);
+				}
+				catch (...)
+				{
+					return;
+				}
+			}
+			std::unique_ptr<T> evicted;
+			std::lock_guard<std::mutex> lock(_mutex);
+			_objects.push_front({ std::this_thread::get_id(), std::move(object) });
+			if (_objects.size() > _capacity)
+			{
+				evicted = std::move(_objects.back().object);
+				_objects.pop_back();
+			}
+		}
+
+		void clear()
+		{
+			std::list<Entry> objects;
+			std::lock_guard<std::mutex> lock(_mutex);
+			objects.swap(_objects);
+		}
+
+		[[nodiscard]] size_t getCapacity() const
+		{
+			return _capacity;
+		}
+
+		[[nodiscard]] size_t getSize() const
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			return _objects.size();
+		}
+
+		[[nodiscard]] uint64_t getNumberOfHits() const
+		{
+			return _numberOfHits.load(std::memory_order_relaxed);
+		}
+
+		[[nodiscard]] uint64_t getNumberOfMisses() const
+		{
+			return _numberOfMisses.load(std::memory_order_relaxed);
+		}
+
+		// Calls T::reset() of types having one, e.g. ImageDecoder and JPEGEncoder, does nothing for the others
+		[[nodiscard]] static std::function<void(T&)> getDefaultResetter()
+		{
+			return getDefaultResetter(0);
+		}
+	private:
+		template <typename Type = T>
+		static auto getDefaultResetter(int) -> decltype(std::declval<Type&>().reset(), std::function<void(T&)>())
+		{
+			return [](T& object) { object.reset(); };
+		}
+
+		static std::function<void(T&)> getDefaultResetter(long)
+		{
+			return nullptr;
+		}
+
+		struct Entry
+		{
+			// of the thread which released the object
+			std::thread::id threadId;
+			std::unique_ptr<T> object;
+		};
+
+		size_t _capacity;
+		std::function<std::unique_ptr<T>()> _factory;
+		std::function<void(T&)> _resetter;
+		mutable std::mutex _mutex;
+		// the most recently released first
+		std::list<Entry> _objects;
+		std::atomic<uint64_t> _numberOfHits;
+		std::atomic<uint64_t> _numberOfMisses;
+	};
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <base/ext/img_codecs/common.h>
+#include <base/ext/img_codecs/types.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Base
+{
+	// bytes of a pixel, a single plane for RGB_PLANAR
+	IMAGE_CODECS_INTERFACE
+	unsigned getPixelSize(PixelFormat format);
+	IMAGE_CODECS_INTERFACE
+	unsigned getNumberOfPlanes(PixelFormat format);
+	// row size rounded up to a multiple of rowAlignment, e.g. getSIMDMemoryAlignmentRequirement()
+	IMAGE_CODECS_INTERFACE
+	size_t getImageRowStride(unsigned width, PixelFormat format, unsigned rowAlignment = 1);
+	IMAGE_CODECS_INTERFACE
+	uint64_t getImageSize(unsigned height, PixelFormat format, size_t rowStride);
+
+	// Writes a row of packed RGB pixels in format. For RGB_PLANAR row points into the first plane
+	// and the following planes start planeSize bytes after each other.
+	IMAGE_CODECS_INTERFACE
+	void convertRGBRow(const unsigned char* source, unsigned width, PixelFormat format, unsigned char* row, uint64_t planeSize);
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <base/ext/img_codecs/common.h>
+#include <base/ext/img_codecs/thread_pool.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Base
+{
+	enum class ScalerPixelFormat
+	{
+		RGB24,
+		BGR24,
+		RGBA,
+		BGRA,
+		GRAY8,
+		// Y plane followed by an interleaved U/V plane of half width and height
+		NV12,
+		// Y, U and V planes, U and V of half width and height
+		I420
+	};
+
+	enum class ImageResizeMethod
+	{
+		// interpolates the 2x2 source pixels around the pixel center
+		BILINEAR,
+		// averages all source pixels covered by the destination pixel when shrinking, bilinear when enlarging
+		AREA
+	};
+
+	struct ScalerImage
+	{
+		ScalerPixelFormat format;
+		unsigned width;
+		unsigned height;
+		uint8_t* planes[3];
+		// bytes between the starts of two rows, may be negative
+		ptrdiff_t strides[3];
+	};
+
+	// Fills the planes of a width x height image stored contiguously at buffer with unpadded rows
+	IMAGE_CODECS_INTERFACE
+	ScalerImage getScalerImage(ScalerPixelFormat format, unsigned width, unsigned height, void* buffer);
+
+	// Resizes and converts images without libswscale. Sources may be in any format, destinations have
+	// to be packed (RGB24, BGR24, RGBA, BGRA or GRAY8). YUV sources are BT.601 limited range.
+	// Rows are resampled in 11-bit fixed point, on AVX2 when the CPU supports it.
+	// The filter tables are rebuilt only when the geometry or resize method changes.
+	class IMAGE_CODECS_INTERFACE ImageScaler
+	{
+	public:
+		ImageScaler();
+		void setResizeMethod(ImageResizeMethod method);
+		[[nodiscard]] ImageResizeMethod getResizeMethod() const;
+		[[nodiscard]] static bool isSupported(ScalerPixelFormat sourceFormat, ScalerPixelFormat destinationFormat);
+		// flipVertical writes the destination rows bottom up
+		void scale(const ScalerImage& source, const ScalerImage& destination, bool flipVertical = false);
+		// Scales bands of destination rows concurrently on threadPool, the result is identical to the one of scale.
+		// Rows shared by the filters of two bands are filtered by both.
+		void scale(const ScalerImage& source, const ScalerImage& destination, bool flipVertical, WorkStealingThreadPool& threadPool);
+	private:
+		struct Filter
+		{
+			unsigned numberOfTaps;
+			// numberOfTaps source indices and weights per destination index, the weights sum up to 1 << 11
+			std::vector<unsigned> indices;
+			std::vector<int32_t> weights;
+		};
+
+		struct RowBuffers
+		{
+			// source row converted to the destination format
+			std::vector<uint8_t> convertedRow;
+			// horizontally filtered source rows, indexed by the source row modulo their number
+			std::vector<std::vector<int32_t>> filteredRows;
+			std::vector<unsigned> filteredRowIndices;
+		};
+
+		void updateFilters(unsigned sourceWidth, unsigned sourceHeight, unsigned destinationWidth, unsigned destinationHeight);
+		void prepare(const ScalerImage& source, const ScalerImage& destination, size_t numberOfRowBuffers);
+		void scaleRows(const ScalerImage& source, const ScalerImage& destination, bool flipVertical, unsigned firstRow, unsigned endRow, RowBuffers& rowBuffers) const;
+		const int32_t* getFilteredRow(const ScalerImage& source, unsigned row, ScalerPixelFormat destinationFormat, RowBuffers& rowBuffers) const;
+
+		ImageResizeMethod _method;
+		unsigned _sourceWidth, _sourceHeight, _destinationWidth, _destinationHeight;
+		bool _filtersValid;
+		Filter _horizontalFilter, _verticalFilter;
+		// one per thread
+		std::vector<RowBuffers> _rowBuffers;
+	};
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <base/ext/img_codecs/common.h>
+
+#ifdef _MSC_VER
+#pragma warning(push, 0)
+#elif defined __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wall"
+#endif
+
+extern "C" {
+#include <libswscale/swscale.h>
+}
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#elif defined __GNUC__
+#pragma GCC diagnostic pop
+#endif
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+
+namespace Base
+{
+	struct SwsContextKey
+	{
+		int sourceWidth;
+		int sourceHeight;
+		AVPixelFormat sourceFormat;
+		int destinationWidth;
+		int destinationHeight;
+		AVPixelFormat destinationFormat;
+		int flags;
+
+		bool operator==(const SwsContextKey& other) const;
+	};
+
+	// Bounded least recently used set of SwsContexts. A context is taken out of the cache while it is
+	// used, so an instance can be shared by several threads; threads asking for the same key at the
+	// same time get separate contexts.
+	class IMAGE_CODECS_INTERFACE SwsContextCache
+	{
+	public:
+		explicit SwsContextCache(size_t capacity = 8);
+		SwsContextCache(const SwsContextCache&) = delete;
+		~SwsContextCache();
+		// Takes the context of key out of the cache or creates one, the caller owns it until release
+		SwsContext* acquire(const SwsContextKey& key);
+		// Puts the context back as the most recently used one, the least recently used ones beyond the capacity are freed
+		void release(const SwsContextKey& key, SwsContext* context);
+		void clear();
+		[[nodiscard]] size_t getCapacity() const;
+		[[nodiscard]] size_t getSize() const;
+		[[nodiscard]] uint64_t getNumberOfHits() const;
+		[[nodiscard]] uint64_t getNumberOfMisses() const;
+		[[nodiscard]] uint64_t getNumberOfEvictions() const;
+		// the cache of the calling thread, freed when the thread exits
+		static SwsContextCache& getThreadLocal();
+	private:
+		struct Entry
+		{
+			SwsContextKey key;
+			SwsContext* context;
+		};
+
+		size_t _capacity;
+		mutable std::mutex _mutex;
+		// the most recently used first, linear lookup is faster than hashing for a handful of entries
+		std::list<Entry> _entries;
+		std::atomic<uint64_t> _numberOfHits;
+		std::atomic<uint64_t> _numberOfMisses;
+		std::atomic<uint64_t> _numberOfEvictions;
+	};
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <base/ext/img_codecs/common.h>
+#include <base/ext/img_codecs/types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Base
+{
+	enum class TensorLayout
+	{
+		// channel planes of height x width values each
+		CHW,
+		// interleaved channels
+		HWC
+	};
+
+	enum class TensorDataType
+	{
+		FLOAT32,
+		// IEEE 754 half precision, stored as uint16_t
+		FLOAT16
+	};
+
+	struct ImageTensorOptions
+	{
+		unsigned width = 0;
+		unsigned height = 0;
+		TensorLayout layout = TensorLayout::CHW;
+		TensorDataType dataType = TensorDataType::FLOAT32;
+		// every channel c is written as (value * scale - mean[c]) / std[c]
+		float scale = 1.f / 255.f;
+		float mean[3] = { 0.f, 0.f, 0.f };
+		float std[3] = { 1.f, 1.f, 1.f };
+		// writes the channels in BGR order, mean and std follow the tensor order
+		bool reverseChannels = false;
+	};
+
+	// Bilinearly resizes 8-bit images to width x height (pixel centers aligned, like OpenCV INTER_LINEAR)
+	// and normalizes them into a 3-channel float tensor in a single pass. The source rows are pushed
+	// in order and every output row is written as soon as both source rows it interpolates are known,
+	// so only two resized rows are kept. The vertical interpolation and normalization run on AVX-512F
+	// or AVX kernels when the CPU supports them.
+	class IMAGE_CODECS_INTERFACE ImageTensorConverter
+	{
+	public:
+		explicit ImageTensorConverter(const ImageTensorOptions& options);
+		[[nodiscard]] const ImageTensorOptions& getOptions() const;
+		// bytes of the output tensor
+		[[nodiscard]] uint64_t getTensorSize() const;
+		// Prepares to convert a sourceWidth x sourceHeight image of the packed format sourceFormat into tensor,
+		// alpha channels are dropped and gray channels repeated.
+		void begin(unsigned sourceWidth, unsigned sourceHeight, PixelFormat sourceFormat, void* tensor);
+		void pushRow(const unsigned char* row);
+		[[nodiscard]] bool isComplete() const;
+		void convert(const void* image, unsigned width, unsigned height, PixelFormat format, size_t rowStride, void* tensor);
+	private:
+		typedef void BlendRowsFunction(const float* top, const float* bottom, float weight, const float* scale, const float* bias, void* output, size_t size);
+
+		void resizeRow(const unsigned char* row, float* output) const;
+		void writeRow(unsigned row);
+
+		ImageTensorOptions _options;
+		BlendRowsFunction* _blendRows;
+		size_t _elementSize;
+
+		unsigned _sourceWidth, _sourceHeight;
+		unsigned _sourceChannelOffsets[3];
+		unsigned char* _tensor;
+		// per output column, byte offsets of the left and right source pixels and the weight of the right one
+		std::vector<size_t> _columnOffsets;
+		std::vector<float> _columnWeights;
+		// per output row, the upper source row and the weight of the one below
+		std::vector<unsigned> _sourceRows;
+		std::vector<float> _rowWeights;
+		// source rows no output row interpolates are not resized
+		std::vector<bool> _isSourceRowUsed;
+		// per tensor row element, in the order of the resized rows
+		std::vector<float> _scale, _bias;
+		// resized source rows, indexed by the parity of the source row
+		std::vector<float> _resizedRows[2];
+		unsigned _currentSourceRow;
+		unsigned _currentRow;
+	};
+}
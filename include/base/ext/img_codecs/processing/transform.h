@@ -17,15 +17,31 @@ extern "C" {
 #pragma GCC diagnostic pop
 #endif
 
+#include <base/ext/img_codecs/processing/scaler.h>
+#include <base/ext/img_codecs/processing/sws_context_cache.h>
+#include <base/ext/img_codecs/thread_pool.h>
+
 #include <cstdint>
 
 namespace Base
 {
+	// Converts, resizes and flips image slices. Formats ImageScaler supports are processed natively,
+	// the others by libswscale with SWS_FAST_BILINEAR.
 	class ImageFormatTransformer
 	{
 	public:
-		ImageFormatTransformer();
-		~ImageFormatTransformer();
+		// The SwsContexts come from swsContextCache, which may be shared with other threads,
+		// or from the cache of the calling thread if it is null.
+		explicit ImageFormatTransformer(SwsContextCache* swsContextCache = nullptr);
+		// of the native path, libswscale always uses SWS_FAST_BILINEAR
+		void setResizeMethod(ImageResizeMethod method);
+		// disabled routes every format through libswscale
+		void setNativeScalingEnabled(bool enabled);
+		// Splits large slices into bands of rows transformed concurrently on threadPool, null transforms on the
+		// calling thread only. The output is identical to the single-threaded one; libswscale stays single-threaded
+		// when scaling vertically, with vertically subsampled chroma or with paletted and bitstream destinations
+		// since its bands would not be.
+		void setThreadPool(WorkStealingThreadPool* threadPool);
 		void transform(uint32_t sourceImageWidth, uint32_t sourceImageHeight, AVPixelFormat sourceImageFormat,
 			uint32_t sourceImageSliceX, uint32_t sourceImageSliceY, uint32_t sourceImageSliceWidth, uint32_t sourceImageSliceHeight,
 			uint32_t destinationImageWidth, uint32_t destinationImageHeight, AVPixelFormat destinationImageFormat,
@@ -34,16 +50,10 @@ namespace Base
 			uint8_t* source, uint8_t* destination
 			);
 	private:
-		SwsContext* _swsContext;
-		struct Context
-		{
-			uint32_t sourceImageSliceWidth;
-			uint32_t sourceImageSliceHeight;
-			AVPixelFormat sourceImageFormat;
-			uint32_t destinationImageSliceWidth;
-			uint32_t destinationImageSliceHeight;
-			AVPixelFormat destinationImageFormat;
-		} _context;
+		ImageScaler _scaler;
+		bool _nativeScalingEnabled;
+		SwsContextCache* _swsContextCache;
+		WorkStealingThreadPool* _threadPool;
 	};
 
 }
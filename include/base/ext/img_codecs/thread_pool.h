@@ -0,0 +1,57 @@
+#pragma once
+
+#include <base/ext/img_codecs/common.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Base
+{
+	// Fixed set of workers splitting an index range between them. Every worker owns a contiguous
+	// part of the range, idle workers steal half of the largest remaining part of another worker.
+	class IMAGE_CODECS_INTERFACE WorkStealingThreadPool
+	{
+	public:
+		// 0 uses one worker per hardware thread, the calling thread of parallelFor is worker 0
+		explicit WorkStealingThreadPool(unsigned numberOfThreads = 0);
+		WorkStealingThreadPool(const WorkStealingThreadPool&) = delete;
+		~WorkStealingThreadPool();
+		[[nodiscard]] unsigned getNumberOfThreads() const;
+		// Calls function(workerIndex, index) for every index below count and returns once all calls finished.
+		// Calls from different threads are serialized. The first exception thrown by function is rethrown
+		// after the remaining indices were processed.
+		void parallelFor(size_t count, const std::function<void(unsigned, size_t)>& function);
+	private:
+		struct alignas(64) Worker
+		{
+			// begin in the lower, end in the upper 32 bits
+			std::atomic<uint64_t> range;
+		};
+
+		void run(unsigned workerIndex);
+		void work(unsigned workerIndex);
+		bool takeOwn(Worker& worker, size_t& index);
+		bool steal(unsigned workerIndex, size_t& index);
+
+		unsigned _numberOfThreads;
+		std::unique_ptr<Worker[]> _workers;
+		std::vector<std::thread> _threads;
+
+		std::mutex _parallelForMutex;
+		std::mutex _mutex;
+		std::condition_variable _startCondition;
+		std::condition_variable _finishCondition;
+		uint64_t _generation;
+		unsigned _numberOfBusyThreads;
+		bool _stopRequested;
+		const std::function<void(unsigned, size_t)>* _function;
+		std::exception_ptr _exception;
+	};
+}
@@ -1,9 +1,63 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
 namespace Base {
     enum class ImageFormatType {
         JPEG,
         PNG,
-        WEBP
+        WEBP,
+        GIF,
+        BMP,
+        UNKNOWN
+    };
+
+    // 8 bits per channel, packed formats interleave the channels
+    enum class PixelFormat {
+        RGB,
+        BGR,
+        RGBA,
+        BGRA,
+        GRAY,
+        // R, G and B planes of height rows each, one after another (CHW)
+        RGB_PLANAR
+    };
+
+    // EXIF orientation, the transformation turning the stored image upright
+    enum class ImageOrientation {
+        NORMAL = 1,
+        FLIP_HORIZONTAL,
+        ROTATE_180,
+        FLIP_VERTICAL,
+        // across the top-left to bottom-right diagonal
+        TRANSPOSE,
+        // clockwise
+        ROTATE_90,
+        // across the top-right to bottom-left diagonal
+        TRANSVERSE,
+        ROTATE_270
+    };
+
+    struct ImageDecodeOptions {
+        PixelFormat format = PixelFormat::RGB;
+        // rows are padded to a multiple of rowAlignment bytes
+        unsigned rowAlignment = 1;
+        // Keeps the samples of 16-bit PNG images as native-endian uint16_t instead of reducing them to 8 bits,
+        // applies to packed formats only. Other images are still decoded to 8 bits per channel.
+        bool preserve16Bit = false;
+        // lets decoders use threads of their own where the codec library can (WebP)
+        bool multiThreaded = false;
+        // Decodes JPEG images upright as their EXIF orientation tells, applied by ImageDecoder
+        bool applyOrientation = false;
+    };
+
+    // 8-bit planes of a BT.601 YUV 4:2:0 image, U and V are of half the width and height rounded up
+    struct YUV420Planes {
+        uint8_t *y;
+        uint8_t *u;
+        uint8_t *v;
+        size_t yStride;
+        size_t uvStride;
     };
 }
\ No newline at end of file
@@ -8,6 +8,8 @@
 #include <base/preprocessor.h>
 #include <base/logging/macros.h>
 #include <base/logging/interface.h>
+#include <base/logging/async.h>
+#include <base/logging/level.h>
 
 #ifdef _WIN32
 #include <base/logging/win32.h>
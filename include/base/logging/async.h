@@ -0,0 +1,54 @@
+#pragma once
+
+#include <base/logging/common.h>
+#include <cstddef>
+#include <cstdint>
+
+namespace Base
+{
+	namespace Logging
+	{
+		enum class AsyncOverflowPolicy
+		{
+			// producer waits until the background thread frees enough space
+			BLOCK,
+			// the message being written is discarded
+			DROP_NEWEST,
+			// the oldest pending messages of the producer thread are discarded
+			DROP_OLDEST
+		};
+
+		struct AsyncLoggingOptions
+		{
+			// capacity of the ring buffer owned by each producing thread, rounded up to a power of two
+			size_t threadBufferSize = 1024 * 1024;
+			AsyncOverflowPolicy overflowPolicy = AsyncOverflowPolicy::BLOCK;
+			// the background thread wakes up at least this often
+			unsigned flushIntervalMilliseconds = 50;
+			// pending messages are concatenated into batches of at most this size before reaching the sinks
+			size_t maxBatchSize = 64 * 1024;
+		};
+
+		struct AsyncLoggingStatistics
+		{
+			uint64_t enqueued;
+			uint64_t droppedNewest;
+			uint64_t droppedOldest;
+			uint64_t blocked;
+			uint64_t batches;
+		};
+
+		// Messages are queued into per thread lock-free ring buffers and written to the sinks by a
+		// background thread. Pending messages are flushed on FatalError, on flush() and on process exit.
+		// Messages of one thread keep their order, messages of different threads may be interleaved.
+		// On Windows, call disableAsyncLogging() before the module is unloaded.
+		LOGGING_INTERFACE
+		void enableAsyncLogging(const AsyncLoggingOptions& options = AsyncLoggingOptions());
+		LOGGING_INTERFACE
+		void disableAsyncLogging();
+		LOGGING_INTERFACE
+		bool isAsyncLoggingEnabled();
+		LOGGING_INTERFACE
+		AsyncLoggingStatistics getAsyncLoggingStatistics();
+	}
+}
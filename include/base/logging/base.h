@@ -1,8 +1,8 @@
 #pragma once
 
 #include <string>
-#include <sstream>
 #include <base/logging/common.h>
+#include <base/logging/stream.h>
 #include <base/error_codes.h>
 
 namespace Base
@@ -25,10 +25,17 @@ namespace Base
 				void setMessage(const std::string& message);
 				void setMessage(std::string&& message);
 				void setAction(Action action);
+				// pending asynchronous messages are written out together with this one
+				void setFlush(bool flush);
 				~LoggingMessageFinalHandler() noexcept(false);
 			protected:
+				// owned here so that the formatted message outlives the destructors of the derived streams
+				LoggingStream _stream;
+				// overrides the content of _stream when set
 				std::string _message;
+				bool _hasMessage;
 				Action _action;
+				bool _flush;
 				ErrorCodeType _errorCodeType;
 				int64_t _errorCode;
 			};
@@ -39,30 +46,24 @@ namespace Base
 		{
 		public:
 			FatalErrorLoggingStream(ErrorCodeType errorCodeType, int64_t errorCode);
-			std::stringstream& stream();
+			Details::LoggingStream& stream();
 			~FatalErrorLoggingStream();
-		private:
-			std::stringstream _stream;
 		};
 
 		class LOGGING_INTERFACE RuntimeExceptionLoggingStream : public Details::LoggingMessageFinalHandler
 		{
 		public:
 			RuntimeExceptionLoggingStream(ErrorCodeType errorCodeType, int64_t errorCode);
-			std::stringstream& stream();
+			Details::LoggingStream& stream();
 			~RuntimeExceptionLoggingStream();
-		private:
-			std::stringstream _stream;
 		};
 		
 		class LOGGING_INTERFACE EventLoggingStream : public Details::LoggingMessageFinalHandler
 		{
 		public:
 			EventLoggingStream(ErrorCodeType errorCodeType, int64_t errorCode);
-			std::stringstream& stream();
+			Details::LoggingStream& stream();
 			~EventLoggingStream();
-		private:
-			std::stringstream _stream;
 		};
 	}
 }
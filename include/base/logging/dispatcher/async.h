@@ -0,0 +1,71 @@
+#pragma once
+
+#include <base/logging/async.h>
+#include <base/logging/dispatcher/ring_buffer.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace Base
+{
+	namespace Logging
+	{
+		namespace Details
+		{
+			class LoggingMessageDispatcher;
+
+			class AsyncLoggingWorker
+			{
+			public:
+				explicit AsyncLoggingWorker(LoggingMessageDispatcher* dispatcher);
+				AsyncLoggingWorker(const AsyncLoggingWorker&) = delete;
+				~AsyncLoggingWorker();
+				void start(const AsyncLoggingOptions& options);
+				void stop();
+				[[nodiscard]] bool isRunning() const;
+				// true on the background thread and inside drain(), sinks must be called synchronously there
+				[[nodiscard]] static bool isDrainingThread();
+				// returns false if the message was not queued and should be written synchronously,
+				// the pending messages of the calling thread are written to the sinks before
+				bool enqueue(std::string_view message);
+				// writes all pending messages to the sinks on the calling thread
+				void drain();
+				[[nodiscard]] AsyncLoggingStatistics getStatistics();
+			private:
+				LoggingRingBuffer* getThreadRingBuffer();
+				bool tryEnqueue(std::string_view message);
+				void drainThreadRingBuffer();
+				void wakeUp();
+				void run();
+				bool drainOnce();
+				void writeBatch();
+
+				LoggingMessageDispatcher* _dispatcher;
+				AsyncLoggingOptions _options;
+				std::atomic<bool> _running;
+				std::atomic<uint64_t> _generation;
+				std::atomic<uint64_t> _batches;
+				std::thread _thread;
+
+				std::mutex _ringsMutex;
+				std::vector<std::shared_ptr<LoggingRingBuffer>> _rings;
+				AsyncLoggingStatistics _retiredStatistics;
+				std::atomic<bool> _ringsChanged;
+
+				std::mutex _drainMutex;
+				std::vector<std::shared_ptr<LoggingRingBuffer>> _drainingRings;
+				std::string _batch;
+
+				std::mutex _wakeUpMutex;
+				std::condition_variable _wakeUpCondition;
+				bool _stopRequested;
+			};
+		}
+	}
+}
@@ -1,11 +1,15 @@
 #pragma once
 
+#include <atomic>
 #include <vector>
 #include <shared_mutex>
 #include <functional>
 #include <string_view>
 #include <memory>
 
+#include <base/logging/dispatcher/async.h>
+#include <base/logging/record.h>
+
 namespace Base
 {
 	namespace Logging
@@ -16,16 +20,31 @@ namespace Base
 			class LoggingMessageDispatcher
 			{
 			public:
+				LoggingMessageDispatcher();
 				int addSink(Sink* sink);
 				void write(std::string_view string);
+				// writes newline terminated messages as one chunk
+				void writeBatch(std::string_view batch);
+				// sinks without record support get the formatted text
+				void writeRecord(const LoggingRecord& record);
+				// true if there is at least one sink and all of them accept records
+				bool isRecordOnly() const;
 				void removeSink(int handle);
 				void flush();
+				void enableAsync(const AsyncLoggingOptions& options);
+				void disableAsync();
+				bool isAsyncEnabled() const;
+				AsyncLoggingStatistics getAsyncStatistics();
 				~LoggingMessageDispatcher();
 			private:
 				void safe_executor(const std::function<void(const std::unique_ptr<Sink>&)>& function);
+				// called with _mutex exclusively locked
+				void updateRecordOnly();
 				std::shared_mutex _mutex;
+				std::atomic<bool> _recordOnly;
 				std::vector<std::pair<int, std::unique_ptr<Sink>>> _sinks;
-			} extern g_dispatcher ;			
+				AsyncLoggingWorker _asyncWorker;
+			} extern g_dispatcher ;
 		}
 	}
 }
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace Base
+{
+	namespace Logging
+	{
+		namespace Details
+		{
+			// Single producer ring of variable length messages.
+			// Records are [uint32 length][payload] aligned to 4 bytes, a record which does not fit before
+			// the end of the buffer is preceded by a wrap marker.
+			// The read position is advanced with CAS so that the producer can discard the oldest records
+			// itself (drop oldest policy), the consumer validates every copied record with the same CAS.
+			// A record read while the producer overwrites it may carry any length, the consumer bounds
+			// the copy by the buffer before the CAS tells whether the bytes were intact.
+			class LoggingRingBuffer
+			{
+			public:
+				explicit LoggingRingBuffer(size_t capacity);
+				LoggingRingBuffer(const LoggingRingBuffer&) = delete;
+				// producer side
+				bool tryPush(std::string_view message);
+				uint64_t dropOldest(std::string_view message);
+				void close();
+				// consumer side
+				bool tryPopTo(std::string& output);
+				[[nodiscard]] bool empty() const;
+				[[nodiscard]] bool isClosed() const;
+
+				[[nodiscard]] size_t capacity() const;
+				[[nodiscard]] size_t getMaxMessageSize() const;
+
+				// statistics, written by the producer only
+				std::atomic<uint64_t> enqueued;
+				std::atomic<uint64_t> droppedNewest;
+				std::atomic<uint64_t> droppedOldest;
+				std::atomic<uint64_t> blocked;
+				// set by the producer while it may push, the worker waits for it before its final drain
+				std::atomic<bool> producing;
+			private:
+				[[nodiscard]] size_t getRecordSize(size_t messageSize) const;
+				[[nodiscard]] size_t getRequiredSpace(uint64_t head, size_t recordSize) const;
+
+				std::unique_ptr<char[]> _buffer;
+				size_t _capacity;
+				size_t _mask;
+				std::atomic<bool> _closed;
+				alignas(64) std::atomic<uint64_t> _head;
+				alignas(64) std::atomic<uint64_t> _tail;
+			};
+		}
+	}
+}
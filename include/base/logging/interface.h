@@ -14,5 +14,7 @@ namespace Base
 		void removeSink(int handle);
 		LOGGING_INTERFACE
 		void log(std::string_view message);
+		LOGGING_INTERFACE
+		void flush();
 	};
 };
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <base/logging/common.h>
+#include <atomic>
+#include <string_view>
+
+#define LOGGING_LEVEL_DEBUG 0
+#define LOGGING_LEVEL_INFO 1
+#define LOGGING_LEVEL_WARNING 2
+#define LOGGING_LEVEL_ERROR 3
+#define LOGGING_LEVEL_OFF 4
+
+// Messages below this level are removed at compile time, e.g. -DLOGGING_MINIMUM_LEVEL=LOGGING_LEVEL_INFO
+#ifndef LOGGING_MINIMUM_LEVEL
+#define LOGGING_MINIMUM_LEVEL LOGGING_LEVEL_DEBUG
+#endif
+
+// Runtime verbosity is controlled per module, define it before including base/logging.h
+#ifndef LOGGING_MODULE_NAME
+#define LOGGING_MODULE_NAME "default"
+#endif
+
+namespace Base
+{
+	namespace Logging
+	{
+		enum class Level
+		{
+			LEVEL_DEBUG = LOGGING_LEVEL_DEBUG,
+			LEVEL_INFO = LOGGING_LEVEL_INFO,
+			LEVEL_WARNING = LOGGING_LEVEL_WARNING,
+			LEVEL_ERROR = LOGGING_LEVEL_ERROR,
+			LEVEL_OFF = LOGGING_LEVEL_OFF
+		};
+
+		// Applies to all modules without an explicit level, LEVEL_INFO by default
+		LOGGING_INTERFACE
+		void setLoggingLevel(Level level);
+		LOGGING_INTERFACE
+		Level getLoggingLevel();
+		LOGGING_INTERFACE
+		void setModuleLoggingLevel(std::string_view module, Level level);
+		// the module falls back to the global level again
+		LOGGING_INTERFACE
+		void resetModuleLoggingLevel(std::string_view module);
+		LOGGING_INTERFACE
+		Level getModuleLoggingLevel(std::string_view module);
+
+		namespace Details
+		{
+			// The returned slot stays valid for the lifetime of the process, call sites cache it
+			LOGGING_INTERFACE
+			const std::atomic<int>& getModuleLoggingLevelSlot(const char* module);
+		}
+	}
+}
+
+#define _LOG_MODULE_LEVEL \
+[]() -> int { static const std::atomic<int>& _moduleLevel_ = Base::Logging::Details::getModuleLoggingLevelSlot(LOGGING_MODULE_NAME); return _moduleLevel_.load(std::memory_order_relaxed); }()
+
+#define _LOG_IS_LEVEL_ENABLED(level) \
+((level) >= LOGGING_MINIMUM_LEVEL && (level) >= _LOG_MODULE_LEVEL)
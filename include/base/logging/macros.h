@@ -5,6 +5,7 @@
 #include <string>
 #include <functional>
 #include <base/logging/base.h>
+#include <base/logging/level.h>
 
 namespace Base {
 	namespace Logging {
@@ -44,7 +45,16 @@ namespace Base {
 			};
 			struct _StreamTypeVoidify
 			{
-				void operator&(std::ostream&) const {}
+				void operator&(LoggingStream&) const {}
+			};
+
+			// target of the messages removed by LOGGING_MINIMUM_LEVEL, never executed
+			struct _NullLoggingStream
+			{
+				template <typename Type>
+				_NullLoggingStream& operator<<(const Type&) { return *this; }
+				_NullLoggingStream& operator<<(std::ostream& (*)(std::ostream&)) { return *this; }
+				_NullLoggingStream& operator<<(std::ios_base& (*)(std::ios_base&)) { return *this; }
 			};
 			
 			LOGGING_INTERFACE
@@ -88,7 +98,7 @@ namespace Base {
 			template <typename T,
 				typename = std::enable_if_t<!
 				is_to_stream_writable<std::ostream, T>::value>>
-				std::string make_stream_writable(const T& v)
+				std::string make_stream_writable(const T&)
 			{
 				return "(unstringifiable)";
 			}
@@ -111,33 +121,68 @@ namespace Base {
 
 #define _LOG_IMPL_NAMESPACE Base::Logging::Details
 
+// every expansion is a distinct lambda, hence owns its slot
+#define _LOG_SITE_SLOT \
+[]() -> _LOG_IMPL_NAMESPACE::LoggingSiteSlot* { static _LOG_IMPL_NAMESPACE::LoggingSiteSlot slot; return &slot; }()
+
 /* ----------------------------- GENERIC ----------------------------- */
 #define _LOG_GENERIC(loggingClass, errorCodeType, errorCode, handler) \
-loggingClass(handler, errorCodeType, errorCode).stream() << _LOG_IMPL_NAMESPACE::generateHeader(__FILE__, __LINE__, __func__)
+loggingClass(handler, errorCodeType, errorCode).stream() << _LOG_IMPL_NAMESPACE::LoggingHeader{_LOG_BASE_FILE_NAME, __LINE__, __func__, _LOG_SITE_SLOT}
+
+#define _LOG_LEVELED_GENERIC(level, loggingClass, errorCodeType, errorCode, handler) \
+if (!_LOG_IS_LEVEL_ENABLED(level)) ; else _LOG_GENERIC(loggingClass, errorCodeType, errorCode, handler)
+
+#define _LOG_DISABLED_GENERIC \
+if (true) ; else _LOG_IMPL_NAMESPACE::_NullLoggingStream()
+
+// the condition is always evaluated, the level only decides whether the message is written
+#define _LOG_ENABLED_CONDITIONED_GENERIC(condition, enabled, loggingClass, errorCodeType, errorCode, handler) \
+((condition) || !(enabled)) ? (void) 0 : _LOG_IMPL_NAMESPACE::_StreamTypeVoidify() & loggingClass(handler, errorCodeType, errorCode).stream() << _LOG_IMPL_NAMESPACE::LoggingCheckHeader{{_LOG_BASE_FILE_NAME, __LINE__, __func__, _LOG_SITE_SLOT}, #condition}
 
 #define _LOG_CONDITIONED_GENERIC(condition, loggingClass, errorCodeType, errorCode, handler) \
-(condition) ? (void) 0 : _LOG_IMPL_NAMESPACE::_StreamTypeVoidify() & loggingClass(handler, errorCodeType, errorCode).stream() << _LOG_IMPL_NAMESPACE::generateHeader(__FILE__, __LINE__, __func__, #condition)
+_LOG_ENABLED_CONDITIONED_GENERIC(condition, true, loggingClass, errorCodeType, errorCode, handler)
 
-#define _LOG_CONDITIONED_BINARY_OP_GENERIC(leftExp, rightExp, op, functional_op, loggingClass, errorCodeType, errorCode, handler) \
-if (auto _values_ = _LOG_IMPL_NAMESPACE::_Comparator<decltype(leftExp), functional_op> ((leftExp), (rightExp))) ; else loggingClass(handler, errorCodeType, errorCode).stream() << _LOG_IMPL_NAMESPACE::generateHeader(__FILE__, __LINE__, __func__, #leftExp, #op, #rightExp) << "(" << _LOG_IMPL_NAMESPACE::make_stream_writable(LOG_GET_LEFT_EXPRESSION_RC) << " vs. " << _LOG_IMPL_NAMESPACE::make_stream_writable(LOG_GET_RIGHT_EXPRESSION_RC) << ") "
+#define _LOG_LEVELED_CONDITIONED_GENERIC(level, condition, loggingClass, errorCodeType, errorCode, handler) \
+_LOG_ENABLED_CONDITIONED_GENERIC(condition, _LOG_IS_LEVEL_ENABLED(level), loggingClass, errorCodeType, errorCode, handler)
+
+#define _LOG_ENABLED_CONDITIONED_BINARY_OP_GENERIC(leftExp, rightExp, op, functional_op, enabled, loggingClass, errorCodeType, errorCode, handler) \
+if (auto _values_ = _LOG_IMPL_NAMESPACE::_Comparator<decltype(leftExp), functional_op> ((leftExp), (rightExp))) ; else if (!(enabled)) ; else loggingClass(handler, errorCodeType, errorCode).stream() << _LOG_IMPL_NAMESPACE::LoggingBinaryCheckHeader{{_LOG_BASE_FILE_NAME, __LINE__, __func__, _LOG_SITE_SLOT}, #leftExp, #op, #rightExp} << "(" << _LOG_IMPL_NAMESPACE::make_stream_writable(LOG_GET_LEFT_EXPRESSION_RC) << " vs. " << _LOG_IMPL_NAMESPACE::make_stream_writable(LOG_GET_RIGHT_EXPRESSION_RC) << ") "
 
 #define _LOG_CONDITIONED_BINARY_OP_EQ_GENERIC(leftExp, rightExp, loggingClass, errorCodeType, errorCode, handler) \
-_LOG_CONDITIONED_BINARY_OP_GENERIC(leftExp, rightExp, ==, std::equal_to, loggingClass, errorCodeType, errorCode, handler)
+_LOG_ENABLED_CONDITIONED_BINARY_OP_GENERIC(leftExp, rightExp, ==, std::equal_to, true, loggingClass, errorCodeType, errorCode, handler)
+
+#define _LOG_LEVELED_CONDITIONED_BINARY_OP_EQ_GENERIC(level, leftExp, rightExp, loggingClass, errorCodeType, errorCode, handler) \
+_LOG_ENABLED_CONDITIONED_BINARY_OP_GENERIC(leftExp, rightExp, ==, std::equal_to, _LOG_IS_LEVEL_ENABLED(level), loggingClass, errorCodeType, errorCode, handler)
 
 #define _LOG_CONDITIONED_BINARY_OP_NE_GENERIC(leftExp, rightExp, loggingClass, errorCodeType, errorCode, handler) \
-_LOG_CONDITIONED_BINARY_OP_GENERIC(leftExp, rightExp, != , std::not_equal_to, loggingClass, errorCodeType, errorCode, handler)
+_LOG_ENABLED_CONDITIONED_BINARY_OP_GENERIC(leftExp, rightExp, != , std::not_equal_to, true, loggingClass, errorCodeType, errorCode, handler)
+
+#define _LOG_LEVELED_CONDITIONED_BINARY_OP_NE_GENERIC(level, leftExp, rightExp, loggingClass, errorCodeType, errorCode, handler) \
+_LOG_ENABLED_CONDITIONED_BINARY_OP_GENERIC(leftExp, rightExp, != , std::not_equal_to, _LOG_IS_LEVEL_ENABLED(level), loggingClass, errorCodeType, errorCode, handler)
 
 #define _LOG_CONDITIONED_BINARY_OP_GE_GENERIC(leftExp, rightExp, loggingClass, errorCodeType, errorCode, handler) \
-_LOG_CONDITIONED_BINARY_OP_GENERIC(leftExp, rightExp, >= , std::greater_equal, loggingClass, errorCodeType, errorCode, handler)
+_LOG_ENABLED_CONDITIONED_BINARY_OP_GENERIC(leftExp, rightExp, >= , std::greater_equal, true, loggingClass, errorCodeType, errorCode, handler)
+
+#define _LOG_LEVELED_CONDITIONED_BINARY_OP_GE_GENERIC(level, leftExp, rightExp, loggingClass, errorCodeType, errorCode, handler) \
+_LOG_ENABLED_CONDITIONED_BINARY_OP_GENERIC(leftExp, rightExp, >= , std::greater_equal, _LOG_IS_LEVEL_ENABLED(level), loggingClass, errorCodeType, errorCode, handler)
 
 #define _LOG_CONDITIONED_BINARY_OP_GT_GENERIC(leftExp, rightExp, loggingClass, errorCodeType, errorCode, handler) \
-_LOG_CONDITIONED_BINARY_OP_GENERIC(leftExp, rightExp, > , std::greater, loggingClass, errorCodeType, errorCode, handler)
+_LOG_ENABLED_CONDITIONED_BINARY_OP_GENERIC(leftExp, rightExp, > , std::greater, true, loggingClass, errorCodeType, errorCode, handler)
+
+#define _LOG_LEVELED_CONDITIONED_BINARY_OP_GT_GENERIC(level, leftExp, rightExp, loggingClass, errorCodeType, errorCode, handler) \
+_LOG_ENABLED_CONDITIONED_BINARY_OP_GENERIC(leftExp, rightExp, > , std::greater, _LOG_IS_LEVEL_ENABLED(level), loggingClass, errorCodeType, errorCode, handler)
 
 #define _LOG_CONDITIONED_BINARY_OP_LE_GENERIC(leftExp, rightExp, loggingClass, errorCodeType, errorCode, handler) \
-_LOG_CONDITIONED_BINARY_OP_GENERIC(leftExp, rightExp, <= , std::less_equal, loggingClass, errorCodeType, errorCode, handler)
+_LOG_ENABLED_CONDITIONED_BINARY_OP_GENERIC(leftExp, rightExp, <= , std::less_equal, true, loggingClass, errorCodeType, errorCode, handler)
+
+#define _LOG_LEVELED_CONDITIONED_BINARY_OP_LE_GENERIC(level, leftExp, rightExp, loggingClass, errorCodeType, errorCode, handler) \
+_LOG_ENABLED_CONDITIONED_BINARY_OP_GENERIC(leftExp, rightExp, <= , std::less_equal, _LOG_IS_LEVEL_ENABLED(level), loggingClass, errorCodeType, errorCode, handler)
 
 #define _LOG_CONDITIONED_BINARY_OP_LT_GENERIC(leftExp, rightExp, loggingClass, errorCodeType, errorCode, handler) \
-_LOG_CONDITIONED_BINARY_OP_GENERIC(leftExp, rightExp, < , std::less, loggingClass, errorCodeType, errorCode, handler)
+_LOG_ENABLED_CONDITIONED_BINARY_OP_GENERIC(leftExp, rightExp, < , std::less, true, loggingClass, errorCodeType, errorCode, handler)
+
+#define _LOG_LEVELED_CONDITIONED_BINARY_OP_LT_GENERIC(level, leftExp, rightExp, loggingClass, errorCodeType, errorCode, handler) \
+_LOG_ENABLED_CONDITIONED_BINARY_OP_GENERIC(leftExp, rightExp, < , std::less, _LOG_IS_LEVEL_ENABLED(level), loggingClass, errorCodeType, errorCode, handler)
 
 
 /* ----------------------------- UNRECOVERABLE ERROR ----------------------------- */
@@ -421,7 +466,7 @@ _LOG_GENERIC(_LOG_RUNTIME_EXCEPTION_LOGGING_STREAM_CLASS, Base::ErrorCodeType::S
 /* ----------------------------- LOGGING ONLY ----------------------------- */
 #define L_LOG_IF_FAILED_WITH_FINALIZER(...) _PP_MACRO_OVERLOAD(_L_LOG_IF_FAILED_WITH_FINALIZER, __VA_ARGS__)
 #define _L_LOG_IF_FAILED_WITH_FINALIZER_4(condition, errorCodeType, errorCode, finalizer) \
-_LOG_CONDITIONED_GENERIC(condition, _LOG_EVENT_LOGGING_STREAM_CLASS, errorCodeType, errorCode, finalizer)
+_LOG_LEVELED_CONDITIONED_GENERIC(LOGGING_LEVEL_ERROR, condition, _LOG_EVENT_LOGGING_STREAM_CLASS, errorCodeType, errorCode, finalizer)
 #define _L_LOG_IF_FAILED_WITH_FINALIZER_3(condition, errorCode, finalizer) \
 _L_LOG_IF_FAILED_WITH_FINALIZER_4(condition, Base::ErrorCodeType::GENERIC, errorCode, finalizer)
 #define _L_LOG_IF_FAILED_WITH_FINALIZER_2(condition, finalizer) \
@@ -437,7 +482,7 @@ _L_LOG_IF_FAILED_2(condition, -1)
 
 #define L_LOG_IF_NOT_EQ_WITH_FINALIZER(...) _PP_MACRO_OVERLOAD(_L_LOG_IF_NOT_EQ_WITH_FINALIZER, __VA_ARGS__)
 #define _L_LOG_IF_NOT_EQ_WITH_FINALIZER_5(leftExp, rightExp, errorCodeType, errorCode, finalizer) \
-_LOG_CONDITIONED_BINARY_OP_EQ_GENERIC(leftExp, rightExp, _LOG_EVENT_LOGGING_STREAM_CLASS, errorCodeType, errorCode, finalizer)
+_LOG_LEVELED_CONDITIONED_BINARY_OP_EQ_GENERIC(LOGGING_LEVEL_ERROR, leftExp, rightExp, _LOG_EVENT_LOGGING_STREAM_CLASS, errorCodeType, errorCode, finalizer)
 #define _L_LOG_IF_NOT_EQ_WITH_FINALIZER_4(leftExp, rightExp, errorCode, finalizer) \
 _L_LOG_IF_NOT_EQ_WITH_FINALIZER_5(leftExp, rightExp, Base::ErrorCodeType::GENERIC, errorCode, finalizer)
 #define _L_LOG_IF_NOT_EQ_WITH_FINALIZER_3(leftExp, rightExp, finalizer) \
@@ -453,7 +498,7 @@ _L_LOG_IF_NOT_EQ_3(leftExp, rightExp, -1)
 
 #define L_LOG_IF_NOT_NE_WITH_FINALIZER(...) _PP_MACRO_OVERLOAD(_L_LOG_IF_NOT_NE_WITH_FINALIZER, __VA_ARGS__)
 #define _L_LOG_IF_NOT_NE_WITH_FINALIZER_5(leftExp, rightExp, errorCodeType, errorCode, finalizer) \
-_LOG_CONDITIONED_BINARY_OP_NE_GENERIC(leftExp, rightExp, _LOG_EVENT_LOGGING_STREAM_CLASS, errorCodeType, errorCode, finalizer)
+_LOG_LEVELED_CONDITIONED_BINARY_OP_NE_GENERIC(LOGGING_LEVEL_ERROR, leftExp, rightExp, _LOG_EVENT_LOGGING_STREAM_CLASS, errorCodeType, errorCode, finalizer)
 #define _L_LOG_IF_NOT_NE_WITH_FINALIZER_4(leftExp, rightExp, errorCode, finalizer) \
 _L_LOG_IF_NOT_NE_WITH_FINALIZER_5(leftExp, rightExp, Base::ErrorCodeType::GENERIC, errorCode, finalizer)
 #define _L_LOG_IF_NOT_NE_WITH_FINALIZER_3(leftExp, rightExp, finalizer) \
@@ -469,7 +514,7 @@ _L_LOG_IF_NOT_NE_3(leftExp, rightExp, -1)
 
 #define L_LOG_IF_NOT_GE_WITH_FINALIZER(...) _PP_MACRO_OVERLOAD(_L_LOG_IF_NOT_GE_WITH_FINALIZER, __VA_ARGS__)
 #define _L_LOG_IF_NOT_GE_WITH_FINALIZER_5(leftExp, rightExp, errorCodeType, errorCode, finalizer) \
-_LOG_CONDITIONED_BINARY_OP_GE_GENERIC(leftExp, rightExp, _LOG_EVENT_LOGGING_STREAM_CLASS, errorCodeType, errorCode, finalizer)
+_LOG_LEVELED_CONDITIONED_BINARY_OP_GE_GENERIC(LOGGING_LEVEL_ERROR, leftExp, rightExp, _LOG_EVENT_LOGGING_STREAM_CLASS, errorCodeType, errorCode, finalizer)
 #define _L_LOG_IF_NOT_GE_WITH_FINALIZER_4(leftExp, rightExp, errorCode, finalizer) \
 _L_LOG_IF_NOT_GE_WITH_FINALIZER_5(leftExp, rightExp, Base::ErrorCodeType::GENERIC, errorCode, finalizer)
 #define _L_LOG_IF_NOT_GE_WITH_FINALIZER_3(leftExp, rightExp, finalizer) \
@@ -485,7 +530,7 @@ _L_LOG_IF_NOT_GE_3(leftExp, rightExp, -1)
 
 #define L_LOG_IF_NOT_GT_WITH_FINALIZER(...) _PP_MACRO_OVERLOAD(_L_LOG_IF_NOT_GT_WITH_FINALIZER, __VA_ARGS__)
 #define _L_LOG_IF_NOT_GT_WITH_FINALIZER_5(leftExp, rightExp, errorCodeType, errorCode, finalizer) \
-_LOG_CONDITIONED_BINARY_OP_GT_GENERIC(leftExp, rightExp, _LOG_EVENT_LOGGING_STREAM_CLASS, errorCodeType, errorCode, finalizer)
+_LOG_LEVELED_CONDITIONED_BINARY_OP_GT_GENERIC(LOGGING_LEVEL_ERROR, leftExp, rightExp, _LOG_EVENT_LOGGING_STREAM_CLASS, errorCodeType, errorCode, finalizer)
 #define _L_LOG_IF_NOT_GT_WITH_FINALIZER_4(leftExp, rightExp, errorCode, finalizer) \
 _L_LOG_IF_NOT_GT_WITH_FINALIZER_5(leftExp, rightExp, Base::ErrorCodeType::GENERIC, errorCode, finalizer)
 #define _L_LOG_IF_NOT_GT_WITH_FINALIZER_3(leftExp, rightExp, finalizer) \
@@ -501,7 +546,7 @@ _L_LOG_IF_NOT_GT_3(leftExp, rightExp, -1)
 
 #define L_LOG_IF_NOT_LE_WITH_FINALIZER(...) _PP_MACRO_OVERLOAD(_L_LOG_IF_NOT_LE_WITH_FINALIZER, __VA_ARGS__)
 #define _L_LOG_IF_NOT_LE_WITH_FINALIZER_5(leftExp, rightExp, errorCodeType, errorCode, finalizer) \
-_LOG_CONDITIONED_BINARY_OP_LE_GENERIC(leftExp, rightExp, _LOG_EVENT_LOGGING_STREAM_CLASS, errorCodeType, errorCode, finalizer)
+_LOG_LEVELED_CONDITIONED_BINARY_OP_LE_GENERIC(LOGGING_LEVEL_ERROR, leftExp, rightExp, _LOG_EVENT_LOGGING_STREAM_CLASS, errorCodeType, errorCode, finalizer)
 #define _L_LOG_IF_NOT_LE_WITH_FINALIZER_4(leftExp, rightExp, errorCode, finalizer) \
 _L_LOG_IF_NOT_LE_WITH_FINALIZER_5(leftExp, rightExp, Base::ErrorCodeType::GENERIC, errorCode, finalizer)
 #define _L_LOG_IF_NOT_LE_WITH_FINALIZER_3(leftExp, rightExp, finalizer) \
@@ -517,7 +562,7 @@ _L_LOG_IF_NOT_LE_3(leftExp, rightExp, -1)
 
 #define L_LOG_IF_NOT_LT_WITH_FINALIZER(...) _PP_MACRO_OVERLOAD(_L_LOG_IF_NOT_LT_WITH_FINALIZER, __VA_ARGS__)
 #define _L_LOG_IF_NOT_LT_WITH_FINALIZER_5(leftExp, rightExp, errorCodeType, errorCode, finalizer) \
-_LOG_CONDITIONED_BINARY_OP_LT_GENERIC(leftExp, rightExp, _LOG_EVENT_LOGGING_STREAM_CLASS, errorCodeType, errorCode, finalizer)
+_LOG_LEVELED_CONDITIONED_BINARY_OP_LT_GENERIC(LOGGING_LEVEL_ERROR, leftExp, rightExp, _LOG_EVENT_LOGGING_STREAM_CLASS, errorCodeType, errorCode, finalizer)
 #define _L_LOG_IF_NOT_LT_WITH_FINALIZER_4(leftExp, rightExp, errorCode, finalizer) \
 _L_LOG_IF_NOT_LT_WITH_FINALIZER_5(leftExp, rightExp, Base::ErrorCodeType::GENERIC, errorCode, finalizer)
 #define _L_LOG_IF_NOT_LT_WITH_FINALIZER_3(leftExp, rightExp, finalizer) \
@@ -541,7 +586,28 @@ _L_LOG_IF_NOT_EQ_WITH_FINALIZER_5(leftExp, rightExp, Base::ErrorCodeType::STDCAP
 _L_LOG_IF_NOT_NE_WITH_FINALIZER_5(leftExp, rightExp, Base::ErrorCodeType::STDCAPI, errno, nullptr) << Base::getStdCApiErrorString(errno)
 
 #define L_LOG_ERROR \
-_LOG_GENERIC(_LOG_EVENT_LOGGING_STREAM_CLASS, Base::ErrorCodeType::GENERIC, -1, nullptr)
+_LOG_LEVELED_GENERIC(LOGGING_LEVEL_ERROR, _LOG_EVENT_LOGGING_STREAM_CLASS, Base::ErrorCodeType::GENERIC, -1, nullptr)
 
 #define L_LOG_STDCAPI_ERROR \
-_LOG_GENERIC(_LOG_EVENT_LOGGING_STREAM_CLASS, Base::ErrorCodeType::STDCAPI, errno, nullptr) << Base::getStdCApiErrorString(errno)
+_LOG_LEVELED_GENERIC(LOGGING_LEVEL_ERROR, _LOG_EVENT_LOGGING_STREAM_CLASS, Base::ErrorCodeType::STDCAPI, errno, nullptr) << Base::getStdCApiErrorString(errno)
+
+#if LOGGING_MINIMUM_LEVEL <= LOGGING_LEVEL_WARNING
+#define L_LOG_WARNING \
+_LOG_LEVELED_GENERIC(LOGGING_LEVEL_WARNING, _LOG_EVENT_LOGGING_STREAM_CLASS, Base::ErrorCodeType::GENERIC, -1, nullptr)
+#else
+#define L_LOG_WARNING _LOG_DISABLED_GENERIC
+#endif
+
+#if LOGGING_MINIMUM_LEVEL <= LOGGING_LEVEL_INFO
+#define L_LOG_INFO \
+_LOG_LEVELED_GENERIC(LOGGING_LEVEL_INFO, _LOG_EVENT_LOGGING_STREAM_CLASS, Base::ErrorCodeType::GENERIC, -1, nullptr)
+#else
+#define L_LOG_INFO _LOG_DISABLED_GENERIC
+#endif
+
+#if LOGGING_MINIMUM_LEVEL <= LOGGING_LEVEL_DEBUG
+#define L_LOG_DEBUG \
+_LOG_LEVELED_GENERIC(LOGGING_LEVEL_DEBUG, _LOG_EVENT_LOGGING_STREAM_CLASS, Base::ErrorCodeType::GENERIC, -1, nullptr)
+#else
+#define L_LOG_DEBUG _LOG_DISABLED_GENERIC
+#endif
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <base/logging/common.h>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace Base
+{
+	namespace Logging
+	{
+		namespace Details
+		{
+			enum class LoggingSiteType : uint8_t
+			{
+				MESSAGE,
+				CHECK,
+				BINARY_CHECK
+			};
+
+			// Static storage of one expansion of a logging macro, sinks cache what they derive from the site in it.
+			// Several sinks share it, so the value identifies the sink which stored it.
+			struct LoggingSiteSlot
+			{
+				std::atomic<uint64_t> value{ 0 };
+			};
+
+			// Static part of a message produced by a logging macro, all strings are literals
+			struct LoggingSite
+			{
+				LoggingSiteType type;
+				const char* file;
+				int line;
+				const char* function;
+				// CHECK uses the first one, BINARY_CHECK left expression, operator and right expression
+				const char* expressions[3];
+				// nullptr for sites not created by the logging macros
+				LoggingSiteSlot* slot;
+			};
+
+			// Every argument is encoded as a type tag followed by its value, sizes and integers are varints
+			enum class LoggingArgumentType : uint8_t
+			{
+				// size followed by the characters
+				STRING,
+				CHARACTER,
+				BOOLEAN,
+				// zigzag encoded
+				SIGNED_INTEGER,
+				UNSIGNED_INTEGER,
+				// raw double
+				FLOATING_POINT,
+				POINTER
+			};
+
+			struct LoggingArgument
+			{
+				LoggingArgumentType type;
+				// STRING
+				std::string_view string;
+				// CHARACTER, BOOLEAN, integers and POINTER, signed integers are cast
+				uint64_t integer;
+				double floatingPoint;
+			};
+
+			// A message kept as encoded arguments, text formatting is deferred to the reader
+			struct LoggingRecord
+			{
+				// nullptr for messages without a site
+				const LoggingSite* site;
+				// nanoseconds since the unix epoch
+				int64_t timestamp;
+				uint32_t threadId;
+				std::string_view arguments;
+			};
+
+			template <typename Buffer>
+			void appendVarint(Buffer& buffer, uint64_t value)
+			{
+				while (value >= 0x80)
+				{
+					buffer.push_back(char(value | 0x80));
+					value >>= 7;
+				}
+				buffer.push_back(char(value));
+			}
+
+			inline bool readVarint(std::string_view& data, uint64_t& value)
+			{
+				value = 0;
+				for (unsigned shift = 0; shift < 64; shift += 7)
+				{
+					if (data.empty())
+						return false;
+					const uint8_t byte = uint8_t(data[0]);
+					data.remove_prefix(1);
+					value |= uint64_t(byte & 0x7f) << shift;
+					if ((byte & 0x80) == 0)
+						return true;
+				}
+				return false;
+			}
+
+			inline uint64_t encodeZigzag(int64_t value)
+			{
+				return (uint64_t(value) << 1) ^ uint64_t(value >> 63);
+			}
+
+			inline int64_t decodeZigzag(uint64_t value)
+			{
+				return int64_t(value >> 1) ^ -int64_t(value & 1);
+			}
+
+			// small sequential id of the calling thread, starting from 1
+			LOGGING_INTERFACE
+			uint32_t getLoggingThreadId();
+			LOGGING_INTERFACE
+			int64_t getLoggingTimestamp();
+
+			// returns false if the arguments are malformed
+			LOGGING_INTERFACE
+			bool readLoggingArgument(std::string_view& arguments, LoggingArgument& argument);
+
+			// The functions below produce the same text as the formatting path of LoggingStream
+			LOGGING_INTERFACE
+			void formatLoggingSite(const LoggingSite& site, std::string& text);
+			// returns false if the arguments are malformed
+			LOGGING_INTERFACE
+			bool formatLoggingArguments(std::string_view arguments, std::string& text);
+			LOGGING_INTERFACE
+			void formatLoggingRecord(const LoggingRecord& record, std::string& text);
+		}
+	}
+}
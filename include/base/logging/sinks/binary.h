@@ -0,0 +1,84 @@
+#pragma once
+
+#include <base/logging/common.h>
+#include <base/logging/sinks/file.h>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace Base
+{
+	namespace Logging {
+		namespace Details
+		{
+			// File layout, sizes and integers are varints:
+			//   header:  "BLOG" uint32_t version, repeated when appending to an existing file
+			//   SITE:    uint8_t type, id, uint8_t LoggingSiteType, line, file, function, expressions
+			//   MESSAGE: uint8_t type, site id (0 if none), timestamp, thread id, arguments
+			//   TEXT:    uint8_t type, timestamp, thread id, text
+			// strings, expressions and arguments are prefixed with their size in bytes, arguments are
+			// encoded as described in base/logging/record.h. Timestamps are zigzag encoded differences
+			// to the previous record. Site ids start from 1 per header. Arguments are written as produced
+			// by LoggingStream, strings inline.
+			constexpr char binaryLogMagic[4] = { 'B', 'L', 'O', 'G' };
+			constexpr uint32_t binaryLogVersion = 1;
+
+			enum class BinaryLogRecordType : uint8_t
+			{
+				SITE = 1,
+				MESSAGE,
+				TEXT
+			};
+		}
+
+		// Stores the messages of the logging macros as records referencing a per file table of call
+		// sites, decode them with decodeBinaryLog or apps/binary_log_decoder. Messages logged as plain text are kept as
+		// TEXT records. Formatting is only skipped while all sinks are binary.
+		class LOGGING_INTERFACE BinaryFileSink : public FileSink
+		{
+		public:
+			// rotation is not supported, maxFileSize and maxFileAgeSeconds are ignored
+			BinaryFileSink(std::string_view path, const FileSinkOptions& options = FileSinkOptions());
+#ifdef _WIN32
+			BinaryFileSink(std::wstring_view path, const FileSinkOptions& options = FileSinkOptions());
+#endif
+			std::string_view getName() override;
+			void write(std::string_view message) override;
+			bool acceptsRecords() override;
+			void writeRecord(const Details::LoggingRecord& record) override;
+			~BinaryFileSink() override;
+		private:
+			// sites are identified by the addresses of their literals
+			struct SiteLess
+			{
+				bool operator()(const Details::LoggingSite& left, const Details::LoggingSite& right) const;
+			};
+
+			void writeHeader();
+			void writeText(std::string_view text, std::unique_lock<std::mutex>& lock);
+			void appendTimestamp(int64_t timestamp);
+			uint32_t getSiteId(const Details::LoggingSite& site);
+			void appendSite(const Details::LoggingSite& site, uint32_t siteId);
+
+			// tags the site ids cached in the slots of the call sites, unique per process
+			const uint64_t _number;
+			// guarded by the lock of FileSink from here on
+			std::map<Details::LoggingSite, uint32_t, SiteLess> _siteIds;
+			int64_t _lastTimestamp;
+			// definitions followed by the record being written
+			std::string _record;
+			// text of an unterminated line
+			std::string _pendingText;
+		};
+
+		// Passes the lines FileSink would have written for the records of a BinaryFileSink file to writeLine,
+		// without line breaks. printTimestamps prefixes them with the UTC time and thread id of the record.
+		// Returns false if data is truncated or corrupted, the lines before the damage are passed anyway.
+		LOGGING_INTERFACE
+		bool decodeBinaryLog(std::string_view data, bool printTimestamps, const std::function<void(std::string_view)>& writeLine);
+	}
+}
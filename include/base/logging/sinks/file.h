@@ -3,20 +3,101 @@
 #include <base/logging/common.h>
 #include <base/logging/sinks/interface.h>
 
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
 namespace Base
 {
 	namespace Logging {
+		struct FileSinkOptions
+		{
+			// messages are collected in buffers of this size and written by a background thread
+			size_t bufferSize = 1024 * 1024;
+			// producers wait for the background thread once this many full buffers are queued
+			unsigned maxPendingBuffers = 4;
+			// partially filled buffers are written at least this often
+			unsigned flushIntervalMilliseconds = 1000;
+			// written data is synced to the storage device at most this often, 0 disables syncing
+			unsigned syncIntervalMilliseconds = 0;
+			// the file is rotated once it grows beyond this size, 0 disables size based rotation
+			uint64_t maxFileSize = 0;
+			// the file is rotated once it was opened this long ago, 0 disables age based rotation
+			unsigned maxFileAgeSeconds = 0;
+			// rotated files are kept as path.1 (newest) to path.N
+			unsigned maxRotatedFiles = 5;
+			// an existing file is truncated instead of appended to
+			bool truncate = true;
+		};
+
 		class LOGGING_INTERFACE FileSink : public Sink
 		{
 		public:
-			FileSink(std::string_view path);
-			FileSink(std::wstring_view path);
+			FileSink(std::string_view path, const FileSinkOptions& options = FileSinkOptions());
+#ifdef _WIN32
+			FileSink(std::wstring_view path, const FileSinkOptions& options = FileSinkOptions());
+#endif
+			FileSink(const FileSink&) = delete;
 			std::string_view getName() override;
 			void write(std::string_view message) override;
+			// returns once everything written so far reached the operating system
 			void flush() override;
 			~FileSink() override;
+		protected:
+			// with lineBased unset, buffers are handed over at the boundaries of write calls instead of lines
+			FileSink(std::string_view path, const FileSinkOptions& options, bool lineBased);
+#ifdef _WIN32
+			FileSink(std::wstring_view path, const FileSinkOptions& options, bool lineBased);
+#endif
+			// lets derived sinks guard their own state with the lock of the buffers
+			[[nodiscard]] std::unique_lock<std::mutex> lockBuffers();
+			// lock must be held, it may be released while waiting for the background thread
+			void write(std::string_view message, std::unique_lock<std::mutex>& lock);
 		private:
-			FILE* _file;
+			void initialize();
+			bool openFile(bool truncate);
+			void closeFile();
+			void rotate();
+			bool writeToFile(const std::vector<std::string>& buffers);
+			void syncFile();
+			void submitActiveBuffer(std::unique_lock<std::mutex>& lock);
+			std::string takeFreeBuffer();
+			void throwIfFailed();
+			void run();
+
+#ifdef _WIN32
+			std::wstring _path;
+			void* _file;
+#else
+			std::string _path;
+			int _file;
+#endif
+			FileSinkOptions _options;
+			bool _lineBased;
+
+			std::mutex _mutex;
+			std::condition_variable _writerCondition;
+			std::condition_variable _producerCondition;
+			std::string _activeBuffer;
+			std::vector<std::string> _pendingBuffers;
+			std::vector<std::string> _freeBuffers;
+			uint64_t _submittedBuffers;
+			uint64_t _writtenBuffers;
+			bool _stopRequested;
+			// error code of the operating system, set by the background thread
+			int64_t _error;
+			std::thread _writer;
+
+			// accessed by the background thread only
+			uint64_t _fileSize;
+			bool _endsWithNewLine;
+			std::chrono::steady_clock::time_point _fileOpenTime;
+			std::chrono::steady_clock::time_point _lastSyncTime;
+			bool _hasUnsyncedData;
 		};
 	}
 }
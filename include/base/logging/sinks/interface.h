@@ -1,4 +1,5 @@
 #pragma once
+#include <base/logging/record.h>
 #include <string_view>
 
 namespace Base
@@ -12,6 +13,10 @@ namespace Base
 			virtual std::string_view getName() = 0;
 			virtual void write(std::string_view message) = 0;
 			virtual void flush() = 0;
+			// Messages of the logging macros are passed to writeRecord without being formatted
+			// as long as every registered sink returns true here
+			virtual bool acceptsRecords() { return false; }
+			virtual void writeRecord(const Details::LoggingRecord&) {}
 		};
 	}
 }
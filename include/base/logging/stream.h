@@ -0,0 +1,145 @@
+#pragma once
+
+#include <base/logging/common.h>
+#include <base/logging/record.h>
+#include <cstddef>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace Base
+{
+	namespace Logging
+	{
+		namespace Details
+		{
+			struct LoggingBuffer;
+
+			constexpr size_t getBaseFileNameOffset(const char* path)
+			{
+				size_t offset = 0;
+				for (size_t index = 0; path[index] != '\0'; ++index)
+				{
+					if (path[index] == '/' || path[index] == '\\')
+						offset = index + 1;
+				}
+				return offset;
+			}
+
+			// [file:line function]
+			struct LoggingHeader
+			{
+				const char* file;
+				int line;
+				const char* function;
+				LoggingSiteSlot* slot;
+			};
+
+			// [file:line function] Check failed: expression
+			struct LoggingCheckHeader
+			{
+				LoggingHeader header;
+				const char* expression;
+			};
+
+			// [file:line function] Check failed: leftExpression op rightExpression
+			struct LoggingBinaryCheckHeader
+			{
+				LoggingHeader header;
+				const char* leftExpression;
+				const char* op;
+				const char* rightExpression;
+			};
+
+			// Formats a logging message into a reusable thread local buffer with fmt.
+			// Strings and arithmetic values are appended directly, other types and
+			// manipulators go through a std::ostream adapter writing into the same buffer.
+			// When all sinks accept structured records, the header is kept as a LoggingSite and
+			// values are stored in their binary encoding instead, see base/logging/record.h.
+			class LOGGING_INTERFACE LoggingStream
+			{
+			public:
+				LoggingStream();
+				LoggingStream(const LoggingStream&) = delete;
+				LoggingStream& operator=(const LoggingStream&) = delete;
+				~LoggingStream();
+
+				LoggingStream& operator<<(std::string_view value);
+				// Taken by reference so that string literals and character arrays prefer the overload below
+				template <typename Char, typename = std::enable_if_t<std::is_same<std::remove_const_t<Char>, char>::value>>
+				LoggingStream& operator<<(Char* const& value)
+				{
+					return writeString(value);
+				}
+				// The length of string literals and arrays is bounded by their size
+				template <size_t Size>
+				LoggingStream& operator<<(const char (&value)[Size])
+				{
+					const void* end = memchr(value, '\0', Size);
+					return *this << std::string_view(value, end ? size_t(static_cast<const char*>(end) - value) : Size);
+				}
+				LoggingStream& operator<<(const std::string& value);
+				LoggingStream& operator<<(char value);
+				LoggingStream& operator<<(signed char value);
+				LoggingStream& operator<<(unsigned char value);
+				LoggingStream& operator<<(bool value);
+				LoggingStream& operator<<(short value);
+				LoggingStream& operator<<(unsigned short value);
+				LoggingStream& operator<<(int value);
+				LoggingStream& operator<<(unsigned int value);
+				LoggingStream& operator<<(long value);
+				LoggingStream& operator<<(unsigned long value);
+				LoggingStream& operator<<(long long value);
+				LoggingStream& operator<<(unsigned long long value);
+				LoggingStream& operator<<(float value);
+				LoggingStream& operator<<(double value);
+				LoggingStream& operator<<(long double value);
+				LoggingStream& operator<<(const void* value);
+				LoggingStream& operator<<(std::nullptr_t);
+				LoggingStream& operator<<(const LoggingHeader& header);
+				LoggingStream& operator<<(const LoggingCheckHeader& header);
+				LoggingStream& operator<<(const LoggingBinaryCheckHeader& header);
+
+				LoggingStream& operator<<(std::ostream& (*manipulator)(std::ostream&));
+				LoggingStream& operator<<(std::ios_base& (*manipulator)(std::ios_base&));
+
+				template <typename Type, typename = std::enable_if_t<
+					!std::is_arithmetic<Type>::value && !std::is_convertible<const Type&, std::string_view>::value>>
+				LoggingStream& operator<<(const Type& value)
+				{
+					std::ostream& stream = beginOStreamWrite();
+					stream << value;
+					endOStreamWrite();
+					return *this;
+				}
+
+				[[nodiscard]] bool isRecord() const;
+				// only valid in record mode, the timestamp is taken at the call
+				[[nodiscard]] LoggingRecord record() const;
+				// only valid in text mode
+				[[nodiscard]] std::string_view view() const;
+				// formats the record in record mode
+				[[nodiscard]] std::string str() const;
+			private:
+				std::ostream& beginOStreamWrite();
+				void endOStreamWrite();
+				void setSite(const LoggingSite& site);
+				LoggingStream& writeString(const char* value);
+
+				LoggingBuffer* _buffer;
+				// set once a manipulator changed the formatting state, the remaining values honor it
+				bool _useOStream;
+				bool _record;
+				bool _hasSite;
+				LoggingSite _site;
+				// offset of the size of the string argument written by the std::ostream adapter
+				size_t _oStreamArgumentOffset;
+			};
+		}
+	}
+}
+
+#define _LOG_BASE_FILE_NAME \
+(__FILE__ + std::integral_constant<size_t, Base::Logging::Details::getBaseFileNameOffset(__FILE__)>::value)
@@ -8,6 +8,16 @@ namespace Base
 		return __builtin_cpu_supports("avx") > 0;
 	}
 
+	bool hasAVX2()
+	{
+		return __builtin_cpu_supports("avx2") > 0;
+	}
+
+	bool hasF16C()
+	{
+		return __builtin_cpu_supports("f16c") > 0;
+	}
+
 	bool hasAVX512f()
 	{
 		return __builtin_cpu_supports("avx512f") > 0;
@@ -9,6 +9,14 @@ namespace Base
 	{
 		return InstructionSet::AVX();
 	}
+	bool hasAVX2()
+	{
+		return InstructionSet::AVX2();
+	}
+	bool hasF16C()
+	{
+		return InstructionSet::F16C();
+	}
 	bool hasAVX512f()
 	{
 		return InstructionSet::AVX512F();
@@ -0,0 +1,89 @@
+#include <base/ext/img_codecs/batch_decoder.h>
+
+#include <base/logging.h>
+
+#include <atomic>
+#include <chrono>
+#include <exception>
+
+namespace Base
+{
+	double BatchImageDecodeStatistics::getImagesPerSecond() const
+	{
+		if (seconds <= 0)
+			return 0;
+		return double(numberOfImages) / seconds;
+	}
+
+	BatchImageDecoder::BatchImageDecoder(unsigned numberOfThreads)
+		: _threadPool(numberOfThreads), _decoders(_threadPool.getNumberOfThreads())
+	{
+	}
+
+	unsigned BatchImageDecoder::getNumberOfThreads() const
+	{
+		return _threadPool.getNumberOfThreads();
+	}
+
+	void BatchImageDecoder::setOutputFormat(PixelFormat format, unsigned rowAlignment)
+	{
+		for (auto& decoder : _decoders)
+			decoder.setOutputFormat(format, rowAlignment);
+	}
+
+	BatchImageDecodeStatistics BatchImageDecoder::decode(const ImageDecodeJob* jobs, size_t numberOfJobs, ImageDecodeResult* results)
+	{
+		std::atomic<size_t> numberOfFailures(0);
+		std::atomic<uint64_t> compressedBytes(0), decompressedBytes(0);
+
+		const auto begin = std::chrono::steady_clock::now();
+		_threadPool.parallelFor(numberOfJobs, [&](unsigned workerIndex, size_t index)
+		{
+			const ImageDecodeJob& job = jobs[index];
+			ImageDecodeResult& result = results[index];
+			result.succeeded = false;
+			result.width = result.height = 0;
+			result.rowStride = 0;
+			result.error.clear();
+			try
+			{
+				ImageDecoder& decoder = _decoders[workerIndex];
+				if (job.format == ImageFormatType::UNKNOWN)
+					decoder.load(job.buffer, job.size);
+				else
+					decoder.load(job.buffer, job.size, job.format);
+				if (job.targetWidth != 0 || job.targetHeight != 0)
+					decoder.setTargetSize(job.targetWidth, job.targetHeight);
+				result.width = decoder.getWidth();
+				result.height = decoder.getHeight();
+				result.rowStride = decoder.getRowStride();
+				const uint64_t decompressedSize = decoder.getDecompressedSize();
+				L_CHECK_LE(decompressedSize, job.outputSize) << "Output buffer too small for a " << result.width << "x" << result.height << " image";
+				decoder.decode(job.output);
+				result.succeeded = true;
+				compressedBytes.fetch_add(job.size, std::memory_order_relaxed);
+				decompressedBytes.fetch_add(decompressedSize, std::memory_order_relaxed);
+			}
+			catch (std::exception& exception)
+			{
+				result.error = exception.what();
+				numberOfFailures.fetch_add(1, std::memory_order_relaxed);
+			}
+		});
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+		BatchImageDecodeStatistics statistics;
+		statistics.numberOfImages = numberOfJobs;
+		statistics.numberOfFailures = numberOfFailures.load();
+		statistics.compressedBytes = compressedBytes.load();
+		statistics.decompressedBytes = decompressedBytes.load();
+		statistics.seconds = elapsed.count();
+		return statistics;
+	}
+
+	BatchImageDecodeStatistics BatchImageDecoder::decode(const std::vector<ImageDecodeJob>& jobs, std::vector<ImageDecodeResult>& results)
+	{
+		results.resize(jobs.size());
+		return decode(jobs.data(), jobs.size(), results.data());
+	}
+}
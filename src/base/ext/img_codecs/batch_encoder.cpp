@@ -0,0 +1,79 @@
+#ifdef HAVE_LIB_JPEG
+#include <base/ext/img_codecs/batch_encoder.h>
+
+#include <atomic>
+#include <chrono>
+#include <exception>
+
+namespace Base
+{
+	double BatchJPEGEncodeStatistics::getImagesPerSecond() const
+	{
+		if (seconds <= 0)
+			return 0;
+		return double(numberOfImages) / seconds;
+	}
+
+	BatchJPEGEncoder::BatchJPEGEncoder(unsigned numberOfThreads)
+		: _threadPool(numberOfThreads), _encoders(_threadPool.getNumberOfThreads())
+	{
+	}
+
+	unsigned BatchJPEGEncoder::getNumberOfThreads() const
+	{
+		return _threadPool.getNumberOfThreads();
+	}
+
+	void BatchJPEGEncoder::setOptions(const JPEGEncodeOptions& options)
+	{
+		// rejects invalid options before the batch
+		JPEGEncoder::validateOptions(options);
+		_options = options;
+	}
+
+	BatchJPEGEncodeStatistics BatchJPEGEncoder::encode(const JPEGEncodeJob* jobs, size_t numberOfJobs, JPEGEncodeResult* results)
+	{
+		std::atomic<size_t> numberOfFailures(0);
+		std::atomic<uint64_t> uncompressedBytes(0), compressedBytes(0);
+
+		const auto begin = std::chrono::steady_clock::now();
+		_threadPool.parallelFor(numberOfJobs, [&](unsigned, size_t index)
+		{
+			const JPEGEncodeJob& job = jobs[index];
+			JPEGEncodeResult& result = results[index];
+			result.succeeded = false;
+			result.size = 0;
+			result.error.clear();
+			try
+			{
+				auto encoder = _encoders.acquire();
+				encoder->setOptions(_options);
+				result.size = encoder->encode(job.rgb, job.width, job.height, job.output, job.outputSize);
+				result.succeeded = true;
+				uncompressedBytes.fetch_add(uint64_t(job.width) * job.height * 3, std::memory_order_relaxed);
+				compressedBytes.fetch_add(result.size, std::memory_order_relaxed);
+			}
+			catch (std::exception& exception)
+			{
+				result.error = exception.what();
+				numberOfFailures.fetch_add(1, std::memory_order_relaxed);
+			}
+		});
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+		BatchJPEGEncodeStatistics statistics;
+		statistics.numberOfImages = numberOfJobs;
+		statistics.numberOfFailures = numberOfFailures.load();
+		statistics.uncompressedBytes = uncompressedBytes.load();
+		statistics.compressedBytes = compressedBytes.load();
+		statistics.seconds = elapsed.count();
+		return statistics;
+	}
+
+	BatchJPEGEncodeStatistics BatchJPEGEncoder::encode(const std::vector<JPEGEncodeJob>& jobs, std::vector<JPEGEncodeResult>& results)
+	{
+		results.resize(jobs.size());
+		return encode(jobs.data(), jobs.size(), results.data());
+	}
+}
+#endif
@@ -2,125 +2,345 @@
 
 #include <base/logging.h>
 
+#include <cstddef>
+#include <cstring>
+#include <utility>
+
 namespace Base
 {
-    void ImageDecoder::load(const void *buffer, size_t size, ImageFormatType formatType)
+    // Writes row of the width x height stored image, of pixelSize bytes per pixel, to its place in the upright image
+    static void orientRow(ImageOrientation orientation, const unsigned char *source, unsigned row, unsigned width, unsigned height,
+        size_t pixelSize, unsigned char *destination, size_t rowStride)
     {
-        _format = formatType;
-        switch (formatType)
+        // the place of the first pixel and the distance to the next one
+        ptrdiff_t step;
+        switch (orientation)
         {
-#if (defined HAVE_LIB_JPEG) || (defined HAVE_LIB_JPEG_TURBO)
-            case ImageFormatType::JPEG:
-                _jpegDecoder.load(buffer, size);
-                break;
-#endif
-#if (defined HAVE_LIB_PNG)
-            case ImageFormatType::PNG:
-                _pngDecoder.load(buffer, size);
-                break;
-#endif
-#if (defined HAVE_LIB_WEBP)
-            case ImageFormatType::WEBP:
-                _webpDecoder.load(buffer, size);
-                break;
-#endif
-			default:
-				L_NOT_IMPLEMENTED_ERROR;
+        case ImageOrientation::FLIP_HORIZONTAL:
+            destination += row * rowStride + (width - 1) * pixelSize;
+            step = -ptrdiff_t(pixelSize);
+            break;
+        case ImageOrientation::ROTATE_180:
+            destination += (height - 1 - row) * rowStride + (width - 1) * pixelSize;
+            step = -ptrdiff_t(pixelSize);
+            break;
+        case ImageOrientation::FLIP_VERTICAL:
+            memcpy(destination + (height - 1 - row) * rowStride, source, width * pixelSize);
+            return;
+        case ImageOrientation::TRANSPOSE:
+            destination += row * pixelSize;
+            step = ptrdiff_t(rowStride);
+            break;
+        case ImageOrientation::ROTATE_90:
+            destination += (height - 1 - row) * pixelSize;
+            step = ptrdiff_t(rowStride);
+            break;
+        case ImageOrientation::TRANSVERSE:
+            destination += (width - 1) * rowStride + (height - 1 - row) * pixelSize;
+            step = -ptrdiff_t(rowStride);
+            break;
+        case ImageOrientation::ROTATE_270:
+            destination += (width - 1) * rowStride + row * pixelSize;
+            step = -ptrdiff_t(rowStride);
+            break;
+        default:
+            memcpy(destination + row * rowStride, source, width * pixelSize);
+            return;
         }
+        for (unsigned x = 0; x < width; ++x, source += pixelSize, destination += step)
+            memcpy(destination, source, pixelSize);
     }
 
-	unsigned ImageDecoder::getHeight() const {
-        switch (_format)
+    ImageDecoder::ImageDecoder()
+        : _backend(nullptr), _format(ImageFormatType::UNKNOWN), _orientation(ImageOrientation::NORMAL)
+    {
+    }
+
+    void ImageDecoder::setBackend(ImageFormatType format, const std::string &name)
+    {
+        if (name.empty())
+            _backendNames.erase(format);
+        else
+            _backendNames[format] = name;
+    }
+
+    void ImageDecoder::setBackendSelector(ImageDecoderBackendSelector selector)
+    {
+        _backendSelector = std::move(selector);
+    }
+
+    void ImageDecoder::reset()
+    {
+        _backendNames.clear();
+        _backendSelector = nullptr;
+        setOptions(ImageDecodeOptions());
+        _backendInfo = nullptr;
+        _backend = nullptr;
+        _format = ImageFormatType::UNKNOWN;
+        _orientation = ImageOrientation::NORMAL;
+    }
+
+	const ImageDecoderBackendInfo &ImageDecoder::getBackendInfo() const {
+        L_CHECK(_backendInfo) << "No image is loaded";
+        return *_backendInfo;
+    }
+
+    void ImageDecoder::load(const void *buffer, size_t size, ImageFormatType formatType)
+    {
+        const ImageDecoderBackendRegistry &registry = ImageDecoderBackendRegistry::getInstance();
+        std::shared_ptr<const ImageDecoderBackendInfo> backendInfo;
+        const auto backendName = _backendNames.find(formatType);
+        if (backendName != _backendNames.end())
         {
-#if (defined HAVE_LIB_JPEG) || (defined HAVE_LIB_JPEG_TURBO)
-            case ImageFormatType::JPEG:
-                return _jpegDecoder.getHeight();
-                break;
-#endif
-#if (defined HAVE_LIB_PNG)
-            case ImageFormatType::PNG:
-                return _pngDecoder.getHeight();
-                break;
-#endif
-#if (defined HAVE_LIB_WEBP)
-            case ImageFormatType::WEBP:
-                return _webpDecoder.getHeight();
-                break;
-#endif
-			default:
-				L_NOT_IMPLEMENTED_ERROR;
-				return 0;
+            backendInfo = registry.getBackend(backendName->second);
+            L_CHECK(backendInfo && backendInfo->format == formatType) << "No backend " << backendName->second << " for the image format";
         }
+        else
+        {
+            const auto candidates = registry.getBackends(formatType);
+            if (candidates->empty())
+                L_NOT_IMPLEMENTED_ERROR;
+            const size_t index = _backendSelector ? _backendSelector(formatType, buffer, size, *candidates) : 0;
+            L_CHECK_LT(index, candidates->size());
+            backendInfo = (*candidates)[index];
+        }
+
+        // a backend registered again under the same name replaces the instance of the previous registration
+        auto cached = _backends.begin();
+        while (cached != _backends.end() && cached->first->name != backendInfo->name)
+            ++cached;
+        if (cached == _backends.end() || cached->first != backendInfo)
+        {
+            std::unique_ptr<ImageDecoderBackend> backend = backendInfo->factory();
+            backend->setOptions(_options);
+            if (cached == _backends.end())
+                cached = _backends.emplace(_backends.end(), backendInfo, std::move(backend));
+            else
+                *cached = std::make_pair(backendInfo, std::move(backend));
+        }
+        _backend = cached->second.get();
+        _backendInfo = std::move(backendInfo);
+        _format = formatType;
+        _orientation = ImageOrientation::NORMAL;
+        _backend->load(buffer, size);
+        if (_options.applyOrientation)
+            _orientation = getImageOrientation(buffer, size);
+    }
+
+    void ImageDecoder::load(const void *buffer, size_t size)
+    {
+        const ImageFormatType formatType = detectImageFormat(buffer, size);
+        L_CHECK_NE(formatType, ImageFormatType::UNKNOWN) << "Unrecognized image format";
+        load(buffer, size, formatType);
+    }
+
+	ImageFormatType ImageDecoder::getFormat() const {
+        return _format;
+    }
+
+	ImageOrientation ImageDecoder::getOrientation() const {
+        return _orientation;
+    }
+
+    bool ImageDecoder::isTransposed() const
+    {
+        return _orientation >= ImageOrientation::TRANSPOSE;
+    }
+
+    ImageDecoderBackend &ImageDecoder::getBackend() const
+    {
+        L_CHECK(_backend) << "No image is loaded";
+        return *_backend;
+    }
+
+    void ImageDecoder::setTargetSize(unsigned width, unsigned height)
+    {
+        if (!getBackendInfo().capabilities.scaling)
+            return;
+        if (isTransposed())
+            _backend->setTargetSize(height, width);
+        else
+            _backend->setTargetSize(width, height);
+    }
+
+	unsigned ImageDecoder::getHeight() const {
+        return isTransposed() ? getBackend().getWidth() : getBackend().getHeight();
     }
 
 	unsigned ImageDecoder::getWidth() const {
-        switch (_format)
+        return isTransposed() ? getBackend().getHeight() : getBackend().getWidth();
+    }
+
+	uint64_t ImageDecoder::getDecompressedSize() const {
+        if (_orientation == ImageOrientation::NORMAL)
+            return getBackend().getDecompressedSize();
+        return getImageSize(getHeight(), getOutputFormat(), getRowStride());
+    }
+
+    void ImageDecoder::setOutputFormat(PixelFormat format, unsigned rowAlignment)
+    {
+        ImageDecodeOptions options = _options;
+        options.format = format;
+        options.rowAlignment = rowAlignment;
+        setOptions(options);
+    }
+
+    void ImageDecoder::setOptions(const ImageDecodeOptions &options)
+    {
+        L_CHECK_NE(options.rowAlignment, 0);
+        for (auto &backend : _backends)
+            backend.second->setOptions(options);
+        _options = options;
+    }
+
+	const ImageDecodeOptions &ImageDecoder::getOptions() const {
+        return _options;
+    }
+
+	PixelFormat ImageDecoder::getOutputFormat() const {
+        return _backend ? _backend->getOutputFormat() : _options.format;
+    }
+
+	unsigned ImageDecoder::getBytesPerChannel() const {
+        return _backend ? _backend->getBytesPerChannel() : 1;
+    }
+
+	size_t ImageDecoder::getRowStride() const {
+        if (_orientation == ImageOrientation::NORMAL)
+            return getBackend().getRowStride();
+        return getImageRowStride(getWidth() * getBytesPerChannel(), getOutputFormat(), _options.rowAlignment);
+    }
+
+    void ImageDecoder::decode(void *output) {
+        if (_orientation == ImageOrientation::NORMAL)
+            getBackend().decode(output);
+        else
+            decodeOriented(output);
+    }
+
+    // Writes the stored rows straight to their places in output, packed rows of backends capable of row
+    // decoding as they are passed, without a separate rotation of the whole image
+    void ImageDecoder::decodeOriented(void *output) {
+        const PixelFormat format = getOutputFormat();
+        const size_t pixelSize = getPixelSize(format) * getBytesPerChannel();
+        const unsigned width = _backend->getWidth(), height = _backend->getHeight();
+        const size_t rowStride = getRowStride();
+        const uint64_t planeSize = uint64_t(rowStride) * getHeight();
+        unsigned char *destination = (unsigned char *)output;
+        if (getBackendInfo().capabilities.rowDecoding && getNumberOfPlanes(format) == 1)
         {
-#if (defined HAVE_LIB_JPEG) || (defined HAVE_LIB_JPEG_TURBO)
-            case ImageFormatType::JPEG:
-                return _jpegDecoder.getWidth();
-                break;
-#endif
-#if (defined HAVE_LIB_PNG)
-            case ImageFormatType::PNG:
-                return _pngDecoder.getWidth();
-                break;
-#endif
-#if (defined HAVE_LIB_WEBP)
-            case ImageFormatType::WEBP:
-                return _webpDecoder.getWidth();
-                break;
-#endif
-			default:
-				L_NOT_IMPLEMENTED_ERROR;
-				return 0;
+            unsigned row = 0;
+            _backend->decodeRows([&](const unsigned char *data) {
+                orientRow(_orientation, data, row++, width, height, pixelSize, destination, rowStride);
+            });
+            return;
         }
+        _orientationBuffer.resize(_backend->getDecompressedSize());
+        _backend->decode(_orientationBuffer.data());
+        const size_t sourceRowStride = _backend->getRowStride();
+        const uint64_t sourcePlaneSize = uint64_t(sourceRowStride) * height;
+        for (unsigned plane = 0; plane < getNumberOfPlanes(format); ++plane)
+            for (unsigned row = 0; row < height; ++row)
+                orientRow(_orientation, _orientationBuffer.data() + plane * sourcePlaneSize + row * sourceRowStride, row, width, height,
+                    pixelSize, destination + plane * planeSize, rowStride);
     }
 
-	uint64_t ImageDecoder::getDecompressedSize() const {
-        switch (_format)
+    void ImageDecoder::decodeRegion(unsigned x, unsigned y, unsigned width, unsigned height, void *output) {
+        if (_orientation == ImageOrientation::NORMAL)
+        {
+            decodeStoredRegion(x, y, width, height, output);
+            return;
+        }
+        L_CHECK_LE(uint64_t(x) + width, getWidth());
+        L_CHECK_LE(uint64_t(y) + height, getHeight());
+        // the rectangle of the stored image turning into the region
+        const unsigned imageWidth = _backend->getWidth(), imageHeight = _backend->getHeight();
+        unsigned storedX = x, storedY = y, storedWidth = width, storedHeight = height;
+        if (isTransposed())
+        {
+            std::swap(storedX, storedY);
+            std::swap(storedWidth, storedHeight);
+        }
+        switch (_orientation)
         {
-#if (defined HAVE_LIB_JPEG) || (defined HAVE_LIB_JPEG_TURBO)
-            case ImageFormatType::JPEG:
-                return _jpegDecoder.getDecompressedSize();
-                break;
-#endif
-#if (defined HAVE_LIB_PNG)
-            case ImageFormatType::PNG:
-                return _pngDecoder.getDecompressedSize();
-                break;
-#endif
-#if (defined HAVE_LIB_WEBP)
-            case ImageFormatType::WEBP:
-                return _webpDecoder.getDecompressedSize();
-                break;
-#endif
-			default:
-				L_NOT_IMPLEMENTED_ERROR;
-				return 0;
+        case ImageOrientation::FLIP_HORIZONTAL:
+        case ImageOrientation::ROTATE_270:
+            storedX = imageWidth - storedX - storedWidth;
+            break;
+        case ImageOrientation::FLIP_VERTICAL:
+        case ImageOrientation::ROTATE_90:
+            storedY = imageHeight - storedY - storedHeight;
+            break;
+        case ImageOrientation::ROTATE_180:
+        case ImageOrientation::TRANSVERSE:
+            storedX = imageWidth - storedX - storedWidth;
+            storedY = imageHeight - storedY - storedHeight;
+            break;
+        default:
+            break;
         }
+        const PixelFormat format = getOutputFormat();
+        const size_t storedRowStride = getImageRowStride(storedWidth * getBytesPerChannel(), format, _options.rowAlignment);
+        const uint64_t storedPlaneSize = uint64_t(storedRowStride) * storedHeight;
+        _orientationBuffer.resize(storedPlaneSize * getNumberOfPlanes(format));
+        decodeStoredRegion(storedX, storedY, storedWidth, storedHeight, _orientationBuffer.data());
+
+        const size_t pixelSize = getPixelSize(format) * getBytesPerChannel();
+        const size_t rowStride = getImageRowStride(width * getBytesPerChannel(), format, _options.rowAlignment);
+        const uint64_t planeSize = uint64_t(rowStride) * height;
+        for (unsigned plane = 0; plane < getNumberOfPlanes(format); ++plane)
+            for (unsigned row = 0; row < storedHeight; ++row)
+                orientRow(_orientation, _orientationBuffer.data() + plane * storedPlaneSize + row * storedRowStride, row, storedWidth, storedHeight,
+                    pixelSize, (unsigned char *)output + plane * planeSize, rowStride);
     }
 
-    void ImageDecoder::decode(void *output) {
-        switch (_format)
+    void ImageDecoder::decodeStoredRegion(unsigned x, unsigned y, unsigned width, unsigned height, void *output) {
+        if (getBackendInfo().capabilities.regionDecoding)
+        {
+            _backend->decodeRegion(x, y, width, height, output);
+            return;
+        }
+        L_CHECK_LE(uint64_t(x) + width, _backend->getWidth());
+        L_CHECK_LE(uint64_t(y) + height, _backend->getHeight());
+        _regionBuffer.resize(_backend->getDecompressedSize());
+        _backend->decode(_regionBuffer.data());
+
+        const PixelFormat format = getOutputFormat();
+        const size_t imageRowStride = _backend->getRowStride();
+        const uint64_t imagePlaneSize = uint64_t(imageRowStride) * _backend->getHeight();
+        const size_t rowStride = getImageRowStride(width * getBytesPerChannel(), format, _options.rowAlignment);
+        const size_t pixelSize = getPixelSize(format) * getBytesPerChannel();
+        unsigned char *currentOutput = (unsigned char *)output;
+        for (unsigned plane = 0; plane < getNumberOfPlanes(format); ++plane)
         {
-#if (defined HAVE_LIB_JPEG) || (defined HAVE_LIB_JPEG_TURBO)
-            case ImageFormatType::JPEG:
-                _jpegDecoder.decode(output);
-                break;
-#endif
-#if (defined HAVE_LIB_PNG)
-            case ImageFormatType::PNG:
-                _pngDecoder.decode(output);
-                break;
-#endif
-#if (defined HAVE_LIB_WEBP)
-            case ImageFormatType::WEBP:
-                _webpDecoder.decode(output);
-                break;
-#endif
-			default:
-				L_NOT_IMPLEMENTED_ERROR;
+            const unsigned char *source = _regionBuffer.data() + plane * imagePlaneSize + y * imageRowStride + x * pixelSize;
+            for (unsigned row = 0; row < height; ++row)
+            {
+                memcpy(currentOutput, source, width * pixelSize);
+                source += imageRowStride;
+                currentOutput += rowStride;
+            }
         }
     }
-}
\ No newline at end of file
+    void ImageDecoder::decode(ImageTensorConverter &converter, void *tensor) {
+        L_CHECK_EQ(getBytesPerChannel(), 1) << "16-bit samples are not supported";
+        const PixelFormat format = getOutputFormat();
+        converter.begin(getWidth(), getHeight(), format, tensor);
+        if (getBackendInfo().capabilities.rowDecoding && _orientation == ImageOrientation::NORMAL)
+        {
+            _backend->decodeRows([&converter](const unsigned char *row) { converter.pushRow(row); });
+            return;
+        }
+        _regionBuffer.resize(getDecompressedSize());
+        decode(_regionBuffer.data());
+        const size_t rowStride = getRowStride();
+        for (unsigned row = 0; row < getHeight(); ++row)
+            converter.pushRow(_regionBuffer.data() + row * rowStride);
+    }
+
+    void ImageDecoder::decodeYUV420(const YUV420Planes &planes) {
+        L_CHECK(getBackendInfo().capabilities.yuv420Output) << "The backend " << _backendInfo->name << " has no YUV output";
+        L_CHECK_EQ(_orientation, ImageOrientation::NORMAL) << "YUV output is not oriented";
+        _backend->decodeYUV420(planes);
+    }
+}
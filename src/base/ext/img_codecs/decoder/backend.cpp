@@ -0,0 +1,246 @@
+#include <base/ext/img_codecs/decoder/backend.h>
+
+#include <base/ext/img_codecs/decoder/jpeg.h>
+#include <base/ext/img_codecs/decoder/png.h>
+#include <base/ext/img_codecs/decoder/webp.h>
+#include <base/logging.h>
+
+#include <algorithm>
+
+namespace Base
+{
+	void ImageDecoderBackend::setTargetSize(unsigned, unsigned)
+	{
+		L_NOT_IMPLEMENTED_ERROR;
+	}
+
+	unsigned ImageDecoderBackend::getBytesPerChannel() const
+	{
+		return 1;
+	}
+
+	void ImageDecoderBackend::decodeRegion(unsigned, unsigned, unsigned, unsigned, void*)
+	{
+		L_NOT_IMPLEMENTED_ERROR;
+	}
+
+	void ImageDecoderBackend::decodeRows(const std::function<void(const unsigned char*)>&)
+	{
+		L_NOT_IMPLEMENTED_ERROR;
+	}
+
+	void ImageDecoderBackend::decodeYUV420(const YUV420Planes&)
+	{
+		L_NOT_IMPLEMENTED_ERROR;
+	}
+
+	// forwards to the decoder classes, which share the names of the methods
+	template <typename Decoder>
+	class CodecBackend : public ImageDecoderBackend
+	{
+	public:
+		void setOptions(const ImageDecodeOptions& options) override
+		{
+			_decoder.setOutputFormat(options.format, options.rowAlignment);
+		}
+
+		void load(const void* image, uint64_t size) override
+		{
+			_decoder.load(image, size);
+		}
+
+		unsigned getWidth() const override
+		{
+			return _decoder.getWidth();
+		}
+
+		unsigned getHeight() const override
+		{
+			return _decoder.getHeight();
+		}
+
+		uint64_t getDecompressedSize() const override
+		{
+			return _decoder.getDecompressedSize();
+		}
+
+		PixelFormat getOutputFormat() const override
+		{
+			return _decoder.getOutputFormat();
+		}
+
+		size_t getRowStride() const override
+		{
+			return _decoder.getRowStride();
+		}
+
+		void decode(void* buffer) override
+		{
+			_decoder.decode(buffer);
+		}
+	protected:
+		Decoder _decoder;
+	};
+
+	// for the decoders which also scale, decode regions and pass rows
+	template <typename Decoder>
+	class ScalingBackend : public CodecBackend<Decoder>
+	{
+	public:
+		void setTargetSize(unsigned width, unsigned height) override
+		{
+			this->_decoder.setTargetSize(width, height);
+		}
+
+		void decodeRegion(unsigned x, unsigned y, unsigned width, unsigned height, void* buffer) override
+		{
+			this->_decoder.decodeRegion(x, y, width, height, buffer);
+		}
+
+		void decodeRows(const std::function<void(const unsigned char*)>& function) override
+		{
+			this->_decoder.decodeRows(function);
+		}
+	};
+
+#ifdef HAVE_LIB_PNG
+	class PNGBackend : public CodecBackend<PNGDecoder>
+	{
+	public:
+		void setOptions(const ImageDecodeOptions& options) override
+		{
+			_decoder.setOptions(options);
+		}
+
+		unsigned getBytesPerChannel() const override
+		{
+			return _decoder.getBytesPerChannel();
+		}
+
+		void decodeRows(const std::function<void(const unsigned char*)>& function) override
+		{
+			_decoder.decodeRows(function);
+		}
+	};
+#endif
+
+#ifdef HAVE_LIB_WEBP
+	class WebPBackend : public ScalingBackend<WebPDecoder>
+	{
+	public:
+		void setOptions(const ImageDecodeOptions& options) override
+		{
+			_decoder.setOptions(options);
+		}
+
+		void decodeYUV420(const YUV420Planes& planes) override
+		{
+			_decoder.decodeYUV420(planes);
+		}
+	};
+#endif
+
+	template <typename Backend>
+	static ImageDecoderBackendInfo getBuiltInBackendInfo(const char* name, ImageFormatType format, int priority, const ImageDecoderCapabilities& capabilities)
+	{
+		ImageDecoderBackendInfo info;
+		info.name = name;
+		info.format = format;
+		info.capabilities = capabilities;
+		info.capabilities.outputFormats = { PixelFormat::RGB, PixelFormat::BGR, PixelFormat::RGBA, PixelFormat::BGRA, PixelFormat::GRAY, PixelFormat::RGB_PLANAR };
+		info.priority = priority;
+		info.factory = []() { return std::unique_ptr<ImageDecoderBackend>(new Backend); };
+		return info;
+	}
+
+	ImageDecoderBackendRegistry::ImageDecoderBackendRegistry()
+		: _snapshot(std::make_shared<const Snapshot>())
+	{
+		ImageDecoderCapabilities capabilities;
+#ifdef HAVE_LIB_JPEG_TURBO
+		capabilities.scaling = true;
+		capabilities.regionDecoding = true;
+		capabilities.rowDecoding = true;
+		registerBackend(getBuiltInBackendInfo<ScalingBackend<TurboJPEGDecoder>>("turbojpeg", ImageFormatType::JPEG, 20, capabilities));
+#endif
+#ifdef HAVE_LIB_JPEG
+		capabilities = {};
+		capabilities.scaling = true;
+		capabilities.regionDecoding = true;
+		capabilities.rowDecoding = true;
+		capabilities.streamingRows = true;
+		registerBackend(getBuiltInBackendInfo<ScalingBackend<LibJPEGDecoder>>("libjpeg", ImageFormatType::JPEG, 10, capabilities));
+#endif
+#ifdef HAVE_LIB_PNG
+		capabilities = {};
+		capabilities.rowDecoding = true;
+		capabilities.streamingRows = true;
+		registerBackend(getBuiltInBackendInfo<PNGBackend>("libpng", ImageFormatType::PNG, 10, capabilities));
+#endif
+#ifdef HAVE_LIB_WEBP
+		capabilities = {};
+		capabilities.scaling = true;
+		capabilities.regionDecoding = true;
+		capabilities.rowDecoding = true;
+		capabilities.yuv420Output = true;
+		registerBackend(getBuiltInBackendInfo<WebPBackend>("libwebp", ImageFormatType::WEBP, 10, capabilities));
+#endif
+	}
+
+	ImageDecoderBackendRegistry& ImageDecoderBackendRegistry::getInstance()
+	{
+		static ImageDecoderBackendRegistry registry;
+		return registry;
+	}
+
+	void ImageDecoderBackendRegistry::registerBackend(ImageDecoderBackendInfo info)
+	{
+		L_CHECK(!info.name.empty());
+		L_CHECK(info.factory);
+		L_CHECK_LT(size_t(info.format), size_t(ImageFormatType::UNKNOWN));
+		std::lock_guard<std::mutex> lock(_mutex);
+		ImageDecoderBackendList backends = std::atomic_load(&_snapshot)->backends;
+		backends.erase(std::remove_if(backends.begin(), backends.end(),
+			[&](const std::shared_ptr<const ImageDecoderBackendInfo>& backend) { return backend->name == info.name; }), backends.end());
+		backends.push_back(std::make_shared<const ImageDecoderBackendInfo>(std::move(info)));
+		publish(std::move(backends));
+	}
+
+	void ImageDecoderBackendRegistry::unregisterBackend(const std::string& name)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		ImageDecoderBackendList backends = std::atomic_load(&_snapshot)->backends;
+		backends.erase(std::remove_if(backends.begin(), backends.end(),
+			[&](const std::shared_ptr<const ImageDecoderBackendInfo>& backend) { return backend->name == name; }), backends.end());
+		publish(std::move(backends));
+	}
+
+	void ImageDecoderBackendRegistry::publish(ImageDecoderBackendList backends)
+	{
+		auto snapshot = std::make_shared<Snapshot>();
+		for (const auto& backend : backends)
+			snapshot->backendsOfFormat[size_t(backend->format)].push_back(backend);
+		for (ImageDecoderBackendList& backendsOfFormat : snapshot->backendsOfFormat)
+			std::stable_sort(backendsOfFormat.begin(), backendsOfFormat.end(),
+				[](const std::shared_ptr<const ImageDecoderBackendInfo>& a, const std::shared_ptr<const ImageDecoderBackendInfo>& b) { return a->priority > b->priority; });
+		snapshot->backends = std::move(backends);
+		std::atomic_store(&_snapshot, std::shared_ptr<const Snapshot>(std::move(snapshot)));
+	}
+
+	std::shared_ptr<const ImageDecoderBackendList> ImageDecoderBackendRegistry::getBackends(ImageFormatType format) const
+	{
+		L_CHECK_LE(size_t(format), size_t(ImageFormatType::UNKNOWN));
+		std::shared_ptr<const Snapshot> snapshot = std::atomic_load(&_snapshot);
+		// shares the ownership of the snapshot
+		return std::shared_ptr<const ImageDecoderBackendList>(snapshot, &snapshot->backendsOfFormat[size_t(format)]);
+	}
+
+	std::shared_ptr<const ImageDecoderBackendInfo> ImageDecoderBackendRegistry::getBackend(const std::string& name) const
+	{
+		const std::shared_ptr<const Snapshot> snapshot = std::atomic_load(&_snapshot);
+		for (const auto& backend : snapshot->backends)
+			if (backend->name == name)
+				return backend;
+		return nullptr;
+	}
+}
@@ -2,6 +2,7 @@
 
 #include <base/logging.h>
 #include <base/ext/img_codecs/decoder/jpeg.h>
+#include <base/ext/img_codecs/pixel_format.h>
 
 #include <cstring>
 
@@ -17,79 +18,212 @@ namespace Base
 		L_THROW_RUNTIME_EXCEPTION << jpegLastErrorMsg;
 	}
 	
-	JPEGDecoder::JPEGDecoder()
-		: _state(State::closed)
+	LibJPEGDecoder::LibJPEGDecoder()
+		: _width(0), _height(0), _outputFormat(PixelFormat::RGB), _rowAlignment(1), _state(State::closed)
 	{
 		decInfo.err = jpeg_std_error(&jerr);
 		jerr.error_exit = jpegErrorExit;
 		jpeg_create_decompress(&decInfo);
 	}
 
-	JPEGDecoder::JPEGDecoder(JPEGDecoder&& object) noexcept
-		: _state(object._state)
+	LibJPEGDecoder::LibJPEGDecoder(LibJPEGDecoder&& object) noexcept
+		: _rowBuffer(std::move(object._rowBuffer)), _width(object._width), _height(object._height), _outputFormat(object._outputFormat), _rowAlignment(object._rowAlignment), _state(object._state)
 	{
 		memcpy(&decInfo, &object.decInfo, sizeof(decInfo));
 		memcpy(&jerr, &object.jerr, sizeof(jerr));
+		decInfo.err = &jerr;
 		object.decInfo.err = nullptr;
 	}
 
-	JPEGDecoder::~JPEGDecoder()
+	LibJPEGDecoder::~LibJPEGDecoder()
 	{
 		if (decInfo.err)
 			jpeg_destroy_decompress(&decInfo);
 	}
 
-	void JPEGDecoder::load(const void* pointer, const uint64_t fileSize)
+	void LibJPEGDecoder::load(const void* pointer, const uint64_t fileSize)
 	{
 		close();
 		jpeg_mem_src(&decInfo, (const unsigned char*)pointer, (unsigned long)fileSize);
 		L_CHECK(jpeg_read_header(&decInfo, TRUE));
 		decInfo.out_color_space = JCS_RGB;
         decInfo.raw_data_out = FALSE;
+		decInfo.scale_num = decInfo.scale_denom = 1;
+		jpeg_calc_output_dimensions(&decInfo);
+		_width = decInfo.output_width;
+		_height = decInfo.output_height;
 		_state = State::loaded;
 	}
 
-	unsigned JPEGDecoder::getWidth() const
+	void LibJPEGDecoder::setTargetSize(unsigned width, unsigned height)
+	{
+		L_CHECK_EQ(_state, State::loaded);
+		// libjpeg without DCT scaling support rounds up to 1/8, 1/4, 1/2 or 1/1
+		decInfo.scale_denom = 8;
+		for (unsigned scale = 1; scale <= 8; ++scale)
+		{
+			decInfo.scale_num = scale;
+			jpeg_calc_output_dimensions(&decInfo);
+			if (decInfo.output_width >= width && decInfo.output_height >= height)
+				break;
+		}
+		_width = decInfo.output_width;
+		_height = decInfo.output_height;
+	}
+
+	unsigned LibJPEGDecoder::getWidth() const
+	{
+		L_CHECK_NE(_state, State::closed);
+		return _width;
+	}
+
+	unsigned LibJPEGDecoder::getHeight() const
 	{
 		L_CHECK_NE(_state, State::closed);
-		return decInfo.image_width;
+		return _height;
 	}
 
-	unsigned JPEGDecoder::getHeight() const
+	uint64_t LibJPEGDecoder::getDecompressedSize() const
 	{
 		L_CHECK_NE(_state, State::closed);
-		return decInfo.image_height;
+		return getImageSize(_height, _outputFormat, getRowStride());
+	}
+
+	void LibJPEGDecoder::setOutputFormat(PixelFormat format, unsigned rowAlignment)
+	{
+		L_CHECK_NE(rowAlignment, 0);
+		_outputFormat = format;
+		_rowAlignment = rowAlignment;
 	}
 
-	uint64_t JPEGDecoder::getDecompressedSize() const
+	PixelFormat LibJPEGDecoder::getOutputFormat() const
+	{
+		return _outputFormat;
+	}
+
+	size_t LibJPEGDecoder::getRowStride() const
 	{
 		L_CHECK_NE(_state, State::closed);
-		return decInfo.image_height * decInfo.image_width * 3;
+		return getImageRowStride(_width, _outputFormat, _rowAlignment);
+	}
+
+	// the colour space libjpeg writes format in, JCS_RGB if the rows have to be converted afterwards
+	static J_COLOR_SPACE getOutputColorSpace(PixelFormat format, bool& direct)
+	{
+		direct = true;
+		switch (format)
+		{
+		case PixelFormat::RGB:
+			return JCS_RGB;
+		case PixelFormat::GRAY:
+			return JCS_GRAYSCALE;
+#ifdef JCS_EXTENSIONS
+		case PixelFormat::BGR:
+			return JCS_EXT_BGR;
+#endif
+#ifdef JCS_ALPHA_EXTENSIONS
+		case PixelFormat::RGBA:
+			return JCS_EXT_RGBA;
+		case PixelFormat::BGRA:
+			return JCS_EXT_BGRA;
+#endif
+		default:
+			direct = false;
+			return JCS_RGB;
+		}
+	}
+
+	void LibJPEGDecoder::decode(void* buffer)
+	{
+		L_CHECK_EQ(_state, State::loaded);
+		decodeRegion(0, 0, _width, _height, buffer);
 	}
 
-	void JPEGDecoder::decode(void* buffer)
+	void LibJPEGDecoder::decodeRegion(unsigned x, unsigned y, unsigned width, unsigned height, void* buffer)
 	{
 		L_CHECK_EQ(_state, State::loaded);
+		L_CHECK(width != 0 && height != 0);
+		L_CHECK_LE(uint64_t(x) + width, _width);
+		L_CHECK_LE(uint64_t(y) + height, _height);
+		bool direct;
+		decInfo.out_color_space = getOutputColorSpace(_outputFormat, direct);
 		L_CHECK(jpeg_start_decompress(&decInfo));
-		L_CHECK_EQ(decInfo.output_components, 3);
-		L_CHECK_EQ(decInfo.image_width, decInfo.output_width);
-		L_CHECK_EQ(decInfo.image_height, decInfo.output_height);
-
-		size_t rowSize = decInfo.output_width * unsigned(decInfo.output_components);
-		unsigned char* currentBuffer = (unsigned char*)buffer;
-		while (decInfo.output_scanline < decInfo.output_height) {
-			L_CHECK_EQ(jpeg_read_scanlines(&decInfo, &currentBuffer, 1), 1);
-			currentBuffer += rowSize;
+		L_CHECK_EQ(unsigned(decInfo.output_components), direct ? getPixelSize(_outputFormat) : 3);
+		const size_t pixelSize = decInfo.output_components;
+
+#if defined LIBJPEG_TURBO_VERSION_NUMBER && LIBJPEG_TURBO_VERSION_NUMBER >= 1005000
+		size_t columnOffset = 0;
+		if (x != 0 || width != _width)
+		{
+			// widens the columns to iMCU boundaries, output_width becomes the cropped width until the next load
+			JDIMENSION croppedX = x, croppedWidth = width;
+			jpeg_crop_scanline(&decInfo, &croppedX, &croppedWidth);
+			columnOffset = (x - croppedX) * pixelSize;
 		}
-		L_CHECK(jpeg_finish_decompress(&decInfo));
+		L_CHECK_EQ(jpeg_skip_scanlines(&decInfo, y), y);
+#else
+		const size_t columnOffset = x * pixelSize;
+#endif
+		const size_t rowStride = getImageRowStride(width, _outputFormat, _rowAlignment);
+		const uint64_t planeSize = uint64_t(rowStride) * height;
+		const bool useRowBuffer = !direct || decInfo.output_width != width;
+		if (useRowBuffer || decInfo.output_scanline < y)
+			_rowBuffer.resize(decInfo.output_width * pixelSize);
+		unsigned char* rowBuffer = _rowBuffer.data();
+		while (decInfo.output_scanline < y)
+			L_CHECK_EQ(jpeg_read_scanlines(&decInfo, &rowBuffer, 1), 1);
+
+		unsigned char* row = (unsigned char*)buffer;
+		for (unsigned rowIndex = 0; rowIndex < height; ++rowIndex)
+		{
+			if (useRowBuffer)
+			{
+				L_CHECK_EQ(jpeg_read_scanlines(&decInfo, &rowBuffer, 1), 1);
+				if (direct)
+					memcpy(row, rowBuffer + columnOffset, width * pixelSize);
+				else
+					convertRGBRow(rowBuffer + columnOffset, width, _outputFormat, row, planeSize);
+			}
+			else
+				L_CHECK_EQ(jpeg_read_scanlines(&decInfo, &row, 1), 1);
+			row += rowStride;
+		}
+		// the rows below the region are never decompressed
+		jpeg_abort_decompress(&decInfo);
 		_state = State::decompressed;
 	}
 
-	void JPEGDecoder::close()
+	void LibJPEGDecoder::decodeRows(const std::function<void(const unsigned char*)>& function)
 	{
-		if (_state == State::loaded) {
-			jpeg_abort_decompress(&decInfo);			
+		L_CHECK_EQ(_state, State::loaded);
+		L_CHECK_EQ(getNumberOfPlanes(_outputFormat), 1) << "Planar formats have no packed rows";
+		bool direct;
+		decInfo.out_color_space = getOutputColorSpace(_outputFormat, direct);
+		L_CHECK(jpeg_start_decompress(&decInfo));
+		const size_t rowSize = size_t(decInfo.output_width) * decInfo.output_components;
+		const size_t convertedRowSize = direct ? 0 : size_t(decInfo.output_width) * getPixelSize(_outputFormat);
+		_rowBuffer.resize(rowSize + convertedRowSize);
+		unsigned char* rowBuffer = _rowBuffer.data();
+		unsigned char* convertedRow = rowBuffer + rowSize;
+		while (decInfo.output_scanline < decInfo.output_height)
+		{
+			L_CHECK_EQ(jpeg_read_scanlines(&decInfo, &rowBuffer, 1), 1);
+			if (direct)
+				function(rowBuffer);
+			else
+			{
+				convertRGBRow(rowBuffer, decInfo.output_width, _outputFormat, convertedRow, 0);
+				function(convertedRow);
+			}
 		}
+		jpeg_abort_decompress(&decInfo);
+		_state = State::decompressed;
+	}
+
+	void LibJPEGDecoder::close()
+	{
+		// also resets a decompressor left in the middle of jpeg_read_header by a corrupted image
+		jpeg_abort_decompress(&decInfo);
 		_state = State::closed;
 	}
 }
@@ -1,56 +1,207 @@
 #ifdef HAVE_LIB_JPEG_TURBO
 #include <base/ext/img_codecs/decoder/jpeg.h>
+#include <base/ext/img_codecs/pixel_format.h>
 #include <base/logging.h>
+#include <cstring>
+#include <limits>
+#include <utility>
 namespace Base
 {
-    JPEGDecoder::JPEGDecoder()
+    // converts the RGB rectangle at (x, y) of source into format
+    static void copyRegion(const unsigned char* source, size_t sourceRowSize, unsigned x, unsigned y, unsigned width, unsigned height,
+        PixelFormat format, size_t rowStride, void* buffer)
+    {
+        const uint64_t planeSize = uint64_t(rowStride) * height;
+        source += y * sourceRowSize + size_t(x) * tjPixelSize[TJPF_RGB];
+        unsigned char* row = (unsigned char*)buffer;
+        for (unsigned rowIndex = 0; rowIndex < height; ++rowIndex)
+        {
+            convertRGBRow(source, width, format, row, planeSize);
+            source += sourceRowSize;
+            row += rowStride;
+        }
+    }
+
+    // -1 if TurboJPEG cannot write format
+    static int getTurboPixelFormat(PixelFormat format)
+    {
+        switch (format)
+        {
+        case PixelFormat::RGB:
+            return TJPF_RGB;
+        case PixelFormat::BGR:
+            return TJPF_BGR;
+        case PixelFormat::RGBA:
+            return TJPF_RGBA;
+        case PixelFormat::BGRA:
+            return TJPF_BGRA;
+        case PixelFormat::GRAY:
+            return TJPF_GRAY;
+        default:
+            return -1;
+        }
+    }
+
+    TurboJPEGDecoder::TurboJPEGDecoder()
+        : _pointer(nullptr), _fileSize(0), _transformHandle(nullptr), _width(0), _height(0), _scaledWidth(0), _scaledHeight(0),
+          _jpegSubsamp(0), _jpegColorspace(0), _outputFormat(PixelFormat::RGB), _rowAlignment(1)
     {
         _handle = tjInitDecompress();
-        CHECK(_handle) << tjGetErrorStr2(nullptr) << "tjInitDecompress() failed.";
+        L_CHECK(_handle) << tjGetErrorStr2(nullptr) << "tjInitDecompress() failed.";
     }
 
-    JPEGDecoder::JPEGDecoder(JPEGDecoder&& object) noexcept
+    TurboJPEGDecoder::TurboJPEGDecoder(TurboJPEGDecoder&& object) noexcept
+        : _pointer(object._pointer), _fileSize(object._fileSize), _handle(object._handle), _transformHandle(object._transformHandle),
+          _regionBuffer(std::move(object._regionBuffer)), _width(object._width), _height(object._height),
+          _scaledWidth(object._scaledWidth), _scaledHeight(object._scaledHeight), _jpegSubsamp(object._jpegSubsamp),
+          _jpegColorspace(object._jpegColorspace), _outputFormat(object._outputFormat), _rowAlignment(object._rowAlignment)
     {
-        this->_handle = object._handle;
+        object._pointer = nullptr;
+        object._fileSize = 0;
         object._handle = nullptr;
+        object._transformHandle = nullptr;
     }
 
-    JPEGDecoder::~JPEGDecoder()
+    TurboJPEGDecoder::~TurboJPEGDecoder()
     {
         if (_handle)
             tjDestroy(_handle);
+        if (_transformHandle)
+            tjDestroy(_transformHandle);
     }
 
-    void JPEGDecoder::load(const void* pointer, uint64_t fileSize)
+    void TurboJPEGDecoder::load(const void* pointer, uint64_t fileSize)
     {
-        CHECK_LE(fileSize, std::numeric_limits<unsigned long>::max()) << "Cannot process images which file size larger than " << std::numeric_limits<unsigned long>::max() << " bytes.";
+        L_CHECK_LE(fileSize, std::numeric_limits<unsigned long>::max()) << "Cannot process images which file size larger than " << std::numeric_limits<unsigned long>::max() << " bytes.";
 
         const auto fileSize_safeCast = static_cast<const unsigned long>(fileSize);
 
-        CHECK_NE(tjDecompressHeader3(_handle, (const unsigned char*)pointer, fileSize_safeCast, &_width, &_height, &_jpegSubsamp, &_jpegColorspace), -1) << tjGetErrorStr2(_handle);
+        L_CHECK_NE(tjDecompressHeader3(_handle, (const unsigned char*)pointer, fileSize_safeCast, &_width, &_height, &_jpegSubsamp, &_jpegColorspace), -1) << tjGetErrorStr2(_handle);
         _pointer = (const unsigned char*)pointer;
         _fileSize = fileSize_safeCast;
+        _scaledWidth = _width;
+        _scaledHeight = _height;
+    }
+
+    void TurboJPEGDecoder::setTargetSize(unsigned width, unsigned height)
+    {
+        int numberOfScalingFactors;
+        const tjscalingfactor* scalingFactors = tjGetScalingFactors(&numberOfScalingFactors);
+        L_CHECK(scalingFactors) << tjGetErrorStr2(nullptr);
+        _scaledWidth = _width;
+        _scaledHeight = _height;
+        // the scaling factors are not sorted
+        for (int index = 0; index < numberOfScalingFactors; ++index)
+        {
+            const int scaledWidth = TJSCALED(_width, scalingFactors[index]);
+            const int scaledHeight = TJSCALED(_height, scalingFactors[index]);
+            if (unsigned(scaledWidth) >= width && unsigned(scaledHeight) >= height && scaledWidth <= _scaledWidth && scaledHeight <= _scaledHeight)
+            {
+                _scaledWidth = scaledWidth;
+                _scaledHeight = scaledHeight;
+            }
+        }
+    }
+
+    unsigned TurboJPEGDecoder::getWidth() const
+    {
+        return _scaledWidth;
+    }
+
+    unsigned TurboJPEGDecoder::getHeight() const
+    {
+        return _scaledHeight;
     }
 
-    int JPEGDecoder::getWidth()
+    uint64_t TurboJPEGDecoder::getDecompressedSize() const
     {
-        return _width;
+        return getImageSize(_scaledHeight, _outputFormat, getRowStride());
     }
 
-    int JPEGDecoder::getHeight()
+    void TurboJPEGDecoder::setOutputFormat(PixelFormat format, unsigned rowAlignment)
     {
-        return _height;
+        L_CHECK_NE(rowAlignment, 0);
+        _outputFormat = format;
+        _rowAlignment = rowAlignment;
     }
 
-    int JPEGDecoder::getDecompressedSize()
+    PixelFormat TurboJPEGDecoder::getOutputFormat() const
     {
-        return _width * _height* tjPixelSize[TJPF_RGB];
+        return _outputFormat;
+    }
+
+    size_t TurboJPEGDecoder::getRowStride() const
+    {
+        return getImageRowStride(_scaledWidth, _outputFormat, _rowAlignment);
+    }
+
+    void TurboJPEGDecoder::decode(void* buffer)
+    {
+        // tjDecompress2 picks the scaling factor matching the requested size
+        const int pixelFormat = getTurboPixelFormat(_outputFormat);
+        if (pixelFormat >= 0)
+        {
+            L_CHECK_NE(tjDecompress2(_handle, _pointer, _fileSize, (unsigned char*)buffer, _scaledWidth, int(getRowStride()), _scaledHeight, pixelFormat, TJFLAG_ACCURATEDCT), -1) << tjGetErrorStr2(_handle);
+            return;
+        }
+        const size_t rowSize = size_t(_scaledWidth) * tjPixelSize[TJPF_RGB];
+        _regionBuffer.resize(rowSize * _scaledHeight);
+        L_CHECK_NE(tjDecompress2(_handle, _pointer, _fileSize, _regionBuffer.data(), _scaledWidth, int(rowSize), _scaledHeight, TJPF_RGB, TJFLAG_ACCURATEDCT), -1) << tjGetErrorStr2(_handle);
+        copyRegion(_regionBuffer.data(), rowSize, 0, 0, _scaledWidth, _scaledHeight, _outputFormat, getRowStride(), buffer);
+    }
+
+    void TurboJPEGDecoder::decodeRegion(unsigned x, unsigned y, unsigned width, unsigned height, void* buffer)
+    {
+        L_CHECK(width != 0 && height != 0);
+        L_CHECK_LE(uint64_t(x) + width, unsigned(_scaledWidth));
+        L_CHECK_LE(uint64_t(y) + height, unsigned(_scaledHeight));
+        const int pixelSize = tjPixelSize[TJPF_RGB];
+        const size_t rowStride = getImageRowStride(width, _outputFormat, _rowAlignment);
+        if (_scaledWidth != _width || _scaledHeight != _height || _jpegSubsamp < 0)
+        {
+            // lossless cropping works on unscaled MCUs only
+            const size_t rowSize = size_t(_scaledWidth) * pixelSize;
+            _regionBuffer.resize(rowSize * _scaledHeight);
+            L_CHECK_NE(tjDecompress2(_handle, _pointer, _fileSize, _regionBuffer.data(), _scaledWidth, int(rowSize), _scaledHeight, TJPF_RGB, TJFLAG_ACCURATEDCT), -1) << tjGetErrorStr2(_handle);
+            copyRegion(_regionBuffer.data(), rowSize, x, y, width, height, _outputFormat, rowStride, buffer);
+            return;
+        }
+
+        if (!_transformHandle)
+        {
+            _transformHandle = tjInitTransform();
+            L_CHECK(_transformHandle) << tjGetErrorStr2(nullptr) << "tjInitTransform() failed.";
+        }
+        // the cropped image has to start at an MCU boundary
+        tjtransform transform;
+        memset(&transform, 0, sizeof(transform));
+        transform.r.x = int(x) / tjMCUWidth[_jpegSubsamp] * tjMCUWidth[_jpegSubsamp];
+        transform.r.y = int(y) / tjMCUHeight[_jpegSubsamp] * tjMCUHeight[_jpegSubsamp];
+        transform.r.w = int(x + width) - transform.r.x;
+        transform.r.h = int(y + height) - transform.r.y;
+        transform.op = TJXOP_NONE;
+        transform.options = TJXOPT_CROP;
+        unsigned char* croppedImage = nullptr;
+        unsigned long croppedImageSize = 0;
+        L_CHECK_NE(tjTransform(_transformHandle, _pointer, _fileSize, 1, &croppedImage, &croppedImageSize, &transform, 0), -1) << tjGetErrorStr2(_transformHandle);
+
+        _regionBuffer.resize(size_t(transform.r.w) * transform.r.h * pixelSize);
+        const int result = tjDecompress2(_handle, croppedImage, croppedImageSize, _regionBuffer.data(), transform.r.w, transform.r.w * pixelSize, transform.r.h, TJPF_RGB, TJFLAG_ACCURATEDCT);
+        tjFree(croppedImage);
+        L_CHECK_NE(result, -1) << tjGetErrorStr2(_handle);
+        copyRegion(_regionBuffer.data(), size_t(transform.r.w) * pixelSize, x - transform.r.x, y - transform.r.y, width, height, _outputFormat, rowStride, buffer);
     }
 
-    void JPEGDecoder::decode(void* buffer)
+    void TurboJPEGDecoder::decodeRows(const std::function<void(const unsigned char*)>& function)
     {
-        CHECK_NE(tjDecompress2(_handle, _pointer, _fileSize, (unsigned char*)buffer, _width, _width * tjPixelSize[TJPF_RGB], _height, TJPF_RGB, TJFLAG_ACCURATEDCT), -1) << tjGetErrorStr2(_handle);
+        L_CHECK_EQ(getNumberOfPlanes(_outputFormat), 1) << "Planar formats have no packed rows";
+        const size_t rowSize = size_t(_scaledWidth) * getPixelSize(_outputFormat);
+        _regionBuffer.resize(rowSize * _scaledHeight);
+        const int pixelFormat = getTurboPixelFormat(_outputFormat);
+        L_CHECK_NE(tjDecompress2(_handle, _pointer, _fileSize, _regionBuffer.data(), _scaledWidth, int(rowSize), _scaledHeight, pixelFormat, TJFLAG_ACCURATEDCT), -1) << tjGetErrorStr2(_handle);
+        for (int row = 0; row < _scaledHeight; ++row)
+            function(_regionBuffer.data() + row * rowSize);
     }
 }
 
-#endif
\ No newline at end of file
+#endif
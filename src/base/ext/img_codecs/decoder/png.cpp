@@ -1,7 +1,8 @@
 #ifdef HAVE_LIB_PNG
 #include <base/ext/img_codecs/decoder/png.h>
+#include <base/ext/img_codecs/pixel_format.h>
 #include <base/logging.h>
-#include <cstring>
+#include <base/utils.h>
 
 namespace Base
 {
@@ -16,21 +17,96 @@ namespace Base
 		L_LOG_ERROR << message;
 	}
 
+	// Sets up the conversion into format and returns the number of interlace passes, RGB_PLANAR is read as RGB.
+	// preserve16Bit keeps 16-bit samples in native byte order.
+	static int setTransformations(png_structp png_ptr, png_infop info_ptr, PixelFormat format, bool preserve16Bit)
+	{
+		unsigned char bit_depth = png_get_bit_depth(png_ptr, info_ptr);
+		unsigned char color_type = png_get_color_type(png_ptr, info_ptr);
+
+		// force palette images to be expanded to 24-bit RGB  
+		// it may include alpha channel  
+		if (color_type == PNG_COLOR_TYPE_PALETTE) {
+			png_set_palette_to_rgb(png_ptr);
+		}
+
+		// low-bit-depth grayscale images are to be expanded to 8 bits  
+		if (color_type == PNG_COLOR_TYPE_GRAY && bit_depth < 8) {
+			png_set_expand_gray_1_2_4_to_8(png_ptr);
+		}
+
+		// reduce images with 16-bit samples to 8 bits unless they are preserved, PNG stores them big-endian
+		if (bit_depth == 16) {
+			const uint16_t one = 1;
+			if (!preserve16Bit)
+				png_set_strip_16(png_ptr);
+			else if (*(const uint8_t*)&one == 1)
+				png_set_swap(png_ptr);
+		}
+
+		const bool isGray = color_type == PNG_COLOR_TYPE_GRAY || color_type == PNG_COLOR_TYPE_GRAY_ALPHA;
+		const bool hasTransparency = png_get_valid(png_ptr, info_ptr, PNG_INFO_tRNS) != 0;
+		switch (format)
+		{
+		case PixelFormat::GRAY:
+			if (!isGray)
+				png_set_rgb_to_gray_fixed(png_ptr, 1, -1, -1);
+			png_set_strip_alpha(png_ptr);
+			break;
+		case PixelFormat::RGBA:
+		case PixelFormat::BGRA:
+			if (hasTransparency)
+				png_set_tRNS_to_alpha(png_ptr);
+			if (isGray)
+				png_set_gray_to_rgb(png_ptr);
+			// opaque images get an alpha channel of 0xFF
+			if ((color_type & PNG_COLOR_MASK_ALPHA) == 0 && !hasTransparency)
+				png_set_filler(png_ptr, 0xFFFF, PNG_FILLER_AFTER);
+			break;
+		default:
+			// palette expansion turns tRNS into an alpha channel
+			png_set_strip_alpha(png_ptr);
+			if (isGray)
+				png_set_gray_to_rgb(png_ptr);
+			break;
+		}
+		if (format == PixelFormat::BGR || format == PixelFormat::BGRA)
+			png_set_bgr(png_ptr);
+
+		const int numberOfPasses = png_set_interlace_handling(png_ptr);
+		png_read_update_info(png_ptr, info_ptr);
+		L_CHECK_EQ(png_get_rowbytes(png_ptr, info_ptr), size_t(png_get_image_width(png_ptr, info_ptr)) * (format == PixelFormat::RGB_PLANAR ? 3 : getPixelSize(format)) * (png_get_bit_depth(png_ptr, info_ptr) / 8));
+		return numberOfPasses;
+	}
+
 	PNGDecoder::PNGDecoder()
-		: _png_ptr(nullptr), _info_ptr(nullptr)
+		: _png_ptr(nullptr), _info_ptr(nullptr), _imageFormat(PixelFormat::RGB), _bytesPerChannel(1), _numberOfPasses(1),
+		_destination(nullptr), _destinationRowStride(0), _rowFunction(nullptr), _numberOfRows(0), _isComplete(false)
 	{
 	}
 
 	PNGDecoder::PNGDecoder(PNGDecoder&& object) noexcept
 	{
 		_sourceImage = object._sourceImage;
+		_sourceImageEnd = object._sourceImageEnd;
 		_currentImagePosition = object._currentImagePosition;
 		_png_ptr = object._png_ptr;
 		_info_ptr = object._info_ptr;
 		_image_width = object._image_width;
 		_image_height = object._image_height;
-		_row_pointers = std::move(object._row_pointers);
+		_rowBuffer = std::move(object._rowBuffer);
+		_options = object._options;
+		_imageFormat = object._imageFormat;
+		_bytesPerChannel = object._bytesPerChannel;
+		_numberOfPasses = object._numberOfPasses;
+		_destination = nullptr;
+		_destinationRowStride = 0;
+		_rowFunction = nullptr;
+		_numberOfRows = object._numberOfRows;
+		_isComplete = object._isComplete;
 		object._png_ptr = nullptr;
+		if (_png_ptr)
+			png_set_progressive_read_fn(_png_ptr, this, infoCallback, rowCallback, endCallback);
 	}
 
 	PNGDecoder::~PNGDecoder()
@@ -51,27 +127,127 @@ namespace Base
 
 	uint64_t PNGDecoder::getDecompressedSize() const
 	{
-		return uint64_t(_image_width) * uint64_t(_image_height) * 3ULL;
+		return getImageSize(_image_height, _imageFormat, getRowStride());
+	}
+
+	void PNGDecoder::setOutputFormat(PixelFormat format, unsigned rowAlignment)
+	{
+		L_CHECK_NE(rowAlignment, 0);
+		_options.format = format;
+		_options.rowAlignment = rowAlignment;
+	}
+
+	void PNGDecoder::setOptions(const ImageDecodeOptions& options)
+	{
+		L_CHECK_NE(options.rowAlignment, 0);
+		_options = options;
+	}
+
+	const ImageDecodeOptions& PNGDecoder::getOptions() const
+	{
+		return _options;
+	}
+
+	PixelFormat PNGDecoder::getOutputFormat() const
+	{
+		return _imageFormat;
+	}
+
+	unsigned PNGDecoder::getBytesPerChannel() const
+	{
+		return _bytesPerChannel;
+	}
+
+	size_t PNGDecoder::getRowStride() const
+	{
+		return getImageRowStride(_image_width * _bytesPerChannel, _imageFormat, _options.rowAlignment);
 	}
 
 	void PNGDecoder::decode(void* buffer)
 	{
-		if (_row_pointers.size() != _image_height)
-			_row_pointers.resize(_image_height);
-		for (unsigned long i = 0; i < _image_height; i++) {
-			_row_pointers[i] = (png_bytep)((char*)buffer + i * _image_width * 3);
+		const size_t rowStride = getRowStride();
+		if (_imageFormat != PixelFormat::RGB_PLANAR)
+		{
+			// the passes of interlaced images are combined in place
+			_destination = (unsigned char*)buffer;
+			_destinationRowStride = rowStride;
+			readImage();
+		}
+		else
+		{
+			const uint64_t planeSize = uint64_t(rowStride) * _image_height;
+			unsigned char* row = (unsigned char*)buffer;
+			readRows([&](const unsigned char* rgbRow)
+			{
+				convertRGBRow(rgbRow, _image_width, _imageFormat, row, planeSize);
+				row += rowStride;
+			});
 		}
+	}
 
-		png_read_image(_png_ptr, _row_pointers.data());
-		_currentImagePosition = _sourceImage;
+	void PNGDecoder::decodeRows(const std::function<void(const unsigned char*)>& function)
+	{
+		L_CHECK_EQ(getNumberOfPlanes(_imageFormat), 1) << "Planar formats have no packed rows";
+		readRows(function);
 	}
 
-	void readDataCallback(png_structp png_ptr, png_bytep data, png_size_t length)
+	void PNGDecoder::readRows(const std::function<void(const unsigned char*)>& function)
 	{
-		unsigned char** source_data = (unsigned char**)png_get_io_ptr(png_ptr);
-		memcpy(data, *source_data, length);
+		const size_t rowSize = size_t(_image_width) * (_imageFormat == PixelFormat::RGB_PLANAR ? 3 : getPixelSize(_imageFormat)) * _bytesPerChannel;
+		_rowFunction = &function;
+		// interlaced images are complete after the last pass only
+		if (_numberOfPasses != 1)
+			_rowBuffer.assign(rowSize * _image_height, 0);
+		readImage();
+		if (_numberOfPasses != 1)
+			for (unsigned long i = 0; i < _image_height; i++)
+				function(_rowBuffer.data() + i * rowSize);
+	}
 
-		*source_data += length;
+	void PNGDecoder::readImage()
+	{
+		ScopeGuard resetOutput = [&]() { _destination = nullptr; _rowFunction = nullptr; };
+		L_CHECK(_png_ptr && !_isComplete) << "No image is loaded";
+		// libpng inflates the IDAT chunks straight from the loaded image
+		png_process_data(_png_ptr, _info_ptr, _currentImagePosition, size_t(_sourceImageEnd - _currentImagePosition));
+		_currentImagePosition = _sourceImageEnd;
+		// images without IEND are accepted when all rows are there
+		if (_numberOfPasses == 1 && _numberOfRows == _image_height)
+			_isComplete = true;
+		L_CHECK(_isComplete) << "Truncated image";
+	}
+
+	void PNGDecoder::infoCallback(png_structp png_ptr, png_infop info_ptr)
+	{
+		PNGDecoder* decoder = (PNGDecoder*)png_get_progressive_ptr(png_ptr);
+		decoder->_image_width = png_get_image_width(png_ptr, info_ptr);
+		decoder->_image_height = png_get_image_height(png_ptr, info_ptr);
+		decoder->_imageFormat = decoder->_options.format;
+		// RGB_PLANAR rows are converted from 8-bit RGB ones
+		decoder->_numberOfPasses = setTransformations(png_ptr, info_ptr, decoder->_imageFormat, decoder->_options.preserve16Bit && decoder->_imageFormat != PixelFormat::RGB_PLANAR);
+		decoder->_bytesPerChannel = png_get_bit_depth(png_ptr, info_ptr) / 8;
+		// the image data is read by decode, the bytes not yet processed are fed again then
+		decoder->_currentImagePosition = decoder->_sourceImageEnd - png_process_data_pause(png_ptr, 0);
+	}
+
+	void PNGDecoder::rowCallback(png_structp png_ptr, png_bytep new_row, png_uint_32 row_num, int)
+	{
+		PNGDecoder* decoder = (PNGDecoder*)png_get_progressive_ptr(png_ptr);
+		decoder->_numberOfRows = row_num + 1;
+		if (decoder->_destination)
+			png_progressive_combine_row(png_ptr, decoder->_destination + decoder->_destinationRowStride * row_num, new_row);
+		else if (decoder->_numberOfPasses != 1)
+			png_progressive_combine_row(png_ptr, decoder->_rowBuffer.data() + decoder->_rowBuffer.size() / decoder->_image_height * row_num, new_row);
+		else
+			(*decoder->_rowFunction)(new_row);
+	}
+
+	void PNGDecoder::endCallback(png_structp png_ptr, png_infop)
+	{
+		PNGDecoder* decoder = (PNGDecoder*)png_get_progressive_ptr(png_ptr);
+		decoder->_isComplete = true;
+		// data after IEND is ignored
+		png_process_data_pause(png_ptr, 0);
 	}
 
 	void PNGDecoder::load(const void* image, uint64_t size)
@@ -79,52 +255,148 @@ namespace Base
 		if (_png_ptr)
 			png_destroy_read_struct(&_png_ptr, &_info_ptr, nullptr);
 
-		_png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+		_png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, png_error, png_warning);
 		L_CHECK(_png_ptr) << "png_create_read_struct()";
 		_info_ptr = png_create_info_struct(_png_ptr);
 		L_CHECK_WITH_FINALIZER(_info_ptr, [&]() {png_destroy_read_struct(&_png_ptr, nullptr, nullptr); _png_ptr = nullptr; }) << "png_create_info_struct()";
 		_sourceImage = (unsigned char*)image;
+		_sourceImageEnd = _sourceImage + size;
 
 		L_CHECK_GE(size, 8) << "Invalid image";
 
 		L_CHECK_EQ(png_sig_cmp(_sourceImage, 0, 8), 0) << "Invalid image";
-		_currentImagePosition = _sourceImage;
-		png_set_read_fn(_png_ptr, &_currentImagePosition, readDataCallback);
+		_currentImagePosition = nullptr;
+		_numberOfRows = 0;
+		_isComplete = false;
+		png_set_progressive_read_fn(_png_ptr, this, infoCallback, rowCallback, endCallback);
+
+		// stops at the first IDAT chunk
+		png_process_data(_png_ptr, _info_ptr, _sourceImage, size_t(size));
+		L_CHECK(_currentImagePosition) << "Truncated image";
+	}
+
+	PNGStreamDecoder::PNGStreamDecoder()
+		: _png_ptr(nullptr), _info_ptr(nullptr), _outputFormat(PixelFormat::RGB), _imageFormat(PixelFormat::RGB),
+		_width(0), _height(0), _rowSize(0), _numberOfPasses(1), _nextRow(0), _isHeaderComplete(false), _isComplete(false)
+	{
+		reset();
+	}
 
-		png_set_sig_bytes(_png_ptr, 0);
+	PNGStreamDecoder::~PNGStreamDecoder()
+	{
+		if (_png_ptr)
+			png_destroy_read_struct(&_png_ptr, &_info_ptr, nullptr);
+	}
 
-		png_read_info(_png_ptr, _info_ptr);
-		_image_width = png_get_image_width(_png_ptr, _info_ptr);
-		_image_height = png_get_image_height(_png_ptr, _info_ptr);
-		unsigned char bit_depth = png_get_bit_depth(_png_ptr, _info_ptr);
-		unsigned char color_type = png_get_color_type(_png_ptr, _info_ptr);
+	void PNGStreamDecoder::setOutputFormat(PixelFormat format)
+	{
+		L_CHECK_EQ(getNumberOfPlanes(format), 1) << "Planar formats have no packed rows";
+		_outputFormat = format;
+	}
 
-		if (color_type & PNG_COLOR_MASK_ALPHA)
-			png_set_strip_alpha(_png_ptr);
+	PixelFormat PNGStreamDecoder::getOutputFormat() const
+	{
+		return _imageFormat;
+	}
 
-		// force palette images to be expanded to 24-bit RGB  
-		// it may include alpha channel  
-		if (color_type == PNG_COLOR_TYPE_PALETTE) {
-			png_set_palette_to_rgb(_png_ptr);
-		}
+	void PNGStreamDecoder::setHeaderFunction(std::function<void(unsigned width, unsigned height)> function)
+	{
+		_headerFunction = std::move(function);
+	}
 
-		// low-bit-depth grayscale images are to be expanded to 8 bits  
-		if (color_type == PNG_COLOR_TYPE_GRAY && bit_depth < 8) {
-			png_set_expand_gray_1_2_4_to_8(_png_ptr);
-		}
+	void PNGStreamDecoder::setRowFunction(std::function<void(unsigned row, const unsigned char* data)> function)
+	{
+		_rowFunction = std::move(function);
+	}
 
-		// reduce images with 16-bit samples to 8 bits
-		if (bit_depth == 16) {
-			png_set_strip_16(_png_ptr);
-		}
+	void PNGStreamDecoder::reset()
+	{
+		if (_png_ptr)
+			png_destroy_read_struct(&_png_ptr, &_info_ptr, nullptr);
+		_png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, png_error, png_warning);
+		L_CHECK(_png_ptr) << "png_create_read_struct()";
+		_info_ptr = png_create_info_struct(_png_ptr);
+		L_CHECK_WITH_FINALIZER(_info_ptr, [&]() {png_destroy_read_struct(&_png_ptr, nullptr, nullptr); _png_ptr = nullptr; }) << "png_create_info_struct()";
+		png_set_progressive_read_fn(_png_ptr, this, infoCallback, rowCallback, endCallback);
+		_width = _height = 0;
+		_nextRow = 0;
+		_isHeaderComplete = false;
+		_isComplete = false;
+	}
+
+	void PNGStreamDecoder::feed(const void* data, size_t size)
+	{
+		L_CHECK(_png_ptr);
+		L_CHECK(!_isComplete) << "The image is complete";
+		png_process_data(_png_ptr, _info_ptr, (png_bytep)data, size);
+	}
+
+	bool PNGStreamDecoder::isHeaderComplete() const
+	{
+		return _isHeaderComplete;
+	}
 
-		// expand grayscale images to RGB  
-		if (color_type == PNG_COLOR_TYPE_GRAY || color_type == PNG_COLOR_TYPE_GRAY_ALPHA) {
-			png_set_gray_to_rgb(_png_ptr);
+	bool PNGStreamDecoder::isComplete() const
+	{
+		return _isComplete;
+	}
+
+	unsigned PNGStreamDecoder::getWidth() const
+	{
+		return _width;
+	}
+
+	unsigned PNGStreamDecoder::getHeight() const
+	{
+		return _height;
+	}
+
+	void PNGStreamDecoder::infoCallback(png_structp png_ptr, png_infop info_ptr)
+	{
+		PNGStreamDecoder* decoder = (PNGStreamDecoder*)png_get_progressive_ptr(png_ptr);
+		decoder->_width = png_get_image_width(png_ptr, info_ptr);
+		decoder->_height = png_get_image_height(png_ptr, info_ptr);
+		decoder->_imageFormat = decoder->_outputFormat;
+		decoder->_numberOfPasses = setTransformations(png_ptr, info_ptr, decoder->_imageFormat, false);
+		decoder->_rowSize = size_t(decoder->_width) * getPixelSize(decoder->_imageFormat);
+		if (decoder->_numberOfPasses > 1)
+			decoder->_interlacedImage.assign(decoder->_rowSize * decoder->_height, 0);
+		decoder->_isHeaderComplete = true;
+		if (decoder->_headerFunction)
+			decoder->_headerFunction(decoder->_width, decoder->_height);
+	}
+
+	void PNGStreamDecoder::rowCallback(png_structp png_ptr, png_bytep new_row, png_uint_32 row_num, int pass)
+	{
+		PNGStreamDecoder* decoder = (PNGStreamDecoder*)png_get_progressive_ptr(png_ptr);
+		if (decoder->_numberOfPasses == 1)
+		{
+			if (decoder->_rowFunction)
+				decoder->_rowFunction(row_num, new_row);
+			decoder->_nextRow = row_num + 1;
+			return;
 		}
+		// rows without pixels in the pass come with a null new_row
+		png_progressive_combine_row(png_ptr, decoder->_interlacedImage.data() + decoder->_rowSize * row_num, new_row);
+		// all rows above the ones of the last pass are complete
+		if (pass == 6)
+			decoder->passRows(row_num + 1);
+	}
+
+	void PNGStreamDecoder::endCallback(png_structp png_ptr, png_infop)
+	{
+		PNGStreamDecoder* decoder = (PNGStreamDecoder*)png_get_progressive_ptr(png_ptr);
+		// the last passes are empty in small images
+		if (decoder->_numberOfPasses > 1)
+			decoder->passRows(decoder->_height);
+		decoder->_isComplete = true;
+	}
 
-		png_set_interlace_handling(_png_ptr);
-		png_read_update_info(_png_ptr, _info_ptr);
+	void PNGStreamDecoder::passRows(unsigned endRow)
+	{
+		for (; _nextRow < endRow; ++_nextRow)
+			if (_rowFunction)
+				_rowFunction(_nextRow, _interlacedImage.data() + _rowSize * _nextRow);
 	}
 }
 #endif
\ No newline at end of file
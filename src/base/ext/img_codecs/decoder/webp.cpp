@@ -1,38 +1,378 @@
 #ifdef HAVE_LIB_WEBP
 #include <base/ext/img_codecs/decoder/webp.h>
+#include <base/ext/img_codecs/pixel_format.h>
 
 #include <base/logging.h>
-#include <webp/decode.h>
+#include <algorithm>
+#include <cstring>
 
 namespace Base
 {
+	// false for the formats libwebp does not decode to
+	static bool getWebPColorspace(PixelFormat format, WEBP_CSP_MODE& colorspace)
+	{
+		switch (format)
+		{
+		case PixelFormat::RGB:
+			colorspace = MODE_RGB;
+			return true;
+		case PixelFormat::BGR:
+			colorspace = MODE_BGR;
+			return true;
+		case PixelFormat::RGBA:
+			colorspace = MODE_RGBA;
+			return true;
+		case PixelFormat::BGRA:
+			colorspace = MODE_BGRA;
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	static const char* getWebPStatusString(VP8StatusCode status)
+	{
+		switch (status)
+		{
+		case VP8_STATUS_OUT_OF_MEMORY:
+			return "Out of memory";
+		case VP8_STATUS_INVALID_PARAM:
+			return "Invalid parameter";
+		case VP8_STATUS_BITSTREAM_ERROR:
+			return "Bitstream error";
+		case VP8_STATUS_UNSUPPORTED_FEATURE:
+			return "Unsupported feature";
+		case VP8_STATUS_SUSPENDED:
+		case VP8_STATUS_NOT_ENOUGH_DATA:
+			return "Truncated image";
+		default:
+			return "Unknown error";
+		}
+	}
+
+	WebPDecoder::WebPDecoder()
+		: _imageWidth(0), _imageHeight(0), _width(0), _height(0), _pointer(nullptr), _size(0)
+	{
+	}
+
 	void WebPDecoder::load(const void* pointer, uint64_t size)
 	{
-		L_CHECK(WebPGetInfo((const uint8_t*)pointer, size, &_width, &_height));
-		L_CHECK_GT(_width, 0);
-		L_CHECK_GT(_height, 0);
+		L_CHECK(WebPGetInfo((const uint8_t*)pointer, size, &_imageWidth, &_imageHeight));
+		L_CHECK_GT(_imageWidth, 0);
+		L_CHECK_GT(_imageHeight, 0);
+		_width = unsigned(_imageWidth);
+		_height = unsigned(_imageHeight);
 		_pointer = pointer;
 		_size = size;
 	}
 
+	void WebPDecoder::setTargetSize(unsigned width, unsigned height)
+	{
+		L_CHECK(_pointer) << "No image is loaded";
+		L_CHECK_GT(width, 0);
+		L_CHECK_GT(height, 0);
+		const uint64_t imageWidth = unsigned(_imageWidth), imageHeight = unsigned(_imageHeight);
+		if (width >= imageWidth || height >= imageHeight)
+		{
+			_width = unsigned(imageWidth);
+			_height = unsigned(imageHeight);
+		}
+		// the dimension shrinking least determines the scale
+		else if (width * imageHeight >= height * imageWidth)
+		{
+			_width = width;
+			_height = std::max(height, unsigned((imageHeight * width + imageWidth - 1) / imageWidth));
+		}
+		else
+		{
+			_width = std::max(width, unsigned((imageWidth * height + imageHeight - 1) / imageHeight));
+			_height = height;
+		}
+	}
+
 	unsigned WebPDecoder::getWidth() const
 	{
-		return unsigned(_width);
+		return _width;
 	}
 
 	unsigned WebPDecoder::getHeight() const
 	{
-		return unsigned(_height);
+		return _height;
 	}
 
 	uint64_t WebPDecoder::getDecompressedSize() const
 	{
-		return uint64_t(_width) * uint64_t(_height) * 3ULL;
+		return getImageSize(_height, _options.format, getRowStride());
+	}
+
+	void WebPDecoder::setOutputFormat(PixelFormat format, unsigned rowAlignment)
+	{
+		ImageDecodeOptions options = _options;
+		options.format = format;
+		options.rowAlignment = rowAlignment;
+		setOptions(options);
+	}
+
+	void WebPDecoder::setOptions(const ImageDecodeOptions& options)
+	{
+		L_CHECK_NE(options.rowAlignment, 0);
+		_options = options;
+	}
+
+	const ImageDecodeOptions& WebPDecoder::getOptions() const
+	{
+		return _options;
+	}
+
+	PixelFormat WebPDecoder::getOutputFormat() const
+	{
+		return _options.format;
+	}
+
+	size_t WebPDecoder::getRowStride() const
+	{
+		return getImageRowStride(_width, _options.format, _options.rowAlignment);
 	}
 
 	void WebPDecoder::decode(void* buffer)
 	{
-		L_CHECK_EQ(WebPDecodeRGBInto((const uint8_t*)_pointer, _size, (uint8_t*)buffer, getDecompressedSize(), uint64_t(_width) * 3ULL), (uint8_t*)buffer);
+		decodeImage(0, 0, _width, _height, (uint8_t*)buffer, getRowStride());
+	}
+
+	void WebPDecoder::decodeRegion(unsigned x, unsigned y, unsigned width, unsigned height, void* buffer)
+	{
+		decodeImage(x, y, width, height, (uint8_t*)buffer, getImageRowStride(width, _options.format, _options.rowAlignment));
+	}
+
+	void WebPDecoder::decodeRows(const std::function<void(const unsigned char*)>& function)
+	{
+		L_CHECK_EQ(getNumberOfPlanes(_options.format), 1) << "Planar formats have no packed rows";
+		const size_t rowSize = size_t(_width) * getPixelSize(_options.format);
+		_image.resize(rowSize * _height);
+		decodeImage(0, 0, _width, _height, _image.data(), rowSize);
+		for (unsigned row = 0; row < _height; ++row)
+			function(_image.data() + row * rowSize);
+	}
+
+	void WebPDecoder::decodeYUV420(const YUV420Planes& planes)
+	{
+		L_CHECK(_pointer) << "No image is loaded";
+		const unsigned chromaWidth = (_width + 1) / 2, chromaHeight = (_height + 1) / 2;
+		L_CHECK_GE(planes.yStride, _width);
+		L_CHECK_GE(planes.uvStride, chromaWidth);
+		WebPDecoderConfig config;
+		initConfig(config);
+		config.output.colorspace = MODE_YUV;
+		config.output.is_external_memory = 1;
+		WebPYUVABuffer& output = config.output.u.YUVA;
+		output.y = planes.y;
+		output.u = planes.u;
+		output.v = planes.v;
+		output.a = nullptr;
+		output.y_stride = int(planes.yStride);
+		output.u_stride = output.v_stride = int(planes.uvStride);
+		output.a_stride = 0;
+		output.y_size = planes.yStride * _height;
+		output.u_size = output.v_size = planes.uvStride * chromaHeight;
+		output.a_size = 0;
+		const VP8StatusCode status = WebPDecode((const uint8_t*)_pointer, _size, &config);
+		L_CHECK_EQ(status, VP8_STATUS_OK) << getWebPStatusString(status);
+	}
+
+	void WebPDecoder::initConfig(WebPDecoderConfig& config) const
+	{
+		L_CHECK(WebPInitDecoderConfig(&config));
+		config.options.use_threads = _options.multiThreaded ? 1 : 0;
+		if (_width != unsigned(_imageWidth) || _height != unsigned(_imageHeight))
+		{
+			config.options.use_scaling = 1;
+			config.options.scaled_width = int(_width);
+			config.options.scaled_height = int(_height);
+		}
+	}
+
+	void WebPDecoder::decodeImage(unsigned x, unsigned y, unsigned width, unsigned height, uint8_t* output, size_t rowStride)
+	{
+		L_CHECK(_pointer) << "No image is loaded";
+		L_CHECK_LE(uint64_t(x) + width, _width);
+		L_CHECK_LE(uint64_t(y) + height, _height);
+		WebPDecoderConfig config;
+		initConfig(config);
+
+		// libwebp crops before scaling and snaps the crop of lossy images to even coordinates,
+		// so scaled images are decoded whole and crops start at even coordinates.
+		// The fancy upsampling replicates the chroma at the crop edges, a margin of one chroma sample
+		// keeps the region identical to the one of the whole image.
+		unsigned decodedX = 0, decodedY = 0, decodedWidth = _width, decodedHeight = _height;
+		if (!config.options.use_scaling && (width != _width || height != _height))
+		{
+			decodedX = x >= 2 ? (x - 2) & ~1U : 0;
+			decodedY = y >= 2 ? (y - 2) & ~1U : 0;
+			decodedWidth = std::min(x + width + 2, _width) - decodedX;
+			decodedHeight = std::min(y + height + 2, _height) - decodedY;
+			config.options.use_cropping = 1;
+			config.options.crop_left = int(decodedX);
+			config.options.crop_top = int(decodedY);
+			config.options.crop_width = int(decodedWidth);
+			config.options.crop_height = int(decodedHeight);
+		}
+
+		WEBP_CSP_MODE colorspace;
+		const bool isNative = getWebPColorspace(_options.format, colorspace);
+		const bool isDirect = isNative && decodedX == x && decodedY == y && decodedWidth == width && decodedHeight == height;
+		if (!isNative)
+			colorspace = MODE_RGB;
+		const size_t pixelSize = isNative ? getPixelSize(_options.format) : 3;
+		uint8_t* decoded = output;
+		size_t decodedRowStride = rowStride;
+		if (!isDirect)
+		{
+			decodedRowStride = decodedWidth * pixelSize;
+			_rowBuffer.resize(decodedRowStride * decodedHeight);
+			decoded = _rowBuffer.data();
+		}
+		config.output.colorspace = colorspace;
+		config.output.is_external_memory = 1;
+		config.output.u.RGBA.rgba = decoded;
+		config.output.u.RGBA.stride = int(decodedRowStride);
+		config.output.u.RGBA.size = decodedRowStride * decodedHeight;
+		const VP8StatusCode status = WebPDecode((const uint8_t*)_pointer, _size, &config);
+		L_CHECK_EQ(status, VP8_STATUS_OK) << getWebPStatusString(status);
+		if (isDirect)
+			return;
+
+		const uint64_t planeSize = uint64_t(rowStride) * height;
+		for (unsigned row = 0; row < height; ++row)
+		{
+			const uint8_t* source = decoded + (y - decodedY + row) * decodedRowStride + (x - decodedX) * pixelSize;
+			if (isNative)
+				memcpy(output + row * rowStride, source, width * pixelSize);
+			else
+				// libwebp has no grayscale or planar RGB output
+				convertRGBRow(source, width, _options.format, output + row * rowStride, planeSize);
+		}
+	}
+
+	WebPStreamDecoder::WebPStreamDecoder()
+		: _decoder(nullptr), _outputFormat(PixelFormat::RGB), _imageFormat(PixelFormat::RGB),
+		_width(0), _height(0), _nextRow(0), _isHeaderComplete(false), _isComplete(false)
+	{
+		reset();
+	}
+
+	WebPStreamDecoder::~WebPStreamDecoder()
+	{
+		if (_decoder)
+			WebPIDelete(_decoder);
+	}
+
+	void WebPStreamDecoder::setOutputFormat(PixelFormat format)
+	{
+		L_CHECK_EQ(getNumberOfPlanes(format), 1) << "Planar formats have no packed rows";
+		_outputFormat = format;
+	}
+
+	PixelFormat WebPStreamDecoder::getOutputFormat() const
+	{
+		return _decoder ? _imageFormat : _outputFormat;
+	}
+
+	void WebPStreamDecoder::setHeaderFunction(std::function<void(unsigned width, unsigned height)> function)
+	{
+		_headerFunction = std::move(function);
+	}
+
+	void WebPStreamDecoder::setRowFunction(std::function<void(unsigned row, const unsigned char* data)> function)
+	{
+		_rowFunction = std::move(function);
+	}
+
+	void WebPStreamDecoder::reset()
+	{
+		if (_decoder)
+			WebPIDelete(_decoder);
+		// created by the first feed of the next image, which fixes its output format
+		_decoder = nullptr;
+		_width = _height = 0;
+		_nextRow = 0;
+		_isHeaderComplete = false;
+		_isComplete = false;
+	}
+
+	void WebPStreamDecoder::feed(const void* data, size_t size)
+	{
+		L_CHECK(!_isComplete) << "The image is complete";
+		if (!_decoder)
+		{
+			_imageFormat = _outputFormat;
+			WEBP_CSP_MODE colorspace;
+			if (!getWebPColorspace(_imageFormat, colorspace))
+				colorspace = MODE_RGB;
+			// decodes into a buffer of its own
+			_decoder = WebPINewRGB(colorspace, nullptr, 0, 0);
+			L_CHECK(_decoder) << "WebPINewRGB()";
+		}
+		const VP8StatusCode status = WebPIAppend(_decoder, (const uint8_t*)data, size);
+		L_CHECK(status == VP8_STATUS_OK || status == VP8_STATUS_SUSPENDED) << getWebPStatusString(status);
+
+		int lastRow, width, height, rowStride;
+		const uint8_t* image = WebPIDecGetRGB(_decoder, &lastRow, &width, &height, &rowStride);
+		// the output buffer exists once the header is parsed
+		if (!image)
+			return;
+		if (!_isHeaderComplete)
+		{
+			_width = unsigned(width);
+			_height = unsigned(height);
+			_row.resize(size_t(_width) * getPixelSize(_imageFormat));
+			_isHeaderComplete = true;
+			if (_headerFunction)
+				_headerFunction(_width, _height);
+		}
+		passRows(unsigned(lastRow), image, size_t(rowStride));
+		if (status == VP8_STATUS_OK)
+		{
+			passRows(_height, image, size_t(rowStride));
+			_isComplete = true;
+		}
+	}
+
+	bool WebPStreamDecoder::isHeaderComplete() const
+	{
+		return _isHeaderComplete;
+	}
+
+	bool WebPStreamDecoder::isComplete() const
+	{
+		return _isComplete;
+	}
+
+	unsigned WebPStreamDecoder::getWidth() const
+	{
+		return _width;
+	}
+
+	unsigned WebPStreamDecoder::getHeight() const
+	{
+		return _height;
+	}
+
+	void WebPStreamDecoder::passRows(unsigned endRow, const uint8_t* image, size_t rowStride)
+	{
+		WEBP_CSP_MODE colorspace;
+		const bool isNative = getWebPColorspace(_imageFormat, colorspace);
+		for (; _nextRow < endRow; ++_nextRow)
+		{
+			if (!_rowFunction)
+				continue;
+			const uint8_t* row = image + _nextRow * rowStride;
+			if (!isNative)
+			{
+				convertRGBRow(row, _width, _imageFormat, _row.data(), _row.size());
+				row = _row.data();
+			}
+			_rowFunction(_nextRow, row);
+		}
 	}
 }
-#endif
\ No newline at end of file
+#endif
@@ -1,6 +1,8 @@
 #include <base/ext/img_codecs/encoder/jpeg.h>
 #include <base/logging.h>
 
+#include <cstdlib>
+
 namespace Base
 {
 
@@ -23,14 +25,18 @@ namespace Base
 	}
 
 	JPEGEncoder::JPEGEncoder()
+		: _memoryDestination(nullptr)
 	{
 		_jpegCompress.err = jpeg_std_error(&jerr);
 		jerr.error_exit = jpegErrorExit;
 		jpeg_create_compress(&_jpegCompress);
 		_jpegCompress.input_components = 3;
 		_jpegCompress.in_color_space = JCS_RGB;
+		_destination.init_destination = initDestination;
+		_destination.empty_output_buffer = emptyOutputBuffer;
+		_destination.term_destination = termDestination;
 		try {
-			jpeg_set_defaults(&_jpegCompress);
+			setOptions(_options);
 		}
 		catch (...)
 		{
@@ -44,35 +50,110 @@ namespace Base
 		jpeg_destroy_compress(&_jpegCompress);
 	}
 
+	void JPEGEncoder::validateOptions(const JPEGEncodeOptions& options)
+	{
+		L_CHECK(options.quality >= 1 && options.quality <= 100) << "Invalid quality " << options.quality;
+	}
+
+	void JPEGEncoder::setOptions(const JPEGEncodeOptions& options)
+	{
+		validateOptions(options);
+		jpeg_set_defaults(&_jpegCompress);
+		jpeg_set_quality(&_jpegCompress, options.quality, TRUE);
+		_jpegCompress.comp_info[0].h_samp_factor = options.subsampling == JPEGChromaSubsampling::YUV444 ? 1 : 2;
+		_jpegCompress.comp_info[0].v_samp_factor = options.subsampling == JPEGChromaSubsampling::YUV420 ? 2 : 1;
+		_jpegCompress.optimize_coding = options.optimizeCoding ? TRUE : FALSE;
+		_jpegCompress.dct_method = options.fastDCT ? JDCT_IFAST : JDCT_ISLOW;
+		if (options.progressive)
+			jpeg_simple_progression(&_jpegCompress);
+		_options = options;
+	}
+
+	const JPEGEncodeOptions& JPEGEncoder::getOptions() const
+	{
+		return _options;
+	}
+
+	void JPEGEncoder::reset()
+	{
+		setOptions(JPEGEncodeOptions());
+	}
+
+	uint64_t JPEGEncoder::getMaximumEncodedSize(unsigned width, unsigned height)
+	{
+		// the bound of tjBufSize() for 4:4:4, which also covers the subsampled images:
+		// at most 6 bytes per pixel of the MCU-padded image plus the headers and tables
+		return (uint64_t(width + 7) & ~uint64_t(7)) * (uint64_t(height + 7) & ~uint64_t(7)) * 6 + 2048;
+	}
+
+	void JPEGEncoder::initDestination(j_compress_ptr)
+	{
+	}
+
+	boolean JPEGEncoder::emptyOutputBuffer(j_compress_ptr)
+	{
+		L_THROW_RUNTIME_EXCEPTION << "Output buffer too small";
+		return FALSE;
+	}
+
+	void JPEGEncoder::termDestination(j_compress_ptr)
+	{
+	}
+
 	JPEGEncoder::JPEGImageContainer JPEGEncoder::encode(const void* rgb, unsigned width, unsigned height)
-	{		
-		_jpegCompress.image_width = width;
-		_jpegCompress.image_height = height;
+	{
 		unsigned char* buffer = nullptr;
-		unsigned long bufferSize;
+		unsigned long bufferSize = 0;
+		// jpeg_mem_dest allocates its manager only while dest is null
+		_jpegCompress.dest = _memoryDestination;
 		jpeg_mem_dest(&_jpegCompress, &buffer, &bufferSize);
-		L_CHECK(buffer);
+		_memoryDestination = _jpegCompress.dest;
+		try {
+			writeImage(rgb, width, height);
+		}
+		catch (...)
+		{
+			free(buffer);
+			throw;
+		}
+		// the doubling leaves up to half of the buffer unused
+		void* shrunkBuffer = realloc(buffer, bufferSize);
+		return JPEGImageContainer(shrunkBuffer ? shrunkBuffer : buffer, bufferSize);
+	}
+
+	size_t JPEGEncoder::encode(const void* rgb, unsigned width, unsigned height, void* buffer, size_t bufferSize)
+	{
+		_destination.next_output_byte = (JOCTET*)buffer;
+		_destination.free_in_buffer = bufferSize;
+		_jpegCompress.dest = &_destination;
+		writeImage(rgb, width, height);
+		return bufferSize - _destination.free_in_buffer;
+	}
+
+	void JPEGEncoder::writeImage(const void* rgb, unsigned width, unsigned height)
+	{
+		_jpegCompress.image_width = width;
+		_jpegCompress.image_height = height;
 		try {
 			jpeg_start_compress(&_jpegCompress, TRUE);
 
-			unsigned long rowStride = width * 3;
-			JSAMPROW input[1];
-			input[0] = (JSAMPROW)rgb;
+			const size_t rowStride = size_t(width) * 3;
+			_rows.resize(height);
+			for (unsigned row = 0; row < height; ++row)
+				_rows[row] = (JSAMPROW)rgb + rowStride * row;
 
+			// libjpeg takes as many rows as it processes at once, a multiple of the MCU height
 			while (_jpegCompress.next_scanline < _jpegCompress.image_height)
-			{
-				L_CHECK_EQ(jpeg_write_scanlines(&_jpegCompress, input, 1), 1);
-				input[0] += rowStride;
-			}
+				L_CHECK_NE(jpeg_write_scanlines(&_jpegCompress, _rows.data() + _jpegCompress.next_scanline, _jpegCompress.image_height - _jpegCompress.next_scanline), 0);
 
 			jpeg_finish_compress(&_jpegCompress);
-
-			return JPEGImageContainer(buffer, bufferSize);
+			_jpegCompress.dest = nullptr;
 		}
 		catch (...)
 		{
-			if (buffer)
-				free(buffer);
+			// ready for the next image
+			jpeg_abort_compress(&_jpegCompress);
+			_jpegCompress.dest = nullptr;
 			throw;
 		}
 	}
@@ -2,7 +2,8 @@
 #include <base/ext/img_codecs/encoder/webp.h>
 
 #include <base/logging.h>
-#include <webp/encode.h>
+#include <cstring>
+#include <limits>
 
 namespace Base
 {
@@ -14,14 +15,157 @@ namespace Base
 		WebPFree(_ptr);
 	}
 
-	WebPEncoder::WebPImageContainer WebPEncoder::encode(const void* rgb, unsigned width, unsigned height)
+	static WebPPreset getWebPPreset(WebPEncodePreset preset)
 	{
-		L_CHECK_LE(width * 3ULL, uint64_t(std::numeric_limits<int>::max()));
+		switch (preset)
+		{
+		case WebPEncodePreset::DEFAULT:
+			return WEBP_PRESET_DEFAULT;
+		case WebPEncodePreset::PICTURE:
+			return WEBP_PRESET_PICTURE;
+		case WebPEncodePreset::PHOTO:
+			return WEBP_PRESET_PHOTO;
+		case WebPEncodePreset::DRAWING:
+			return WEBP_PRESET_DRAWING;
+		case WebPEncodePreset::ICON:
+			return WEBP_PRESET_ICON;
+		case WebPEncodePreset::TEXT:
+			return WEBP_PRESET_TEXT;
+		default:
+			L_UNREACHABLE_ERROR;
+			return WEBP_PRESET_DEFAULT;
+		}
+	}
+
+	static const char* getWebPEncodingErrorString(WebPEncodingError error)
+	{
+		switch (error)
+		{
+		case VP8_ENC_ERROR_OUT_OF_MEMORY:
+		case VP8_ENC_ERROR_BITSTREAM_OUT_OF_MEMORY:
+			return "Out of memory";
+		case VP8_ENC_ERROR_NULL_PARAMETER:
+			return "Null parameter";
+		case VP8_ENC_ERROR_INVALID_CONFIGURATION:
+			return "Invalid configuration";
+		case VP8_ENC_ERROR_BAD_DIMENSION:
+			return "Bad dimension";
+		case VP8_ENC_ERROR_PARTITION0_OVERFLOW:
+		case VP8_ENC_ERROR_PARTITION_OVERFLOW:
+			return "Partition overflow";
+		case VP8_ENC_ERROR_BAD_WRITE:
+			return "Output buffer too small";
+		case VP8_ENC_ERROR_FILE_TOO_BIG:
+			return "File too big";
+		case VP8_ENC_ERROR_USER_ABORT:
+			return "User abort";
+		default:
+			return "Unknown error";
+		}
+	}
+
+	// writes into the buffer of a BufferWriter, fails the encoding once it is full
+	struct BufferWriter
+	{
+		uint8_t* buffer;
+		size_t size;
+		size_t position;
+	};
+
+	static int writeToBuffer(const uint8_t* data, size_t size, const WebPPicture* picture)
+	{
+		BufferWriter* writer = (BufferWriter*)picture->custom_ptr;
+		if (size > writer->size - writer->position)
+			return 0;
+		memcpy(writer->buffer + writer->position, data, size);
+		writer->position += size;
+		return 1;
+	}
+
+	WebPEncoder::WebPEncoder()
+	{
+		L_CHECK(WebPPictureInit(&_picture));
+		WebPMemoryWriterInit(&_writer);
+		setOptions(_options);
+	}
+
+	WebPEncoder::~WebPEncoder()
+	{
+		WebPPictureFree(&_picture);
+		WebPMemoryWriterClear(&_writer);
+	}
+
+	void WebPEncoder::setOptions(const WebPEncodeOptions& options)
+	{
+		WebPConfig config;
+		L_CHECK(WebPConfigPreset(&config, getWebPPreset(options.preset), options.quality));
+		config.method = options.method;
+		config.lossless = options.lossless ? 1 : 0;
+		config.near_lossless = options.nearLossless;
+		config.thread_level = options.multiThreaded ? 1 : 0;
+		L_CHECK(WebPValidateConfig(&config)) << "Invalid WebP encoding options";
+		_config = config;
+		_options = options;
+	}
+
+	const WebPEncodeOptions& WebPEncoder::getOptions() const
+	{
+		return _options;
+	}
+
+	WebPEncoder::WebPImageContainer WebPEncoder::encode(const void* pixels, unsigned width, unsigned height, PixelFormat format)
+	{
+		_writer.size = 0;
+		_picture.writer = WebPMemoryWrite;
+		_picture.custom_ptr = &_writer;
+		encodePicture(pixels, width, height, format);
+		// the writer keeps its buffer for the next image, so the container gets a copy
+		void* output = WebPMalloc(_writer.size);
+		L_CHECK(output) << "Failed to allocate " << _writer.size << " bytes";
+		memcpy(output, _writer.mem, _writer.size);
+		return WebPImageContainer(output, _writer.size);
+	}
+
+	size_t WebPEncoder::encode(const void* pixels, unsigned width, unsigned height, PixelFormat format, void* buffer, size_t bufferSize)
+	{
+		BufferWriter writer = { (uint8_t*)buffer, bufferSize, 0 };
+		_picture.writer = writeToBuffer;
+		_picture.custom_ptr = &writer;
+		encodePicture(pixels, width, height, format);
+		return writer.position;
+	}
+
+	void WebPEncoder::encodePicture(const void* pixels, unsigned width, unsigned height, PixelFormat format)
+	{
+		const unsigned bytesPerPixel = format == PixelFormat::RGB || format == PixelFormat::BGR ? 3 : 4;
+		L_CHECK_LE(uint64_t(width) * bytesPerPixel, uint64_t(std::numeric_limits<int>::max()));
 		L_CHECK_LE(height, unsigned(std::numeric_limits<int>::max()));
-		uint8_t* output;
-		const size_t size = WebPEncodeRGB((const uint8_t*)rgb, int(width), int(height), 3 * int(width), 80, &output);
-		L_CHECK(size);
-		return WebPImageContainer(output, size);
+		const int rowStride = int(width * bytesPerPixel);
+
+		// the lossless encoder works on ARGB, the lossy one on YUV
+		_picture.use_argb = _config.lossless;
+		_picture.width = int(width);
+		_picture.height = int(height);
+		int imported = 0;
+		switch (format)
+		{
+		case PixelFormat::RGB:
+			imported = WebPPictureImportRGB(&_picture, (const uint8_t*)pixels, rowStride);
+			break;
+		case PixelFormat::BGR:
+			imported = WebPPictureImportBGR(&_picture, (const uint8_t*)pixels, rowStride);
+			break;
+		case PixelFormat::RGBA:
+			imported = WebPPictureImportRGBA(&_picture, (const uint8_t*)pixels, rowStride);
+			break;
+		case PixelFormat::BGRA:
+			imported = WebPPictureImportBGRA(&_picture, (const uint8_t*)pixels, rowStride);
+			break;
+		default:
+			L_THROW_RUNTIME_EXCEPTION << "Unsupported pixel format";
+		}
+		L_CHECK(imported) << getWebPEncodingErrorString(_picture.error_code);
+		L_CHECK(WebPEncode(&_config, &_picture)) << getWebPEncodingErrorString(_picture.error_code);
 	}
 }
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,337 @@
+#include <base/ext/img_codecs/format_detection.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace Base
+{
+	template <size_t Size>
+	static bool hasSignature(const unsigned char* data, size_t size, size_t offset, const char(&signature)[Size])
+	{
+		return size >= offset + Size - 1 && memcmp(data + offset, signature, Size - 1) == 0;
+	}
+
+	ImageFormatType detectImageFormat(const void* buffer, size_t size)
+	{
+		const unsigned char* data = static_cast<const unsigned char*>(buffer);
+		if (hasSignature(data, size, 0, "\xFF\xD8\xFF"))
+			return ImageFormatType::JPEG;
+		if (hasSignature(data, size, 0, "\x89PNG\r\n\x1A\n"))
+			return ImageFormatType::PNG;
+		if (hasSignature(data, size, 0, "RIFF") && hasSignature(data, size, 8, "WEBP"))
+			return ImageFormatType::WEBP;
+		if (hasSignature(data, size, 0, "GIF87a") || hasSignature(data, size, 0, "GIF89a"))
+			return ImageFormatType::GIF;
+		// "BM" alone is too weak, the reserved fields of the file header are zero as well
+		if (hasSignature(data, size, 0, "BM") && hasSignature(data, size, 6, "\0\0\0\0"))
+			return ImageFormatType::BMP;
+		return ImageFormatType::UNKNOWN;
+	}
+
+	static uint32_t readBigEndian16(const unsigned char* data)
+	{
+		return uint32_t(data[0]) << 8 | data[1];
+	}
+
+	static uint32_t readBigEndian32(const unsigned char* data)
+	{
+		return uint32_t(data[0]) << 24 | uint32_t(data[1]) << 16 | uint32_t(data[2]) << 8 | data[3];
+	}
+
+	static uint32_t readLittleEndian16(const unsigned char* data)
+	{
+		return uint32_t(data[1]) << 8 | data[0];
+	}
+
+	static uint32_t readLittleEndian24(const unsigned char* data)
+	{
+		return uint32_t(data[2]) << 16 | uint32_t(data[1]) << 8 | data[0];
+	}
+
+	static uint32_t readLittleEndian32(const unsigned char* data)
+	{
+		return readLittleEndian24(data) | uint32_t(data[3]) << 24;
+	}
+
+	// reads the orientation tag of IFD0 of the TIFF structure in an APP1 segment
+	static bool readEXIFOrientation(const unsigned char* data, size_t size, ImageOrientation& orientation)
+	{
+		if (!hasSignature(data, size, 0, "Exif\0\0") || size < 6 + 8)
+			return false;
+		const unsigned char* tiff = data + 6;
+		const size_t tiffSize = size - 6;
+		bool isBigEndian;
+		if (hasSignature(tiff, tiffSize, 0, "MM\0\x2A"))
+			isBigEndian = true;
+		else if (hasSignature(tiff, tiffSize, 0, "II\x2A\0"))
+			isBigEndian = false;
+		else
+			return false;
+		auto read16 = [isBigEndian](const unsigned char* value) { return isBigEndian ? readBigEndian16(value) : readLittleEndian16(value); };
+		auto read32 = [isBigEndian](const unsigned char* value) { return isBigEndian ? readBigEndian32(value) : readLittleEndian32(value); };
+		const size_t directory = read32(tiff + 4);
+		if (directory > tiffSize - 2)
+			return false;
+		const size_t numberOfEntries = read16(tiff + directory);
+		for (size_t index = 0; index < numberOfEntries; ++index)
+		{
+			const size_t entry = directory + 2 + index * 12;
+			if (entry + 12 > tiffSize)
+				return false;
+			// a SHORT, stored in the first two bytes of the value field
+			if (read16(tiff + entry) == 0x0112 && read16(tiff + entry + 2) == 3)
+			{
+				const uint32_t value = read16(tiff + entry + 8);
+				if (value < 1 || value > 8)
+					return false;
+				orientation = ImageOrientation(value);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	static bool probeJPEG(const unsigned char* data, size_t size, ImageInfo& info)
+	{
+		// markers follow each other up to the frame header, entropy-coded data comes after SOS only
+		size_t position = 2;
+		while (position + 4 <= size)
+		{
+			if (data[position] != 0xFF)
+				return false;
+			const unsigned char marker = data[position + 1];
+			if (marker == 0xFF)
+			{
+				// fill byte
+				++position;
+				continue;
+			}
+			if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD8))
+			{
+				position += 2;
+				continue;
+			}
+			if (marker == 0xD9 || marker == 0xDA)
+				return false;
+			const size_t length = readBigEndian16(data + position + 2);
+			if (length < 2)
+				return false;
+			// EXIF comes in APP1, in front of the frame header
+			if (marker == 0xE1 && position + 2 + length <= size)
+				readEXIFOrientation(data + position + 4, length - 2, info.orientation);
+			// SOF0 to SOF15 except DHT, JPG and DAC
+			if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC)
+			{
+				if (length < 8 || position + 10 > size)
+					return false;
+				const unsigned char* frameHeader = data + position + 4;
+				info.bitDepth = frameHeader[0];
+				info.height = readBigEndian16(frameHeader + 1);
+				info.width = readBigEndian16(frameHeader + 3);
+				info.numberOfChannels = frameHeader[5];
+				info.hasAlpha = false;
+				info.isProgressive = marker == 0xC2 || marker == 0xC6 || marker == 0xCA || marker == 0xCE;
+				// a height of zero is defined by a DNL marker after the first scan
+				return info.width != 0 && info.height != 0 && info.numberOfChannels != 0;
+			}
+			position += 2 + length;
+		}
+		return false;
+	}
+
+	static bool probePNG(const unsigned char* data, size_t size, ImageInfo& info)
+	{
+		if (!hasSignature(data, size, 12, "IHDR") || readBigEndian32(data + 8) != 13 || size < 8 + 8 + 13)
+			return false;
+		const unsigned char* header = data + 16;
+		info.width = readBigEndian32(header);
+		info.height = readBigEndian32(header + 4);
+		info.bitDepth = header[8];
+		const unsigned char colorType = header[9];
+		info.isProgressive = header[12] == 1;
+		switch (colorType)
+		{
+		case 0:
+			info.numberOfChannels = 1;
+			break;
+		case 2:
+		case 3:
+			info.numberOfChannels = 3;
+			break;
+		case 4:
+			info.numberOfChannels = 2;
+			break;
+		case 6:
+			info.numberOfChannels = 4;
+			break;
+		default:
+			return false;
+		}
+		info.hasAlpha = (colorType & 4) != 0;
+		if (!info.hasAlpha)
+		{
+			// a tRNS chunk comes before the first IDAT
+			size_t position = 8 + 12 + 13;
+			while (position + 8 <= size && !hasSignature(data, size, position + 4, "IDAT"))
+			{
+				if (hasSignature(data, size, position + 4, "tRNS"))
+				{
+					info.hasAlpha = true;
+					if (colorType == 3)
+						info.numberOfChannels = 4;
+					break;
+				}
+				position += 12 + uint64_t(readBigEndian32(data + position));
+			}
+		}
+		return info.width != 0 && info.height != 0;
+	}
+
+	static bool probeWebP(const unsigned char* data, size_t size, ImageInfo& info)
+	{
+		info.bitDepth = 8;
+		info.isProgressive = false;
+		if (hasSignature(data, size, 12, "VP8 "))
+		{
+			// lossy, a key frame starts with the frame tag and the start code
+			if (size < 30 || !hasSignature(data, size, 23, "\x9D\x01\x2A"))
+				return false;
+			info.width = readLittleEndian16(data + 26) & 0x3FFF;
+			info.height = readLittleEndian16(data + 28) & 0x3FFF;
+			info.numberOfChannels = 3;
+			info.hasAlpha = false;
+		}
+		else if (hasSignature(data, size, 12, "VP8L"))
+		{
+			if (size < 25 || data[20] != 0x2F)
+				return false;
+			const uint32_t bits = readLittleEndian32(data + 21);
+			info.width = (bits & 0x3FFF) + 1;
+			info.height = ((bits >> 14) & 0x3FFF) + 1;
+			info.hasAlpha = ((bits >> 28) & 1) != 0;
+			info.numberOfChannels = info.hasAlpha ? 4 : 3;
+		}
+		else if (hasSignature(data, size, 12, "VP8X"))
+		{
+			if (size < 30)
+				return false;
+			info.hasAlpha = (data[20] & 0x10) != 0;
+			info.width = readLittleEndian24(data + 24) + 1;
+			info.height = readLittleEndian24(data + 27) + 1;
+			info.numberOfChannels = info.hasAlpha ? 4 : 3;
+		}
+		else
+			return false;
+		return info.width != 0 && info.height != 0;
+	}
+
+	static bool probeGIF(const unsigned char* data, size_t size, ImageInfo& info)
+	{
+		if (size < 10)
+			return false;
+		info.width = readLittleEndian16(data + 6);
+		info.height = readLittleEndian16(data + 8);
+		info.numberOfChannels = 3;
+		info.bitDepth = 8;
+		info.hasAlpha = false;
+		info.isProgressive = false;
+		return info.width != 0 && info.height != 0;
+	}
+
+	static bool probeBMP(const unsigned char* data, size_t size, ImageInfo& info)
+	{
+		if (size < 18)
+			return false;
+		const uint32_t headerSize = readLittleEndian32(data + 14);
+		if (headerSize == 12)
+		{
+			// OS/2 BITMAPCOREHEADER
+			if (size < 26)
+				return false;
+			info.width = readLittleEndian16(data + 18);
+			info.height = readLittleEndian16(data + 20);
+			info.bitDepth = readLittleEndian16(data + 24);
+		}
+		else if (headerSize >= 40)
+		{
+			if (size < 30)
+				return false;
+			info.width = (unsigned)std::abs((int32_t)readLittleEndian32(data + 18));
+			// negative for top-down images
+			info.height = (unsigned)std::abs((int32_t)readLittleEndian32(data + 22));
+			info.bitDepth = readLittleEndian16(data + 28);
+		}
+		else
+			return false;
+		info.hasAlpha = info.bitDepth == 32;
+		info.numberOfChannels = info.hasAlpha ? 4 : 3;
+		info.isProgressive = false;
+		return info.width != 0 && info.height != 0;
+	}
+
+	bool probeImage(const void* buffer, size_t size, ImageInfo& info)
+	{
+		const unsigned char* data = static_cast<const unsigned char*>(buffer);
+		info.format = detectImageFormat(buffer, size);
+		info.orientation = ImageOrientation::NORMAL;
+		bool succeeded = false;
+		switch (info.format)
+		{
+		case ImageFormatType::JPEG:
+			succeeded = probeJPEG(data, size, info);
+			break;
+		case ImageFormatType::PNG:
+			succeeded = probePNG(data, size, info);
+			break;
+		case ImageFormatType::WEBP:
+			succeeded = probeWebP(data, size, info);
+			break;
+		case ImageFormatType::GIF:
+			succeeded = probeGIF(data, size, info);
+			break;
+		case ImageFormatType::BMP:
+			succeeded = probeBMP(data, size, info);
+			break;
+		default:
+			break;
+		}
+		if (!succeeded)
+			info.format = ImageFormatType::UNKNOWN;
+		return succeeded;
+	}
+
+	ImageOrientation getImageOrientation(const void* buffer, size_t size)
+	{
+		ImageInfo info;
+		if (!probeImage(buffer, size, info))
+			return ImageOrientation::NORMAL;
+		return info.orientation;
+	}
+
+	size_t probeImages(const void* const* buffers, const size_t* sizes, size_t numberOfImages, ImageInfo* infos, WorkStealingThreadPool* threadPool)
+	{
+		if (!threadPool)
+		{
+			size_t numberOfProbedImages = 0;
+			for (size_t index = 0; index < numberOfImages; ++index)
+				numberOfProbedImages += probeImage(buffers[index], sizes[index], infos[index]);
+			return numberOfProbedImages;
+		}
+		// a task per image would cost more than probing it
+		const size_t imagesPerTask = 256;
+		std::vector<size_t> numberOfProbedImages(threadPool->getNumberOfThreads(), 0);
+		threadPool->parallelFor((numberOfImages + imagesPerTask - 1) / imagesPerTask, [&](unsigned workerIndex, size_t task)
+		{
+			const size_t end = std::min(numberOfImages, (task + 1) * imagesPerTask);
+			for (size_t index = task * imagesPerTask; index < end; ++index)
+				numberOfProbedImages[workerIndex] += probeImage(buffers[index], sizes[index], infos[index]);
+		});
+		size_t total = 0;
+		for (size_t count : numberOfProbedImages)
+			total += count;
+		return total;
+	}
+}
@@ -0,0 +1,283 @@
+#ifdef HAVE_LIB_JPEG
+#include <base/ext/img_codecs/jpeg_transformer.h>
+
+#include <base/logging.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace Base
+{
+	static void jpegErrorExit(j_common_ptr cinfo)
+	{
+		char jpegLastErrorMsg[JMSG_LENGTH_MAX];
+		(*(cinfo->err->format_message)) (cinfo, jpegLastErrorMsg);
+
+		L_THROW_RUNTIME_EXCEPTION << jpegLastErrorMsg;
+	}
+
+	static bool isTransposing(JPEGTransformOperation operation)
+	{
+		return operation == JPEGTransformOperation::TRANSPOSE || operation == JPEGTransformOperation::TRANSVERSE
+			|| operation == JPEGTransformOperation::ROTATE_90 || operation == JPEGTransformOperation::ROTATE_270;
+	}
+
+	// whether the transformed image is mirrored horizontally after the transposition
+	static bool isFlippingX(JPEGTransformOperation operation)
+	{
+		return operation == JPEGTransformOperation::FLIP_HORIZONTAL || operation == JPEGTransformOperation::TRANSVERSE
+			|| operation == JPEGTransformOperation::ROTATE_90 || operation == JPEGTransformOperation::ROTATE_180;
+	}
+
+	static bool isFlippingY(JPEGTransformOperation operation)
+	{
+		return operation == JPEGTransformOperation::FLIP_VERTICAL || operation == JPEGTransformOperation::TRANSVERSE
+			|| operation == JPEGTransformOperation::ROTATE_180 || operation == JPEGTransformOperation::ROTATE_270;
+	}
+
+	static void transformBlock(const JCOEF* source, JCOEF* destination, bool transpose, bool flipX, bool flipY)
+	{
+		for (unsigned v = 0; v < DCTSIZE; ++v)
+			for (unsigned u = 0; u < DCTSIZE; ++u)
+			{
+				const JCOEF coefficient = transpose ? source[u * DCTSIZE + v] : source[v * DCTSIZE + u];
+				// mirroring changes the sign of the odd frequencies in its direction
+				const bool negate = (flipX && (u & 1)) != (flipY && (v & 1));
+				destination[v * DCTSIZE + u] = negate ? JCOEF(-coefficient) : coefficient;
+			}
+	}
+
+	static unsigned divideRoundUp(unsigned dividend, unsigned divisor)
+	{
+		return (dividend + divisor - 1) / divisor;
+	}
+
+	// sets the orientation tag of IFD0 of the TIFF structure in an APP1 segment to 1, if there is one
+	static void resetEXIFOrientation(unsigned char* data, size_t size)
+	{
+		if (size < 6 + 8 || memcmp(data, "Exif\0\0", 6) != 0)
+			return;
+		unsigned char* tiff = data + 6;
+		const size_t tiffSize = size - 6;
+		bool isBigEndian;
+		if (memcmp(tiff, "MM\0\x2A", 4) == 0)
+			isBigEndian = true;
+		else if (memcmp(tiff, "II\x2A\0", 4) == 0)
+			isBigEndian = false;
+		else
+			return;
+		auto read16 = [isBigEndian](const unsigned char* value) { return isBigEndian ? uint32_t(value[0]) << 8 | value[1] : uint32_t(value[1]) << 8 | value[0]; };
+		auto read32 = [isBigEndian, read16](const unsigned char* value) { return isBigEndian ? read16(value) << 16 | read16(value + 2) : read16(value + 2) << 16 | read16(value); };
+		const size_t directory = read32(tiff + 4);
+		if (directory > tiffSize - 2)
+			return;
+		const size_t numberOfEntries = read16(tiff + directory);
+		for (size_t index = 0; index < numberOfEntries; ++index)
+		{
+			const size_t entry = directory + 2 + index * 12;
+			if (entry + 12 > tiffSize)
+				return;
+			// a SHORT, stored in the first two bytes of the value field
+			if (read16(tiff + entry) == 0x0112 && read16(tiff + entry + 2) == 3)
+			{
+				tiff[entry + 8] = isBigEndian ? 0 : 1;
+				tiff[entry + 9] = isBigEndian ? 1 : 0;
+				return;
+			}
+		}
+	}
+
+	JPEGTransformer::JPEGTransformer()
+		: _width(0), _height(0)
+	{
+		_decompress.err = jpeg_std_error(&_decompressErrorManager);
+		_decompressErrorManager.error_exit = jpegErrorExit;
+		jpeg_create_decompress(&_decompress);
+		_compress.err = jpeg_std_error(&_compressErrorManager);
+		_compressErrorManager.error_exit = jpegErrorExit;
+		try {
+			jpeg_create_compress(&_compress);
+		}
+		catch (...)
+		{
+			jpeg_destroy_decompress(&_decompress);
+			throw;
+		}
+	}
+
+	JPEGTransformer::~JPEGTransformer()
+	{
+		jpeg_destroy_compress(&_compress);
+		jpeg_destroy_decompress(&_decompress);
+	}
+
+	JPEGEncoder::JPEGImageContainer JPEGTransformer::transform(const void* image, size_t size, const JPEGTransformOptions& options)
+	{
+		unsigned char* buffer = nullptr;
+		unsigned long bufferSize = 0;
+		try {
+			jpeg_mem_src(&_decompress, (const unsigned char*)image, (unsigned long)size);
+			jpeg_save_markers(&_decompress, JPEG_COM, options.copyMarkers ? 0xFFFF : 0);
+			for (int marker = 0; marker < 16; ++marker)
+				jpeg_save_markers(&_decompress, JPEG_APP0 + marker, options.copyMarkers ? 0xFFFF : 0);
+			L_CHECK_EQ(jpeg_read_header(&_decompress, TRUE), JPEG_HEADER_OK);
+
+			// geometry of the transformed image, in pixels
+			const JPEGTransformOperation operation = options.operation;
+			const bool transpose = isTransposing(operation), flipX = isFlippingX(operation), flipY = isFlippingY(operation);
+			const unsigned maxHorizontalSampling = transpose ? _decompress.max_v_samp_factor : _decompress.max_h_samp_factor;
+			const unsigned maxVerticalSampling = transpose ? _decompress.max_h_samp_factor : _decompress.max_v_samp_factor;
+			const unsigned mcuWidth = maxHorizontalSampling * DCTSIZE, mcuHeight = maxVerticalSampling * DCTSIZE;
+			unsigned imageWidth = transpose ? _decompress.image_height : _decompress.image_width;
+			unsigned imageHeight = transpose ? _decompress.image_width : _decompress.image_height;
+			// partial iMCUs cannot be moved away from the right and bottom edges
+			if (flipX && imageWidth % mcuWidth)
+			{
+				L_CHECK(!options.perfect) << "The image width is not a multiple of " << mcuWidth;
+				imageWidth -= imageWidth % mcuWidth;
+			}
+			if (flipY && imageHeight % mcuHeight)
+			{
+				L_CHECK(!options.perfect) << "The image height is not a multiple of " << mcuHeight;
+				imageHeight -= imageHeight % mcuHeight;
+			}
+			L_CHECK(imageWidth != 0 && imageHeight != 0) << "The image is smaller than an iMCU";
+			unsigned x = 0, y = 0, width = imageWidth, height = imageHeight;
+			if (options.cropWidth != 0 && options.cropHeight != 0)
+			{
+				L_CHECK_LE(uint64_t(options.cropX) + options.cropWidth, imageWidth);
+				L_CHECK_LE(uint64_t(options.cropY) + options.cropHeight, imageHeight);
+				x = options.cropX / mcuWidth * mcuWidth;
+				y = options.cropY / mcuHeight * mcuHeight;
+				width = options.cropX + options.cropWidth - x;
+				height = options.cropY + options.cropHeight - y;
+			}
+
+			// geometry of the components, in blocks
+			struct Component
+			{
+				unsigned horizontalSampling, verticalSampling;
+				// of the transformed image before cropping
+				unsigned imageWidth, imageHeight;
+				unsigned x, y, width, height;
+			};
+			std::vector<Component> components(_decompress.num_components);
+			std::vector<jvirt_barray_ptr> coefficients(_decompress.num_components);
+			for (int index = 0; index < _decompress.num_components; ++index)
+			{
+				const jpeg_component_info& sourceComponent = _decompress.comp_info[index];
+				Component& component = components[index];
+				component.horizontalSampling = transpose ? sourceComponent.v_samp_factor : sourceComponent.h_samp_factor;
+				component.verticalSampling = transpose ? sourceComponent.h_samp_factor : sourceComponent.v_samp_factor;
+				component.imageWidth = divideRoundUp(imageWidth * component.horizontalSampling, mcuWidth);
+				component.imageHeight = divideRoundUp(imageHeight * component.verticalSampling, mcuHeight);
+				component.x = x / mcuWidth * component.horizontalSampling;
+				component.y = y / mcuHeight * component.verticalSampling;
+				component.width = divideRoundUp(width * component.horizontalSampling, mcuWidth);
+				component.height = divideRoundUp(height * component.verticalSampling, mcuHeight);
+				// requested before jpeg_read_coefficients realizes the arrays, padded to whole iMCUs
+				coefficients[index] = (*_decompress.mem->request_virt_barray)((j_common_ptr)&_decompress, JPOOL_IMAGE, TRUE,
+					divideRoundUp(component.width, component.horizontalSampling) * component.horizontalSampling,
+					divideRoundUp(component.height, component.verticalSampling) * component.verticalSampling, component.verticalSampling);
+			}
+			jvirt_barray_ptr* sourceCoefficients = jpeg_read_coefficients(&_decompress);
+
+			for (int index = 0; index < _decompress.num_components; ++index)
+			{
+				const Component& component = components[index];
+				for (unsigned row = 0; row < component.height; ++row)
+				{
+					JBLOCKROW destination = (*_decompress.mem->access_virt_barray)((j_common_ptr)&_decompress, coefficients[index], row, 1, TRUE)[0];
+					if (!transpose)
+					{
+						// the whole row comes from a single source row
+						const unsigned sourceRow = flipY ? component.imageHeight - 1 - (component.y + row) : component.y + row;
+						JBLOCKROW source = (*_decompress.mem->access_virt_barray)((j_common_ptr)&_decompress, sourceCoefficients[index], sourceRow, 1, FALSE)[0];
+						for (unsigned column = 0; column < component.width; ++column)
+						{
+							const unsigned sourceColumn = flipX ? component.imageWidth - 1 - (component.x + column) : component.x + column;
+							transformBlock(source[sourceColumn], destination[column], false, flipX, flipY);
+						}
+						continue;
+					}
+					// every block of the row comes from a different source row
+					for (unsigned column = 0; column < component.width; ++column)
+					{
+						// the block in the transformed image, then the one of the source image
+						unsigned sourceColumn = component.x + column, sourceRow = component.y + row;
+						if (flipX)
+							sourceColumn = component.imageWidth - 1 - sourceColumn;
+						if (flipY)
+							sourceRow = component.imageHeight - 1 - sourceRow;
+						std::swap(sourceColumn, sourceRow);
+						JBLOCKROW source = (*_decompress.mem->access_virt_barray)((j_common_ptr)&_decompress, sourceCoefficients[index], sourceRow, 1, FALSE)[0];
+						transformBlock(source[sourceColumn], destination[column], transpose, flipX, flipY);
+					}
+				}
+			}
+
+			jpeg_copy_critical_parameters(&_decompress, &_compress);
+			_compress.image_width = width;
+			_compress.image_height = height;
+			for (int index = 0; index < _compress.num_components; ++index)
+			{
+				_compress.comp_info[index].h_samp_factor = int(components[index].horizontalSampling);
+				_compress.comp_info[index].v_samp_factor = int(components[index].verticalSampling);
+			}
+			if (transpose)
+			{
+				for (JQUANT_TBL* table : _compress.quant_tbl_ptrs)
+				{
+					if (!table)
+						continue;
+					for (unsigned v = 0; v < DCTSIZE; ++v)
+						for (unsigned u = v + 1; u < DCTSIZE; ++u)
+							std::swap(table->quantval[v * DCTSIZE + u], table->quantval[u * DCTSIZE + v]);
+				}
+			}
+			_compress.optimize_coding = options.optimizeCoding ? TRUE : FALSE;
+			if (options.progressive)
+				jpeg_simple_progression(&_compress);
+
+			jpeg_mem_dest(&_compress, &buffer, &bufferSize);
+			jpeg_write_coefficients(&_compress, coefficients.data());
+			for (jpeg_saved_marker_ptr marker = _decompress.marker_list; marker; marker = marker->next)
+			{
+				if (options.resetOrientation && operation != JPEGTransformOperation::NONE && marker->marker == JPEG_APP0 + 1)
+					resetEXIFOrientation(marker->data, marker->data_length);
+				// written by jpeg_write_coefficients already
+				if (_compress.write_JFIF_header && marker->marker == JPEG_APP0 && marker->data_length >= 5 && memcmp(marker->data, "JFIF", 5) == 0)
+					continue;
+				if (_compress.write_Adobe_marker && marker->marker == JPEG_APP0 + 14 && marker->data_length >= 5 && memcmp(marker->data, "Adobe", 5) == 0)
+					continue;
+				jpeg_write_marker(&_compress, marker->marker, marker->data, marker->data_length);
+			}
+			jpeg_finish_compress(&_compress);
+			jpeg_finish_decompress(&_decompress);
+		}
+		catch (...)
+		{
+			jpeg_abort_compress(&_compress);
+			jpeg_abort_decompress(&_decompress);
+			free(buffer);
+			throw;
+		}
+		_width = _compress.image_width;
+		_height = _compress.image_height;
+		return JPEGEncoder::JPEGImageContainer(buffer, bufferSize);
+	}
+
+	unsigned JPEGTransformer::getWidth() const
+	{
+		return _width;
+	}
+
+	unsigned JPEGTransformer::getHeight() const
+	{
+		return _height;
+	}
+}
+#endif
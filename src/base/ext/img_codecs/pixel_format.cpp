@@ -0,0 +1,99 @@
+#include <base/ext/img_codecs/pixel_format.h>
+
+#include <base/logging.h>
+
+#include <cstring>
+
+namespace Base
+{
+	unsigned getPixelSize(PixelFormat format)
+	{
+		switch (format)
+		{
+		case PixelFormat::RGB:
+		case PixelFormat::BGR:
+			return 3;
+		case PixelFormat::RGBA:
+		case PixelFormat::BGRA:
+			return 4;
+		case PixelFormat::GRAY:
+		case PixelFormat::RGB_PLANAR:
+			return 1;
+		default:
+			L_NOT_IMPLEMENTED_ERROR;
+			return 0;
+		}
+	}
+
+	unsigned getNumberOfPlanes(PixelFormat format)
+	{
+		return format == PixelFormat::RGB_PLANAR ? 3 : 1;
+	}
+
+	size_t getImageRowStride(unsigned width, PixelFormat format, unsigned rowAlignment)
+	{
+		L_CHECK_NE(rowAlignment, 0);
+		const size_t rowSize = size_t(width) * getPixelSize(format);
+		return (rowSize + rowAlignment - 1) / rowAlignment * rowAlignment;
+	}
+
+	uint64_t getImageSize(unsigned height, PixelFormat format, size_t rowStride)
+	{
+		return uint64_t(rowStride) * height * getNumberOfPlanes(format);
+	}
+
+	void convertRGBRow(const unsigned char* source, unsigned width, PixelFormat format, unsigned char* row, uint64_t planeSize)
+	{
+		switch (format)
+		{
+		case PixelFormat::RGB:
+			memcpy(row, source, size_t(width) * 3);
+			break;
+		case PixelFormat::BGR:
+			for (unsigned x = 0; x < width; ++x, source += 3, row += 3)
+			{
+				row[0] = source[2];
+				row[1] = source[1];
+				row[2] = source[0];
+			}
+			break;
+		case PixelFormat::RGBA:
+			for (unsigned x = 0; x < width; ++x, source += 3, row += 4)
+			{
+				row[0] = source[0];
+				row[1] = source[1];
+				row[2] = source[2];
+				row[3] = 0xFF;
+			}
+			break;
+		case PixelFormat::BGRA:
+			for (unsigned x = 0; x < width; ++x, source += 3, row += 4)
+			{
+				row[0] = source[2];
+				row[1] = source[1];
+				row[2] = source[0];
+				row[3] = 0xFF;
+			}
+			break;
+		case PixelFormat::GRAY:
+			// ITU-R BT.601 luma, the same weights libjpeg uses
+			for (unsigned x = 0; x < width; ++x, source += 3)
+				row[x] = (unsigned char)((source[0] * 19595U + source[1] * 38470U + source[2] * 7471U + 32768U) >> 16);
+			break;
+		case PixelFormat::RGB_PLANAR:
+		{
+			unsigned char* green = row + planeSize;
+			unsigned char* blue = green + planeSize;
+			for (unsigned x = 0; x < width; ++x, source += 3)
+			{
+				row[x] = source[0];
+				green[x] = source[1];
+				blue[x] = source[2];
+			}
+			break;
+		}
+		default:
+			L_NOT_IMPLEMENTED_ERROR;
+		}
+	}
+}
@@ -0,0 +1,446 @@
+#include <base/ext/img_codecs/processing/scaler.h>
+
+#include <base/cpu_info.h>
+#include <base/logging.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined _M_X64 || defined _M_IX86 || defined __x86_64__ || defined __i386__
+#define IMAGE_SCALER_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+#ifdef __GNUC__
+#define TARGET_ISA(isa) __attribute__((target(isa)))
+#else
+#define TARGET_ISA(isa)
+#endif
+
+namespace Base
+{
+	static const int filterBits = 11;
+	static const int32_t filterScale = 1 << filterBits;
+
+	static unsigned getNumberOfChannels(ScalerPixelFormat format)
+	{
+		switch (format)
+		{
+		case ScalerPixelFormat::RGB24:
+		case ScalerPixelFormat::BGR24:
+			return 3;
+		case ScalerPixelFormat::RGBA:
+		case ScalerPixelFormat::BGRA:
+			return 4;
+		case ScalerPixelFormat::GRAY8:
+			return 1;
+		default:
+			return 0;
+		}
+	}
+
+	// byte offsets of red, green, blue and alpha in a packed pixel, -1 if missing
+	static void getChannelOffsets(ScalerPixelFormat format, int offsets[4])
+	{
+		const bool isBGR = format == ScalerPixelFormat::BGR24 || format == ScalerPixelFormat::BGRA;
+		offsets[0] = isBGR ? 2 : 0;
+		offsets[1] = 1;
+		offsets[2] = isBGR ? 0 : 2;
+		offsets[3] = getNumberOfChannels(format) == 4 ? 3 : -1;
+	}
+
+	static uint8_t clampToByte(int value)
+	{
+		return uint8_t(value < 0 ? 0 : (value > 255 ? 255 : value));
+	}
+
+	// ITU-R BT.601, limited range
+	static void convertYUVToRGB(int y, int u, int v, int rgb[3])
+	{
+		const int luma = 298 * (y - 16) + 128;
+		u -= 128;
+		v -= 128;
+		rgb[0] = clampToByte((luma + 409 * v) >> 8);
+		rgb[1] = clampToByte((luma - 100 * u - 208 * v) >> 8);
+		rgb[2] = clampToByte((luma + 516 * u) >> 8);
+	}
+
+	// writes source row in the packed destination format
+	static void convertRow(const ScalerImage& source, unsigned row, ScalerPixelFormat destinationFormat, uint8_t* output)
+	{
+		const unsigned width = source.width;
+		const uint8_t* luma = source.planes[0] + ptrdiff_t(row) * source.strides[0];
+		const unsigned channels = getNumberOfChannels(destinationFormat);
+		if (source.format == destinationFormat)
+		{
+			memcpy(output, luma, size_t(width) * channels);
+			return;
+		}
+		int destinationOffsets[4];
+		getChannelOffsets(destinationFormat, destinationOffsets);
+		if (source.format == ScalerPixelFormat::NV12 || source.format == ScalerPixelFormat::I420)
+		{
+			const bool isNV12 = source.format == ScalerPixelFormat::NV12;
+			const uint8_t* u = source.planes[1] + ptrdiff_t(row / 2) * source.strides[1];
+			const uint8_t* v = isNV12 ? u + 1 : source.planes[2] + ptrdiff_t(row / 2) * source.strides[2];
+			const unsigned chromaStep = isNV12 ? 2 : 1;
+			if (destinationFormat == ScalerPixelFormat::GRAY8)
+			{
+				for (unsigned x = 0; x < width; ++x)
+					output[x] = clampToByte((298 * (luma[x] - 16) + 128) >> 8);
+				return;
+			}
+			for (unsigned x = 0; x < width; ++x, output += channels)
+			{
+				int rgb[3];
+				const unsigned chroma = x / 2 * chromaStep;
+				convertYUVToRGB(luma[x], u[chroma], v[chroma], rgb);
+				output[destinationOffsets[0]] = uint8_t(rgb[0]);
+				output[destinationOffsets[1]] = uint8_t(rgb[1]);
+				output[destinationOffsets[2]] = uint8_t(rgb[2]);
+				if (destinationOffsets[3] >= 0)
+					output[destinationOffsets[3]] = 0xFF;
+			}
+			return;
+		}
+
+		const unsigned sourceChannels = getNumberOfChannels(source.format);
+		if (source.format == ScalerPixelFormat::GRAY8)
+		{
+			for (unsigned x = 0; x < width; ++x, output += channels)
+			{
+				output[0] = output[1] = output[2] = luma[x];
+				if (destinationOffsets[3] >= 0)
+					output[destinationOffsets[3]] = 0xFF;
+			}
+			return;
+		}
+		int sourceOffsets[4];
+		getChannelOffsets(source.format, sourceOffsets);
+		if (destinationFormat == ScalerPixelFormat::GRAY8)
+		{
+			// the weights of convertRGBRow
+			for (unsigned x = 0; x < width; ++x, luma += sourceChannels)
+				output[x] = uint8_t((19595 * luma[sourceOffsets[0]] + 38470 * luma[sourceOffsets[1]] + 7471 * luma[sourceOffsets[2]] + 32768) >> 16);
+			return;
+		}
+		for (unsigned x = 0; x < width; ++x, luma += sourceChannels, output += channels)
+		{
+			output[destinationOffsets[0]] = luma[sourceOffsets[0]];
+			output[destinationOffsets[1]] = luma[sourceOffsets[1]];
+			output[destinationOffsets[2]] = luma[sourceOffsets[2]];
+			if (destinationOffsets[3] >= 0)
+				output[destinationOffsets[3]] = sourceOffsets[3] >= 0 ? luma[sourceOffsets[3]] : 0xFF;
+		}
+	}
+
+	template <unsigned channels>
+	static void filterRow(const uint8_t* source, unsigned width, unsigned numberOfTaps, const unsigned* indices, const int32_t* weights, int32_t* output)
+	{
+		for (unsigned x = 0; x < width; ++x, indices += numberOfTaps, weights += numberOfTaps, output += channels)
+		{
+			int32_t sums[channels] = {};
+			for (unsigned tap = 0; tap < numberOfTaps; ++tap)
+			{
+				const uint8_t* pixel = source + size_t(indices[tap]) * channels;
+				for (unsigned channel = 0; channel < channels; ++channel)
+					sums[channel] += pixel[channel] * weights[tap];
+			}
+			for (unsigned channel = 0; channel < channels; ++channel)
+				output[channel] = sums[channel];
+		}
+	}
+
+	// rounds the weighted sums of the filtered rows from index on into bytes
+	static void blendRows(const int32_t* const* rows, const int32_t* weights, unsigned numberOfTaps, uint8_t* output, size_t index, size_t size)
+	{
+		for (; index < size; ++index)
+		{
+			int32_t sum = 1 << (filterBits * 2 - 1);
+			for (unsigned tap = 0; tap < numberOfTaps; ++tap)
+				sum += rows[tap][index] * weights[tap];
+			output[index] = uint8_t(sum >> (filterBits * 2));
+		}
+	}
+
+#ifdef IMAGE_SCALER_X86_KERNELS
+	TARGET_ISA("avx2")
+	static void blendRowsAVX2(const int32_t* const* rows, const int32_t* weights, unsigned numberOfTaps, uint8_t* output, size_t index, size_t size)
+	{
+		for (; index + 8 <= size; index += 8)
+		{
+			__m256i sum = _mm256_set1_epi32(1 << (filterBits * 2 - 1));
+			for (unsigned tap = 0; tap < numberOfTaps; ++tap)
+				sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(_mm256_loadu_si256((const __m256i*)(rows[tap] + index)), _mm256_set1_epi32(weights[tap])));
+			sum = _mm256_srai_epi32(sum, filterBits * 2);
+			const __m128i words = _mm_packs_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+			_mm_storel_epi64((__m128i*)(output + index), _mm_packus_epi16(words, words));
+		}
+		blendRows(rows, weights, numberOfTaps, output, index, size);
+	}
+
+	// the channels of two taps interleaved as 16-bit values
+	TARGET_ISA("avx2")
+	static __m128i loadTapPair(const uint8_t* first, const uint8_t* second)
+	{
+		uint32_t firstPixel, secondPixel;
+		memcpy(&firstPixel, first, sizeof(firstPixel));
+		memcpy(&secondPixel, second, sizeof(secondPixel));
+		return _mm_cvtepu8_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(int(firstPixel)), _mm_cvtsi32_si128(int(secondPixel))));
+	}
+
+	// Filters 3 or 4 channels with one multiply-add of pairs of taps per pixel. Reads a byte past the last
+	// 3-channel source pixel and writes an element past the last output pixel.
+	TARGET_ISA("avx2")
+	static void filterRowAVX2(const uint8_t* source, unsigned channels, unsigned width, unsigned numberOfTaps, const unsigned* indices, const int32_t* weights, int32_t* output)
+	{
+		for (unsigned x = 0; x < width; ++x, indices += numberOfTaps, weights += numberOfTaps, output += channels)
+		{
+			__m128i sums = _mm_setzero_si128();
+			unsigned tap = 0;
+			for (; tap + 1 < numberOfTaps; tap += 2)
+			{
+				const __m128i pixels = loadTapPair(source + size_t(indices[tap]) * channels, source + size_t(indices[tap + 1]) * channels);
+				sums = _mm_add_epi32(sums, _mm_madd_epi16(pixels, _mm_set1_epi32(int(uint32_t(weights[tap + 1]) << 16 | uint32_t(weights[tap])))));
+			}
+			if (tap < numberOfTaps)
+			{
+				const uint8_t* pixel = source + size_t(indices[tap]) * channels;
+				sums = _mm_add_epi32(sums, _mm_madd_epi16(loadTapPair(pixel, pixel), _mm_set1_epi32(weights[tap])));
+			}
+			_mm_storeu_si128((__m128i*)output, sums);
+		}
+	}
+#endif
+
+	// taps of every destination index, bilinear ones with aligned pixel centers
+	static void buildFilter(unsigned sourceSize, unsigned destinationSize, ImageResizeMethod method,
+		unsigned& numberOfTaps, std::vector<unsigned>& indices, std::vector<int32_t>& weights)
+	{
+		const double scale = double(sourceSize) / destinationSize;
+		const bool isArea = method == ImageResizeMethod::AREA && scale > 1;
+		numberOfTaps = sourceSize == destinationSize ? 1 : (isArea ? unsigned(std::ceil(scale)) + 1 : 2);
+		indices.assign(size_t(destinationSize) * numberOfTaps, 0);
+		weights.assign(size_t(destinationSize) * numberOfTaps, 0);
+		std::vector<double> exactWeights(numberOfTaps);
+		for (unsigned index = 0; index < destinationSize; ++index)
+		{
+			unsigned* tapIndices = indices.data() + size_t(index) * numberOfTaps;
+			int32_t* tapWeights = weights.data() + size_t(index) * numberOfTaps;
+			std::fill(exactWeights.begin(), exactWeights.end(), 0.);
+			if (numberOfTaps == 1)
+			{
+				tapIndices[0] = index;
+				exactWeights[0] = 1;
+			}
+			else if (isArea)
+			{
+				const double begin = index * scale, end = (index + 1) * scale;
+				const unsigned first = unsigned(begin);
+				for (unsigned tap = 0; tap < numberOfTaps; ++tap)
+				{
+					tapIndices[tap] = std::min(first + tap, sourceSize - 1);
+					const double coverage = std::min(end, double(first + tap + 1)) - std::max(begin, double(first + tap));
+					if (first + tap < sourceSize && coverage > 0)
+						exactWeights[tap] = coverage / scale;
+				}
+			}
+			else
+			{
+				const double position = std::min(std::max((index + 0.5) * scale - 0.5, 0.), double(sourceSize - 1));
+				const unsigned first = unsigned(position);
+				tapIndices[0] = first;
+				tapIndices[1] = std::min(first + 1, sourceSize - 1);
+				exactWeights[1] = position - first;
+				exactWeights[0] = 1 - exactWeights[1];
+			}
+			// the quantized weights have to add up to exactly 1 so flat areas stay flat
+			int32_t sum = 0;
+			unsigned largestTap = 0;
+			for (unsigned tap = 0; tap < numberOfTaps; ++tap)
+			{
+				tapWeights[tap] = int32_t(std::lround(exactWeights[tap] * filterScale));
+				sum += tapWeights[tap];
+				if (tapWeights[tap] > tapWeights[largestTap])
+					largestTap = tap;
+			}
+			tapWeights[largestTap] += filterScale - sum;
+		}
+	}
+
+	ScalerImage getScalerImage(ScalerPixelFormat format, unsigned width, unsigned height, void* buffer)
+	{
+		ScalerImage image;
+		memset(&image, 0, sizeof(image));
+		image.format = format;
+		image.width = width;
+		image.height = height;
+		uint8_t* pointer = (uint8_t*)buffer;
+		image.planes[0] = pointer;
+		const unsigned chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+		switch (format)
+		{
+		case ScalerPixelFormat::NV12:
+			image.strides[0] = width;
+			image.planes[1] = pointer + size_t(width) * height;
+			image.strides[1] = ptrdiff_t(chromaWidth) * 2;
+			break;
+		case ScalerPixelFormat::I420:
+			image.strides[0] = width;
+			image.planes[1] = pointer + size_t(width) * height;
+			image.strides[1] = chromaWidth;
+			image.planes[2] = image.planes[1] + size_t(chromaWidth) * chromaHeight;
+			image.strides[2] = chromaWidth;
+			break;
+		default:
+			image.strides[0] = ptrdiff_t(width) * getNumberOfChannels(format);
+			break;
+		}
+		return image;
+	}
+
+	ImageScaler::ImageScaler()
+		: _method(ImageResizeMethod::BILINEAR), _sourceWidth(0), _sourceHeight(0), _destinationWidth(0), _destinationHeight(0), _filtersValid(false)
+	{
+	}
+
+	void ImageScaler::setResizeMethod(ImageResizeMethod method)
+	{
+		if (method != _method)
+			_filtersValid = false;
+		_method = method;
+	}
+
+	ImageResizeMethod ImageScaler::getResizeMethod() const
+	{
+		return _method;
+	}
+
+	bool ImageScaler::isSupported(ScalerPixelFormat, ScalerPixelFormat destinationFormat)
+	{
+		return getNumberOfChannels(destinationFormat) != 0;
+	}
+
+	void ImageScaler::updateFilters(unsigned sourceWidth, unsigned sourceHeight, unsigned destinationWidth, unsigned destinationHeight)
+	{
+		if (_filtersValid && sourceWidth == _sourceWidth && sourceHeight == _sourceHeight && destinationWidth == _destinationWidth && destinationHeight == _destinationHeight)
+			return;
+		buildFilter(sourceWidth, destinationWidth, _method, _horizontalFilter.numberOfTaps, _horizontalFilter.indices, _horizontalFilter.weights);
+		buildFilter(sourceHeight, destinationHeight, _method, _verticalFilter.numberOfTaps, _verticalFilter.indices, _verticalFilter.weights);
+		_sourceWidth = sourceWidth;
+		_sourceHeight = sourceHeight;
+		_destinationWidth = destinationWidth;
+		_destinationHeight = destinationHeight;
+		_filtersValid = true;
+	}
+
+	const int32_t* ImageScaler::getFilteredRow(const ScalerImage& source, unsigned row, ScalerPixelFormat destinationFormat, RowBuffers& rowBuffers) const
+	{
+		// the rows of a destination row span at most the number of taps, they never share a slot
+		const size_t slot = row % rowBuffers.filteredRows.size();
+		std::vector<int32_t>& filteredRow = rowBuffers.filteredRows[slot];
+		if (rowBuffers.filteredRowIndices[slot] == row)
+			return filteredRow.data();
+		const uint8_t* convertedRow = rowBuffers.convertedRow.data();
+		convertRow(source, row, destinationFormat, rowBuffers.convertedRow.data());
+		const unsigned channels = getNumberOfChannels(destinationFormat);
+		const unsigned numberOfTaps = _horizontalFilter.numberOfTaps;
+		const unsigned* indices = _horizontalFilter.indices.data();
+		const int32_t* weights = _horizontalFilter.weights.data();
+		rowBuffers.filteredRowIndices[slot] = row;
+#ifdef IMAGE_SCALER_X86_KERNELS
+		if (channels != 1 && hasAVX2())
+		{
+			filterRowAVX2(convertedRow, channels, _destinationWidth, numberOfTaps, indices, weights, filteredRow.data());
+			return filteredRow.data();
+		}
+#endif
+		switch (channels)
+		{
+		case 1:
+			filterRow<1>(convertedRow, _destinationWidth, numberOfTaps, indices, weights, filteredRow.data());
+			break;
+		case 3:
+			filterRow<3>(convertedRow, _destinationWidth, numberOfTaps, indices, weights, filteredRow.data());
+			break;
+		default:
+			filterRow<4>(convertedRow, _destinationWidth, numberOfTaps, indices, weights, filteredRow.data());
+			break;
+		}
+		return filteredRow.data();
+	}
+
+	void ImageScaler::prepare(const ScalerImage& source, const ScalerImage& destination, size_t numberOfRowBuffers)
+	{
+		L_CHECK(isSupported(source.format, destination.format)) << "Unsupported destination format";
+		L_CHECK(source.width != 0 && source.height != 0 && destination.width != 0 && destination.height != 0);
+		if (_rowBuffers.size() < numberOfRowBuffers)
+			_rowBuffers.resize(numberOfRowBuffers);
+		if (source.width == destination.width && source.height == destination.height)
+			return;
+		updateFilters(source.width, source.height, destination.width, destination.height);
+		const unsigned channels = getNumberOfChannels(destination.format);
+		const unsigned numberOfTaps = _verticalFilter.numberOfTaps;
+		for (size_t index = 0; index < numberOfRowBuffers; ++index)
+		{
+			RowBuffers& rowBuffers = _rowBuffers[index];
+			// padded for the overlapping accesses of filterRowAVX2
+			rowBuffers.convertedRow.resize(size_t(source.width) * channels + 1);
+			rowBuffers.filteredRows.resize(numberOfTaps);
+			for (std::vector<int32_t>& filteredRow : rowBuffers.filteredRows)
+				filteredRow.resize(size_t(destination.width) * channels + 1);
+			rowBuffers.filteredRowIndices.assign(numberOfTaps, std::numeric_limits<unsigned>::max());
+		}
+	}
+
+	void ImageScaler::scaleRows(const ScalerImage& source, const ScalerImage& destination, bool flipVertical, unsigned firstRow, unsigned endRow, RowBuffers& rowBuffers) const
+	{
+		const ptrdiff_t destinationStride = flipVertical ? -destination.strides[0] : destination.strides[0];
+		uint8_t* destinationRow = destination.planes[0] + (flipVertical ? ptrdiff_t(destination.height - 1 - firstRow) : ptrdiff_t(firstRow)) * destination.strides[0];
+		if (source.width == destination.width && source.height == destination.height)
+		{
+			for (unsigned row = firstRow; row < endRow; ++row, destinationRow += destinationStride)
+				convertRow(source, row, destination.format, destinationRow);
+			return;
+		}
+
+		auto blend = blendRows;
+#ifdef IMAGE_SCALER_X86_KERNELS
+		if (hasAVX2())
+			blend = blendRowsAVX2;
+#endif
+		const unsigned numberOfTaps = _verticalFilter.numberOfTaps;
+		const size_t rowSize = size_t(destination.width) * getNumberOfChannels(destination.format);
+		std::vector<const int32_t*> rows(numberOfTaps);
+		for (unsigned row = firstRow; row < endRow; ++row, destinationRow += destinationStride)
+		{
+			const unsigned* indices = _verticalFilter.indices.data() + size_t(row) * numberOfTaps;
+			for (unsigned tap = 0; tap < numberOfTaps; ++tap)
+				rows[tap] = getFilteredRow(source, indices[tap], destination.format, rowBuffers);
+			blend(rows.data(), _verticalFilter.weights.data() + size_t(row) * numberOfTaps, numberOfTaps, destinationRow, 0, rowSize);
+		}
+	}
+
+	void ImageScaler::scale(const ScalerImage& source, const ScalerImage& destination, bool flipVertical)
+	{
+		prepare(source, destination, 1);
+		scaleRows(source, destination, flipVertical, 0, destination.height, _rowBuffers[0]);
+	}
+
+	void ImageScaler::scale(const ScalerImage& source, const ScalerImage& destination, bool flipVertical, WorkStealingThreadPool& threadPool)
+	{
+		const unsigned numberOfThreads = threadPool.getNumberOfThreads();
+		prepare(source, destination, numberOfThreads);
+		// a few bands per thread balance the load, too small ones filter many source rows twice
+		const unsigned minimumBandHeight = 16;
+		const unsigned bandHeight = std::max(minimumBandHeight, (destination.height + numberOfThreads * 4 - 1) / (numberOfThreads * 4));
+		const unsigned numberOfBands = (destination.height + bandHeight - 1) / bandHeight;
+		threadPool.parallelFor(numberOfBands, [&](unsigned workerIndex, size_t band)
+		{
+			const unsigned firstRow = unsigned(band) * bandHeight;
+			scaleRows(source, destination, flipVertical, firstRow, std::min(firstRow + bandHeight, destination.height), _rowBuffers[workerIndex]);
+		});
+	}
+}
@@ -0,0 +1,106 @@
+#include <base/ext/img_codecs/processing/sws_context_cache.h>
+
+#include <base/logging.h>
+
+#include <vector>
+
+namespace Base
+{
+	bool SwsContextKey::operator==(const SwsContextKey& other) const
+	{
+		return sourceWidth == other.sourceWidth && sourceHeight == other.sourceHeight && sourceFormat == other.sourceFormat
+			&& destinationWidth == other.destinationWidth && destinationHeight == other.destinationHeight && destinationFormat == other.destinationFormat
+			&& flags == other.flags;
+	}
+
+	SwsContextCache::SwsContextCache(size_t capacity)
+		: _capacity(capacity), _numberOfHits(0), _numberOfMisses(0), _numberOfEvictions(0)
+	{
+	}
+
+	SwsContextCache::~SwsContextCache()
+	{
+		clear();
+	}
+
+	SwsContext* SwsContextCache::acquire(const SwsContextKey& key)
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			for (auto iterator = _entries.begin(); iterator != _entries.end(); ++iterator)
+			{
+				if (iterator->key == key)
+				{
+					SwsContext* context = iterator->context;
+					_entries.erase(iterator);
+					++_numberOfHits;
+					return context;
+				}
+			}
+		}
+		++_numberOfMisses;
+		SwsContext* context = sws_getContext(key.sourceWidth, key.sourceHeight, key.sourceFormat, key.destinationWidth, key.destinationHeight, key.destinationFormat, key.flags, nullptr, nullptr, nullptr);
+		L_CHECK(context) << "sws_getContext() failed";
+		return context;
+	}
+
+	void SwsContextCache::release(const SwsContextKey& key, SwsContext* context)
+	{
+		std::vector<SwsContext*> evictedContexts;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_entries.push_front({ key, context });
+			while (_entries.size() > _capacity)
+			{
+				evictedContexts.push_back(_entries.back().context);
+				_entries.pop_back();
+			}
+		}
+		_numberOfEvictions += evictedContexts.size();
+		for (SwsContext* evictedContext : evictedContexts)
+			sws_freeContext(evictedContext);
+	}
+
+	void SwsContextCache::clear()
+	{
+		std::list<Entry> entries;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			entries.swap(_entries);
+		}
+		for (const Entry& entry : entries)
+			sws_freeContext(entry.context);
+	}
+
+	size_t SwsContextCache::getCapacity() const
+	{
+		return _capacity;
+	}
+
+	size_t SwsContextCache::getSize() const
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _entries.size();
+	}
+
+	uint64_t SwsContextCache::getNumberOfHits() const
+	{
+		return _numberOfHits;
+	}
+
+	uint64_t SwsContextCache::getNumberOfMisses() const
+	{
+		return _numberOfMisses;
+	}
+
+	uint64_t SwsContextCache::getNumberOfEvictions() const
+	{
+		return _numberOfEvictions;
+	}
+
+	SwsContextCache& SwsContextCache::getThreadLocal()
+	{
+		static thread_local SwsContextCache t_cache;
+		return t_cache;
+	}
+}
@@ -0,0 +1,325 @@
+#include <base/ext/img_codecs/processing/tensor.h>
+#include <base/ext/img_codecs/pixel_format.h>
+
+#include <base/cpu_info.h>
+#include <base/logging.h>
+
+#include <cstring>
+
+#if defined _M_X64 || defined _M_IX86 || defined __x86_64__ || defined __i386__
+#define IMAGE_TENSOR_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+#ifdef __GNUC__
+#define TARGET_ISA(isa) __attribute__((target(isa)))
+#else
+#define TARGET_ISA(isa)
+#endif
+
+namespace Base
+{
+	// rounds to nearest even like the F16C conversion
+	static uint16_t floatToHalf(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		const uint16_t sign = uint16_t((bits >> 16) & 0x8000);
+		bits &= 0x7FFFFFFF;
+		if (bits > 0x7F800000)
+			return sign | 0x7E00;
+		if (bits >= 0x47800000)
+			return sign | 0x7C00;
+		if (bits < 0x38800000)
+		{
+			// subnormal, adding 0.5 rounds to a multiple of 2^-24 in the low mantissa bits
+			float magnitude;
+			memcpy(&magnitude, &bits, sizeof(bits));
+			magnitude += 0.5f;
+			memcpy(&bits, &magnitude, sizeof(bits));
+			return sign | uint16_t(bits - 0x3F000000);
+		}
+		bits += 0xFFF + ((bits >> 13) & 1);
+		return sign | uint16_t((bits - (112u << 23)) >> 13);
+	}
+
+	static void blendRows(const float* top, const float* bottom, float weight, const float* scale, const float* bias, void* output, size_t size)
+	{
+		float* out = (float*)output;
+		for (size_t index = 0; index < size; ++index)
+			out[index] = (top[index] + (bottom[index] - top[index]) * weight) * scale[index] + bias[index];
+	}
+
+	static void blendRowsToHalf(const float* top, const float* bottom, float weight, const float* scale, const float* bias, void* output, size_t size)
+	{
+		uint16_t* out = (uint16_t*)output;
+		for (size_t index = 0; index < size; ++index)
+			out[index] = floatToHalf((top[index] + (bottom[index] - top[index]) * weight) * scale[index] + bias[index]);
+	}
+
+#ifdef IMAGE_TENSOR_X86_KERNELS
+	// the kernels keep the operation order of the scalar versions and do not fuse multiply-adds
+
+	TARGET_ISA("avx")
+	static void blendRowsAVX(const float* top, const float* bottom, float weight, const float* scale, const float* bias, void* output, size_t size)
+	{
+		float* out = (float*)output;
+		const __m256 weights = _mm256_set1_ps(weight);
+		size_t index = 0;
+		for (; index + 8 <= size; index += 8)
+		{
+			const __m256 upper = _mm256_loadu_ps(top + index);
+			const __m256 value = _mm256_add_ps(upper, _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(bottom + index), upper), weights));
+			_mm256_storeu_ps(out + index, _mm256_add_ps(_mm256_mul_ps(value, _mm256_loadu_ps(scale + index)), _mm256_loadu_ps(bias + index)));
+		}
+		blendRows(top + index, bottom + index, weight, scale + index, bias + index, out + index, size - index);
+	}
+
+	TARGET_ISA("avx,f16c")
+	static void blendRowsToHalfAVX(const float* top, const float* bottom, float weight, const float* scale, const float* bias, void* output, size_t size)
+	{
+		uint16_t* out = (uint16_t*)output;
+		const __m256 weights = _mm256_set1_ps(weight);
+		size_t index = 0;
+		for (; index + 8 <= size; index += 8)
+		{
+			const __m256 upper = _mm256_loadu_ps(top + index);
+			const __m256 value = _mm256_add_ps(upper, _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(bottom + index), upper), weights));
+			const __m256 normalized = _mm256_add_ps(_mm256_mul_ps(value, _mm256_loadu_ps(scale + index)), _mm256_loadu_ps(bias + index));
+			_mm_storeu_si128((__m128i*)(out + index), _mm256_cvtps_ph(normalized, _MM_FROUND_TO_NEAREST_INT));
+		}
+		blendRowsToHalf(top + index, bottom + index, weight, scale + index, bias + index, out + index, size - index);
+	}
+
+	TARGET_ISA("avx512f")
+	static void blendRowsAVX512(const float* top, const float* bottom, float weight, const float* scale, const float* bias, void* output, size_t size)
+	{
+		float* out = (float*)output;
+		const __m512 weights = _mm512_set1_ps(weight);
+		size_t index = 0;
+		for (; index + 16 <= size; index += 16)
+		{
+			const __m512 upper = _mm512_loadu_ps(top + index);
+			const __m512 value = _mm512_add_ps(upper, _mm512_mul_ps(_mm512_sub_ps(_mm512_loadu_ps(bottom + index), upper), weights));
+			_mm512_storeu_ps(out + index, _mm512_add_ps(_mm512_mul_ps(value, _mm512_loadu_ps(scale + index)), _mm512_loadu_ps(bias + index)));
+		}
+		blendRows(top + index, bottom + index, weight, scale + index, bias + index, out + index, size - index);
+	}
+
+	TARGET_ISA("avx512f")
+	static void blendRowsToHalfAVX512(const float* top, const float* bottom, float weight, const float* scale, const float* bias, void* output, size_t size)
+	{
+		uint16_t* out = (uint16_t*)output;
+		const __m512 weights = _mm512_set1_ps(weight);
+		size_t index = 0;
+		for (; index + 16 <= size; index += 16)
+		{
+			const __m512 upper = _mm512_loadu_ps(top + index);
+			const __m512 value = _mm512_add_ps(upper, _mm512_mul_ps(_mm512_sub_ps(_mm512_loadu_ps(bottom + index), upper), weights));
+			const __m512 normalized = _mm512_add_ps(_mm512_mul_ps(value, _mm512_loadu_ps(scale + index)), _mm512_loadu_ps(bias + index));
+			_mm256_storeu_si256((__m256i*)(out + index), _mm512_cvtps_ph(normalized, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+		}
+		blendRowsToHalf(top + index, bottom + index, weight, scale + index, bias + index, out + index, size - index);
+	}
+#endif
+
+	// source position of output index with aligned pixel centers, clamped to the image
+	static void getSourcePosition(unsigned index, unsigned size, unsigned sourceSize, unsigned& sourceIndex, float& weight)
+	{
+		const double position = (index + 0.5) * sourceSize / size - 0.5;
+		if (position <= 0)
+		{
+			sourceIndex = 0;
+			weight = 0;
+		}
+		else if (position >= sourceSize - 1)
+		{
+			sourceIndex = sourceSize - 1;
+			weight = 0;
+		}
+		else
+		{
+			sourceIndex = unsigned(position);
+			weight = float(position - sourceIndex);
+		}
+	}
+
+	ImageTensorConverter::ImageTensorConverter(const ImageTensorOptions& options)
+		: _options(options), _sourceWidth(0), _sourceHeight(0), _sourceChannelOffsets{ 0, 1, 2 }, _tensor(nullptr), _currentSourceRow(0), _currentRow(0)
+	{
+		L_CHECK(options.width != 0 && options.height != 0);
+		for (float std : options.std)
+			L_CHECK_NE(std, 0.f);
+		switch (options.dataType)
+		{
+		case TensorDataType::FLOAT32:
+			_elementSize = sizeof(float);
+			_blendRows = blendRows;
+#ifdef IMAGE_TENSOR_X86_KERNELS
+			if (hasAVX512f())
+				_blendRows = blendRowsAVX512;
+			else if (hasAVX())
+				_blendRows = blendRowsAVX;
+#endif
+			break;
+		case TensorDataType::FLOAT16:
+			_elementSize = sizeof(uint16_t);
+			_blendRows = blendRowsToHalf;
+#ifdef IMAGE_TENSOR_X86_KERNELS
+			if (hasAVX512f())
+				_blendRows = blendRowsToHalfAVX512;
+			else if (hasAVX() && hasF16C())
+				_blendRows = blendRowsToHalfAVX;
+#endif
+			break;
+		default:
+			L_NOT_IMPLEMENTED_ERROR;
+		}
+
+		const unsigned width = options.width;
+		const size_t rowSize = size_t(width) * 3;
+		_scale.resize(rowSize);
+		_bias.resize(rowSize);
+		for (unsigned column = 0; column < width; ++column)
+			for (unsigned channel = 0; channel < 3; ++channel)
+			{
+				const size_t index = options.layout == TensorLayout::CHW ? channel * width + column : column * 3 + channel;
+				_scale[index] = options.scale / options.std[channel];
+				_bias[index] = -options.mean[channel] / options.std[channel];
+			}
+		_resizedRows[0].resize(rowSize);
+		_resizedRows[1].resize(rowSize);
+	}
+
+	const ImageTensorOptions& ImageTensorConverter::getOptions() const
+	{
+		return _options;
+	}
+
+	uint64_t ImageTensorConverter::getTensorSize() const
+	{
+		return uint64_t(_options.width) * _options.height * 3 * _elementSize;
+	}
+
+	void ImageTensorConverter::begin(unsigned sourceWidth, unsigned sourceHeight, PixelFormat sourceFormat, void* tensor)
+	{
+		L_CHECK(sourceWidth != 0 && sourceHeight != 0);
+		L_CHECK_EQ(getNumberOfPlanes(sourceFormat), 1) << "Planar images are not supported";
+		switch (sourceFormat)
+		{
+		case PixelFormat::BGR:
+		case PixelFormat::BGRA:
+			_sourceChannelOffsets[0] = 2;
+			_sourceChannelOffsets[1] = 1;
+			_sourceChannelOffsets[2] = 0;
+			break;
+		case PixelFormat::GRAY:
+			_sourceChannelOffsets[0] = _sourceChannelOffsets[1] = _sourceChannelOffsets[2] = 0;
+			break;
+		default:
+			_sourceChannelOffsets[0] = 0;
+			_sourceChannelOffsets[1] = 1;
+			_sourceChannelOffsets[2] = 2;
+			break;
+		}
+		if (_options.reverseChannels)
+			std::swap(_sourceChannelOffsets[0], _sourceChannelOffsets[2]);
+
+		const size_t pixelSize = getPixelSize(sourceFormat);
+		_columnOffsets.resize(size_t(_options.width) * 2);
+		_columnWeights.resize(_options.width);
+		for (unsigned column = 0; column < _options.width; ++column)
+		{
+			unsigned sourceColumn;
+			getSourcePosition(column, _options.width, sourceWidth, sourceColumn, _columnWeights[column]);
+			_columnOffsets[column * 2] = sourceColumn * pixelSize;
+			_columnOffsets[column * 2 + 1] = (sourceColumn + 1 < sourceWidth ? sourceColumn + 1 : sourceColumn) * pixelSize;
+		}
+		_sourceRows.resize(_options.height);
+		_rowWeights.resize(_options.height);
+		_isSourceRowUsed.assign(sourceHeight, false);
+		for (unsigned row = 0; row < _options.height; ++row)
+		{
+			getSourcePosition(row, _options.height, sourceHeight, _sourceRows[row], _rowWeights[row]);
+			_isSourceRowUsed[_sourceRows[row]] = true;
+			if (_sourceRows[row] + 1 < sourceHeight)
+				_isSourceRowUsed[_sourceRows[row] + 1] = true;
+		}
+		_sourceWidth = sourceWidth;
+		_sourceHeight = sourceHeight;
+		_tensor = (unsigned char*)tensor;
+		_currentSourceRow = 0;
+		_currentRow = 0;
+	}
+
+	void ImageTensorConverter::pushRow(const unsigned char* row)
+	{
+		L_CHECK_LT(_currentSourceRow, _sourceHeight);
+		const unsigned sourceRow = _currentSourceRow++;
+		if (!_isSourceRowUsed[sourceRow])
+			return;
+		resizeRow(row, _resizedRows[sourceRow & 1].data());
+		// an output row is complete once the lower of its source rows arrived
+		while (_currentRow < _options.height)
+		{
+			const unsigned upperRow = _sourceRows[_currentRow];
+			const unsigned lowerRow = upperRow + 1 < _sourceHeight ? upperRow + 1 : upperRow;
+			if (lowerRow != sourceRow)
+				break;
+			writeRow(_currentRow++);
+		}
+	}
+
+	bool ImageTensorConverter::isComplete() const
+	{
+		return _tensor && _currentRow == _options.height;
+	}
+
+	void ImageTensorConverter::convert(const void* image, unsigned width, unsigned height, PixelFormat format, size_t rowStride, void* tensor)
+	{
+		begin(width, height, format, tensor);
+		const unsigned char* row = (const unsigned char*)image;
+		for (unsigned rowIndex = 0; rowIndex < height; ++rowIndex, row += rowStride)
+			pushRow(row);
+	}
+
+	void ImageTensorConverter::resizeRow(const unsigned char* row, float* output) const
+	{
+		const unsigned width = _options.width;
+		const bool isPlanar = _options.layout == TensorLayout::CHW;
+		for (unsigned column = 0; column < width; ++column)
+		{
+			const unsigned char* left = row + _columnOffsets[column * 2];
+			const unsigned char* right = row + _columnOffsets[column * 2 + 1];
+			const float weight = _columnWeights[column];
+			for (unsigned channel = 0; channel < 3; ++channel)
+			{
+				const unsigned offset = _sourceChannelOffsets[channel];
+				const float value = left[offset] + (float(right[offset]) - float(left[offset])) * weight;
+				output[isPlanar ? channel * width + column : column * 3 + channel] = value;
+			}
+		}
+	}
+
+	void ImageTensorConverter::writeRow(unsigned row)
+	{
+		const unsigned upperRow = _sourceRows[row];
+		const unsigned lowerRow = upperRow + 1 < _sourceHeight ? upperRow + 1 : upperRow;
+		const float* top = _resizedRows[upperRow & 1].data();
+		const float* bottom = _resizedRows[lowerRow & 1].data();
+		const float weight = _rowWeights[row];
+		const size_t width = _options.width;
+		if (_options.layout == TensorLayout::HWC)
+		{
+			_blendRows(top, bottom, weight, _scale.data(), _bias.data(), _tensor + row * width * 3 * _elementSize, width * 3);
+			return;
+		}
+		const uint64_t planeSize = uint64_t(width) * _options.height * _elementSize;
+		for (unsigned channel = 0; channel < 3; ++channel)
+		{
+			const size_t offset = channel * width;
+			_blendRows(top + offset, bottom + offset, weight, _scale.data() + offset, _bias.data() + offset,
+				_tensor + channel * planeSize + row * width * _elementSize, width);
+		}
+	}
+}
@@ -1,8 +1,9 @@
 #include <base/ext/img_codecs/processing/transform.h>
 
 #include <base/logging.h>
+#include <base/utils.h>
+#include <algorithm>
 #include <cstring>
-#include <type_traits>
 
 #ifdef _MSC_VER
 #pragma warning(push, 0)
@@ -13,6 +14,7 @@
 
 extern "C" {
 #include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
 }
 
 #ifdef _MSC_VER
@@ -23,16 +25,81 @@ extern "C" {
 
 namespace Base
 {
-	ImageFormatTransformer::ImageFormatTransformer()
-		: _swsContext(nullptr)
+	static bool getScalerPixelFormat(AVPixelFormat format, ScalerPixelFormat& scalerFormat)
 	{
-		static_assert(std::is_pod_v<Context>);
-		memset(&_context, 0, sizeof(0));
+		switch (format)
+		{
+		case AV_PIX_FMT_RGB24:
+			scalerFormat = ScalerPixelFormat::RGB24;
+			return true;
+		case AV_PIX_FMT_BGR24:
+			scalerFormat = ScalerPixelFormat::BGR24;
+			return true;
+		case AV_PIX_FMT_RGBA:
+			scalerFormat = ScalerPixelFormat::RGBA;
+			return true;
+		case AV_PIX_FMT_BGRA:
+			scalerFormat = ScalerPixelFormat::BGRA;
+			return true;
+		case AV_PIX_FMT_GRAY8:
+			scalerFormat = ScalerPixelFormat::GRAY8;
+			return true;
+		case AV_PIX_FMT_NV12:
+			scalerFormat = ScalerPixelFormat::NV12;
+			return true;
+		case AV_PIX_FMT_YUV420P:
+			scalerFormat = ScalerPixelFormat::I420;
+			return true;
+		default:
+			return false;
+		}
 	}
 
-	ImageFormatTransformer::~ImageFormatTransformer()
+	// the slice at (x, y) of the imageWidth wide image, chroma planes are subsampled by two in both directions
+	static ScalerImage getScalerSlice(ScalerPixelFormat format, uint32_t imageWidth, uint8_t* const planes[4], const int lineSizes[4],
+		uint32_t x, uint32_t y, uint32_t width, uint32_t height)
 	{
-		sws_freeContext(_swsContext);
+		ScalerImage slice;
+		memset(&slice, 0, sizeof(slice));
+		slice.format = format;
+		slice.width = width;
+		slice.height = height;
+		if (format != ScalerPixelFormat::NV12 && format != ScalerPixelFormat::I420)
+		{
+			// av_image_fill_linesizes does not pad packed rows
+			slice.planes[0] = planes[0] + uint64_t(lineSizes[0]) * y + uint64_t(lineSizes[0]) / imageWidth * x;
+			slice.strides[0] = lineSizes[0];
+			return slice;
+		}
+		slice.planes[0] = planes[0] + uint64_t(lineSizes[0]) * y + x;
+		slice.strides[0] = lineSizes[0];
+		for (int plane = 1; plane < (format == ScalerPixelFormat::NV12 ? 2 : 3); ++plane)
+		{
+			const uint32_t pixelSize = format == ScalerPixelFormat::NV12 ? 2 : 1;
+			slice.planes[plane] = planes[plane] + uint64_t(lineSizes[plane]) * (y / 2) + uint64_t(pixelSize) * (x / 2);
+			slice.strides[plane] = lineSizes[plane];
+		}
+		return slice;
+	}
+
+	ImageFormatTransformer::ImageFormatTransformer(SwsContextCache* swsContextCache)
+		: _nativeScalingEnabled(true), _swsContextCache(swsContextCache), _threadPool(nullptr)
+	{
+	}
+
+	void ImageFormatTransformer::setResizeMethod(ImageResizeMethod method)
+	{
+		_scaler.setResizeMethod(method);
+	}
+
+	void ImageFormatTransformer::setNativeScalingEnabled(bool enabled)
+	{
+		_nativeScalingEnabled = enabled;
+	}
+
+	void ImageFormatTransformer::setThreadPool(WorkStealingThreadPool* threadPool)
+	{
+		_threadPool = threadPool;
 	}
 
 	void ImageFormatTransformer::transform(uint32_t sourceImageWidth, uint32_t sourceImageHeight,
@@ -43,16 +110,6 @@ namespace Base
 		bool flipVertical,
 		uint8_t *source, uint8_t*destination)
 	{
-		Context context = { sourceImageSliceWidth, sourceImageSliceHeight, sourceImageFormat, destinationImageSliceWidth, destinationImageSliceHeight, destinationImageFormat };
-		if (memcmp(&context, &_context, sizeof(Context)) != 0)
-		{
-			auto swsContext = sws_getContext(sourceImageSliceWidth, sourceImageSliceHeight, sourceImageFormat, destinationImageSliceWidth, destinationImageSliceHeight, destinationImageFormat, SWS_FAST_BILINEAR, nullptr, nullptr, nullptr);
-			L_CHECK(swsContext);
-			sws_freeContext(_swsContext);
-			_swsContext = swsContext;
-			memcpy(&_context, &context, sizeof(Context));
-		}
-		
 		int sourceLineSize[4];
 		int destinationLineSize[4];
 		L_CHECK_GE(av_image_fill_linesizes(sourceLineSize, sourceImageFormat, sourceImageWidth), 0);
@@ -64,6 +121,19 @@ namespace Base
 		L_CHECK_GE(av_image_fill_pointers(source_ptr, sourceImageFormat, sourceImageHeight, source, sourceLineSize), 0);
 		L_CHECK_GE(av_image_fill_pointers(destination_ptr, destinationImageFormat, destinationImageHeight, destination, destinationLineSize), 0);
 
+		ScalerPixelFormat nativeSourceFormat, nativeDestinationFormat;
+		if (_nativeScalingEnabled && getScalerPixelFormat(sourceImageFormat, nativeSourceFormat) && getScalerPixelFormat(destinationImageFormat, nativeDestinationFormat)
+			&& ImageScaler::isSupported(nativeSourceFormat, nativeDestinationFormat))
+		{
+			const ScalerImage sourceSlice = getScalerSlice(nativeSourceFormat, sourceImageWidth, source_ptr, sourceLineSize, sourceImageSliceX, sourceImageSliceY, sourceImageSliceWidth, sourceImageSliceHeight);
+			const ScalerImage destinationSlice = getScalerSlice(nativeDestinationFormat, destinationImageWidth, destination_ptr, destinationLineSize, destinationImageSliceX, destinationImageSliceY, destinationImageSliceWidth, destinationImageSliceHeight);
+			if (_threadPool)
+				_scaler.scale(sourceSlice, destinationSlice, flipVertical, *_threadPool);
+			else
+				_scaler.scale(sourceSlice, destinationSlice, flipVertical);
+			return;
+		}
+
 		// adjust X
 
 		for (int i=0;i<4;++i)
@@ -86,15 +156,6 @@ namespace Base
 			}
 		}
 		
-		for (int i = 0; i < 4; ++i)
-		{
-			const int stride = sourceLineSize[i];
-			if (stride)
-			{
-				source_ptr[i] += uint64_t(stride) * uint64_t(sourceImageSliceY);
-			}
-		}
-		
 		if (flipVertical)
 		{
 			for (int i = 0; i < 4; ++i)
@@ -108,6 +169,47 @@ namespace Base
 			}
 		}
 
-		L_CHECK_EQ(sws_scale(_swsContext, source_ptr, sourceLineSize, 0, sourceImageSliceHeight, destination_ptr, destinationLineSize), destinationImageSliceHeight);
+		// scales the source rows from firstRow on into the destination rows from firstRow on, with a context of its own
+		auto scaleBand = [&](uint32_t firstRow, uint32_t numberOfSourceRows, uint32_t numberOfDestinationRows)
+		{
+			SwsContextCache& swsContextCache = _swsContextCache ? *_swsContextCache : SwsContextCache::getThreadLocal();
+			const SwsContextKey key = { int(sourceImageSliceWidth), int(numberOfSourceRows), sourceImageFormat, int(destinationImageSliceWidth), int(numberOfDestinationRows), destinationImageFormat, SWS_FAST_BILINEAR };
+			SwsContext* swsContext = swsContextCache.acquire(key);
+			ScopeGuard swsContextReleaser = [&]() { swsContextCache.release(key, swsContext); };
+			const uint8_t* sourceBand[4];
+			uint8_t* destinationBand[4];
+			for (int i = 0; i < 4; ++i)
+			{
+				sourceBand[i] = source_ptr[i] ? source_ptr[i] + int64_t(sourceLineSize[i]) * firstRow : nullptr;
+				destinationBand[i] = destination_ptr[i] ? destination_ptr[i] + int64_t(destinationLineSize[i]) * firstRow : nullptr;
+			}
+			L_CHECK_EQ(sws_scale(swsContext, sourceBand, sourceLineSize, 0, int(numberOfSourceRows), destinationBand, destinationLineSize), int(numberOfDestinationRows));
+		};
+
+		// Without vertical scaling or subsampling every destination row depends on the source row at the same
+		// position only, bands give the same result as the whole slice. Ordered dithering (e.g. RGB565, RGB555,
+		// RGB444) picks its matrix row by the row index within the band modulo 8, so bands start at multiples
+		// of 8. Paletted and bitstream destinations may diffuse errors from row to row and are never banded.
+		const AVPixFmtDescriptor* sourceDescriptor = av_pix_fmt_desc_get(sourceImageFormat);
+		const AVPixFmtDescriptor* destinationDescriptor = av_pix_fmt_desc_get(destinationImageFormat);
+		const uint32_t minimumBandHeight = 16;
+		const uint32_t ditherPeriod = 8;
+		if (!_threadPool || _threadPool->getNumberOfThreads() == 1 || sourceImageSliceHeight != destinationImageSliceHeight
+			|| sourceImageSliceHeight < minimumBandHeight * 2 || !sourceDescriptor || !destinationDescriptor
+			|| sourceDescriptor->log2_chroma_h != 0 || destinationDescriptor->log2_chroma_h != 0
+			|| (destinationDescriptor->flags & (AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_BITSTREAM)) != 0)
+		{
+			scaleBand(0, sourceImageSliceHeight, destinationImageSliceHeight);
+			return;
+		}
+		const uint32_t numberOfBands = std::min(_threadPool->getNumberOfThreads() * 2, sourceImageSliceHeight / minimumBandHeight);
+		const uint32_t bandHeight = ((sourceImageSliceHeight + numberOfBands - 1) / numberOfBands + ditherPeriod - 1) / ditherPeriod * ditherPeriod;
+		_threadPool->parallelFor(numberOfBands, [&](unsigned, size_t band)
+		{
+			const uint32_t firstRow = uint32_t(band) * bandHeight;
+			const uint32_t numberOfRows = firstRow < sourceImageSliceHeight ? std::min(bandHeight, sourceImageSliceHeight - firstRow) : 0;
+			if (numberOfRows != 0)
+				scaleBand(firstRow, numberOfRows, numberOfRows);
+		});
 	}
 }
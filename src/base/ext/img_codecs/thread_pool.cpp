@@ -0,0 +1,172 @@
+#include <base/ext/img_codecs/thread_pool.h>
+
+#include <base/logging.h>
+
+namespace Base
+{
+	static uint64_t packRange(uint32_t begin, uint32_t end)
+	{
+		return uint64_t(begin) | (uint64_t(end) << 32);
+	}
+
+	static uint32_t getRangeBegin(uint64_t range)
+	{
+		return uint32_t(range);
+	}
+
+	static uint32_t getRangeEnd(uint64_t range)
+	{
+		return uint32_t(range >> 32);
+	}
+
+	WorkStealingThreadPool::WorkStealingThreadPool(unsigned numberOfThreads)
+		: _numberOfThreads(numberOfThreads), _generation(0), _numberOfBusyThreads(0), _stopRequested(false), _function(nullptr)
+	{
+		if (_numberOfThreads == 0)
+			_numberOfThreads = std::thread::hardware_concurrency();
+		if (_numberOfThreads == 0)
+			_numberOfThreads = 1;
+		_workers.reset(new Worker[_numberOfThreads]);
+		for (unsigned index = 0; index < _numberOfThreads; ++index)
+			_workers[index].range.store(0, std::memory_order_relaxed);
+		_threads.reserve(_numberOfThreads - 1);
+		for (unsigned index = 1; index < _numberOfThreads; ++index)
+			_threads.emplace_back(&WorkStealingThreadPool::run, this, index);
+	}
+
+	WorkStealingThreadPool::~WorkStealingThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lockGuard(_mutex);
+			_stopRequested = true;
+		}
+		_startCondition.notify_all();
+		for (auto& thread : _threads)
+			thread.join();
+	}
+
+	unsigned WorkStealingThreadPool::getNumberOfThreads() const
+	{
+		return _numberOfThreads;
+	}
+
+	void WorkStealingThreadPool::parallelFor(size_t count, const std::function<void(unsigned, size_t)>& function)
+	{
+		if (count == 0)
+			return;
+		L_CHECK_LE(count, size_t(UINT32_MAX));
+
+		std::lock_guard<std::mutex> parallelForLockGuard(_parallelForMutex);
+		for (unsigned index = 0; index < _numberOfThreads; ++index)
+		{
+			const uint32_t begin = uint32_t(count * index / _numberOfThreads);
+			const uint32_t end = uint32_t(count * (index + 1) / _numberOfThreads);
+			_workers[index].range.store(packRange(begin, end), std::memory_order_relaxed);
+		}
+		{
+			std::lock_guard<std::mutex> lockGuard(_mutex);
+			_function = &function;
+			_numberOfBusyThreads = _numberOfThreads - 1;
+			++_generation;
+		}
+		_startCondition.notify_all();
+
+		work(0);
+
+		std::exception_ptr exception;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_finishCondition.wait(lock, [this]() { return _numberOfBusyThreads == 0; });
+			_function = nullptr;
+			std::swap(exception, _exception);
+		}
+		if (exception)
+			std::rethrow_exception(exception);
+	}
+
+	void WorkStealingThreadPool::run(unsigned workerIndex)
+	{
+		uint64_t generation = 0;
+		std::unique_lock<std::mutex> lock(_mutex);
+		while (true)
+		{
+			_startCondition.wait(lock, [this, generation]() { return _stopRequested || _generation != generation; });
+			if (_stopRequested)
+				break;
+			generation = _generation;
+			lock.unlock();
+			work(workerIndex);
+			lock.lock();
+			if (--_numberOfBusyThreads == 0)
+				_finishCondition.notify_one();
+		}
+	}
+
+	void WorkStealingThreadPool::work(unsigned workerIndex)
+	{
+		size_t index;
+		while (takeOwn(_workers[workerIndex], index) || steal(workerIndex, index))
+		{
+			try
+			{
+				(*_function)(workerIndex, index);
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lockGuard(_mutex);
+				if (!_exception)
+					_exception = std::current_exception();
+			}
+		}
+	}
+
+	bool WorkStealingThreadPool::takeOwn(Worker& worker, size_t& index)
+	{
+		uint64_t range = worker.range.load(std::memory_order_acquire);
+		while (true)
+		{
+			const uint32_t begin = getRangeBegin(range), end = getRangeEnd(range);
+			if (begin >= end)
+				return false;
+			if (worker.range.compare_exchange_weak(range, packRange(begin + 1, end), std::memory_order_acq_rel))
+			{
+				index = begin;
+				return true;
+			}
+		}
+	}
+
+	bool WorkStealingThreadPool::steal(unsigned workerIndex, size_t& index)
+	{
+		while (true)
+		{
+			unsigned victimIndex = 0;
+			uint64_t victimRange = 0;
+			uint32_t largestRemaining = 0;
+			for (unsigned offset = 1; offset < _numberOfThreads; ++offset)
+			{
+				const unsigned candidateIndex = (workerIndex + offset) % _numberOfThreads;
+				const uint64_t range = _workers[candidateIndex].range.load(std::memory_order_acquire);
+				const uint32_t begin = getRangeBegin(range), end = getRangeEnd(range);
+				if (begin < end && end - begin > largestRemaining)
+				{
+					largestRemaining = end - begin;
+					victimIndex = candidateIndex;
+					victimRange = range;
+				}
+			}
+			if (largestRemaining == 0)
+				return false;
+
+			// the victim keeps the front, which it is about to take next
+			const uint32_t begin = getRangeBegin(victimRange), end = getRangeEnd(victimRange);
+			const uint32_t stolenBegin = end - (largestRemaining + 1) / 2;
+			if (_workers[victimIndex].range.compare_exchange_strong(victimRange, packRange(begin, stolenBegin), std::memory_order_acq_rel))
+			{
+				index = stolenBegin;
+				_workers[workerIndex].range.store(packRange(stolenBegin + 1, end), std::memory_order_release);
+				return true;
+			}
+		}
+	}
+}
@@ -11,55 +11,70 @@ namespace Base
 		namespace Details
 		{
 			LoggingMessageFinalHandler::LoggingMessageFinalHandler(ErrorCodeType errorCodeType, int64_t errorCode)
-			: _errorCodeType(errorCodeType), _errorCode(errorCode)
+			: _hasMessage(false), _flush(false), _errorCodeType(errorCodeType), _errorCode(errorCode)
 			{
 			}
 			void LoggingMessageFinalHandler::setMessage(const std::string& message)
 			{
 				_message = message;
+				_hasMessage = true;
 			}
 			void LoggingMessageFinalHandler::setMessage(std::string&& message)
 			{
 				_message = std::move(message);
+				_hasMessage = true;
 			}
 			void LoggingMessageFinalHandler::setAction(Action action)
 			{
 				_action = action;
 			}
+			void LoggingMessageFinalHandler::setFlush(bool flush)
+			{
+				_flush = flush;
+			}
 			LoggingMessageFinalHandler::~LoggingMessageFinalHandler() noexcept(false)
 			{
-				g_dispatcher.write(_message);
-				
+				if (_hasMessage)
+					g_dispatcher.write(_message);
+				else if (_stream.isRecord())
+					g_dispatcher.writeRecord(_stream.record());
+				else
+					g_dispatcher.write(_stream.view());
+				if (_flush)
+					g_dispatcher.flush();
+
 				if (_action == Action::THROW_FATAL_ERROR)
 				{
-					throw FatalError(std::move(_message), _errorCode, _errorCodeType);
+					throw FatalError(_hasMessage ? std::move(_message) : _stream.str(), _errorCode, _errorCodeType);
 				}
 				else if (_action == Action::THROW_RUNTIME_EXCEPTION)
 				{
-					throw RuntimeException(std::move(_message), _errorCode, _errorCodeType);
+					throw RuntimeException(_hasMessage ? std::move(_message) : _stream.str(), _errorCode, _errorCodeType);
 				}
 			}
 		}
 
 		FatalErrorLoggingStream::FatalErrorLoggingStream(ErrorCodeType errorCodeType, int64_t errorCode)
-			: LoggingMessageFinalHandler(errorCodeType, errorCode) { }
+			: LoggingMessageFinalHandler(errorCodeType, errorCode)
+		{
+			setFlush(true);
+		}
 
-		std::stringstream& FatalErrorLoggingStream::stream()
+		Details::LoggingStream& FatalErrorLoggingStream::stream()
 		{
 			return _stream;
 		}
 
 		FatalErrorLoggingStream::~FatalErrorLoggingStream()
 		{
-			_stream << std::endl
-				<< "*** Check failure stack trace: ***" << std::endl
+			_stream << '\n'
+				<< "*** Check failure stack trace: ***" << '\n'
 				<< getStackTrace();
 			if (std::uncaught_exceptions()) {
 				setAction(Details::Action::LOGGING_ONLY);
 				setMessage("Fatal error occurred during exception handling.\n" + _stream.str());
 			}
 			else {
-				setMessage(_stream.str());
 				setAction(Details::Action::THROW_FATAL_ERROR);
 			}
 		}
@@ -67,7 +82,7 @@ namespace Base
 		RuntimeExceptionLoggingStream::RuntimeExceptionLoggingStream(ErrorCodeType errorCodeType, int64_t errorCode)
 			: LoggingMessageFinalHandler(errorCodeType, errorCode) { }
 
-		std::stringstream& RuntimeExceptionLoggingStream::stream()
+		Details::LoggingStream& RuntimeExceptionLoggingStream::stream()
 		{
 			return _stream;
 		}
@@ -78,7 +93,6 @@ namespace Base
 				setMessage("Fatal error occurred during exception handling.\n" + _stream.str());
 			}
 			else {
-				setMessage(_stream.str());
 				setAction(Details::Action::THROW_RUNTIME_EXCEPTION);
 			}
 		}
@@ -86,7 +100,7 @@ namespace Base
 		EventLoggingStream::EventLoggingStream(ErrorCodeType errorCodeType, int64_t errorCode)
 			: LoggingMessageFinalHandler(errorCodeType, errorCode) { }
 
-		std::stringstream& EventLoggingStream::stream()
+		Details::LoggingStream& EventLoggingStream::stream()
 		{
 			return _stream;
 		}
@@ -94,7 +108,6 @@ namespace Base
 		EventLoggingStream::~EventLoggingStream()
 		{
 			setAction(Details::Action::LOGGING_ONLY);
-			setMessage(_stream.str());			
 		}
 	}
 }
\ No newline at end of file
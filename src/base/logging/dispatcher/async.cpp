@@ -0,0 +1,275 @@
+#include <base/logging/dispatcher/async.h>
+
+#include <base/logging/dispatcher/dispatcher.h>
+
+#include <chrono>
+
+namespace Base
+{
+	namespace Logging
+	{
+		namespace Details
+		{
+			struct ThreadRingBufferHolder
+			{
+				~ThreadRingBufferHolder()
+				{
+					if (ringBuffer)
+						ringBuffer->close();
+				}
+				std::shared_ptr<LoggingRingBuffer> ringBuffer;
+				const AsyncLoggingWorker* worker = nullptr;
+				uint64_t generation = 0;
+			};
+
+			static thread_local ThreadRingBufferHolder t_ringBufferHolder;
+			static thread_local bool t_isDraining = false;
+
+			struct DrainingScope
+			{
+				DrainingScope() { t_isDraining = true; }
+				~DrainingScope() { t_isDraining = false; }
+			};
+
+			struct ProducingScope
+			{
+				explicit ProducingScope(LoggingRingBuffer* ringBuffer) : ringBuffer(ringBuffer) { ringBuffer->producing.store(true, std::memory_order_seq_cst); }
+				~ProducingScope() { ringBuffer->producing.store(false, std::memory_order_release); }
+				LoggingRingBuffer* ringBuffer;
+			};
+
+			AsyncLoggingWorker::AsyncLoggingWorker(LoggingMessageDispatcher* dispatcher)
+				: _dispatcher(dispatcher), _running(false), _generation(0), _batches(0),
+				_retiredStatistics{}, _ringsChanged(false), _stopRequested(false)
+			{
+			}
+
+			AsyncLoggingWorker::~AsyncLoggingWorker()
+			{
+				stop();
+			}
+
+			void AsyncLoggingWorker::start(const AsyncLoggingOptions& options)
+			{
+				stop();
+				_options = options;
+				{
+					std::lock_guard<std::mutex> lockGuard(_ringsMutex);
+					// ring buffers of the previous generation are replaced on the next write of their thread
+					for (auto& ringBuffer : _rings)
+						ringBuffer->close();
+				}
+				{
+					std::lock_guard<std::mutex> lockGuard(_wakeUpMutex);
+					_stopRequested = false;
+				}
+				_generation.fetch_add(1, std::memory_order_acq_rel);
+				_thread = std::thread(&AsyncLoggingWorker::run, this);
+				_running.store(true, std::memory_order_release);
+			}
+
+			void AsyncLoggingWorker::stop()
+			{
+				if (!_thread.joinable())
+					return;
+				_running.store(false, std::memory_order_seq_cst);
+				{
+					// producers which still saw the worker running finish their push before the final drain
+					std::lock_guard<std::mutex> lockGuard(_ringsMutex);
+					for (auto& ringBuffer : _rings)
+						while (ringBuffer->producing.load(std::memory_order_seq_cst))
+							std::this_thread::yield();
+				}
+				{
+					std::lock_guard<std::mutex> lockGuard(_wakeUpMutex);
+					_stopRequested = true;
+				}
+				_wakeUpCondition.notify_one();
+				_thread.join();
+				drain();
+			}
+
+			bool AsyncLoggingWorker::isRunning() const
+			{
+				return _running.load(std::memory_order_acquire);
+			}
+
+			bool AsyncLoggingWorker::isDrainingThread()
+			{
+				return t_isDraining;
+			}
+
+			LoggingRingBuffer* AsyncLoggingWorker::getThreadRingBuffer()
+			{
+				ThreadRingBufferHolder& holder = t_ringBufferHolder;
+				const uint64_t generation = _generation.load(std::memory_order_acquire);
+				if (holder.worker != this || holder.generation != generation || !holder.ringBuffer)
+				{
+					if (holder.ringBuffer)
+						holder.ringBuffer->close();
+					holder.ringBuffer = std::make_shared<LoggingRingBuffer>(_options.threadBufferSize);
+					holder.worker = this;
+					holder.generation = generation;
+					{
+						std::lock_guard<std::mutex> lockGuard(_ringsMutex);
+						_rings.push_back(holder.ringBuffer);
+					}
+					_ringsChanged.store(true, std::memory_order_release);
+				}
+				return holder.ringBuffer.get();
+			}
+
+			void AsyncLoggingWorker::drainThreadRingBuffer()
+			{
+				const LoggingRingBuffer* ringBuffer = t_ringBufferHolder.ringBuffer.get();
+				if (ringBuffer && !ringBuffer->empty())
+					drain();
+			}
+
+			bool AsyncLoggingWorker::enqueue(std::string_view message)
+			{
+				if (isRunning() && tryEnqueue(message))
+					return true;
+				// the pending messages of this thread go before the one written synchronously
+				drainThreadRingBuffer();
+				return false;
+			}
+
+			bool AsyncLoggingWorker::tryEnqueue(std::string_view message)
+			{
+				LoggingRingBuffer* ringBuffer = getThreadRingBuffer();
+				ProducingScope producingScope(ringBuffer);
+				// pairs with stop(), which either sees this thread producing or is seen here
+				if (!_running.load(std::memory_order_seq_cst))
+					return false;
+				if (ringBuffer->tryPush(message))
+					return true;
+
+				switch (_options.overflowPolicy)
+				{
+				case AsyncOverflowPolicy::DROP_NEWEST:
+					ringBuffer->droppedNewest.store(ringBuffer->droppedNewest.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+					return true;
+				case AsyncOverflowPolicy::DROP_OLDEST:
+					ringBuffer->dropOldest(message);
+					if (!ringBuffer->tryPush(message))
+						ringBuffer->droppedNewest.store(ringBuffer->droppedNewest.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+					return true;
+				case AsyncOverflowPolicy::BLOCK:
+				default:
+					ringBuffer->blocked.store(ringBuffer->blocked.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+					do
+					{
+						wakeUp();
+						std::this_thread::yield();
+						if (!isRunning())
+							return false;
+					} while (!ringBuffer->tryPush(message));
+					return true;
+				}
+			}
+
+			void AsyncLoggingWorker::wakeUp()
+			{
+				{
+					std::lock_guard<std::mutex> lockGuard(_wakeUpMutex);
+				}
+				_wakeUpCondition.notify_one();
+			}
+
+			void AsyncLoggingWorker::drain()
+			{
+				std::lock_guard<std::mutex> lockGuard(_drainMutex);
+				drainOnce();
+			}
+
+			void AsyncLoggingWorker::run()
+			{
+				while (true)
+				{
+					bool drained;
+					{
+						std::lock_guard<std::mutex> lockGuard(_drainMutex);
+						drained = drainOnce();
+					}
+					std::unique_lock<std::mutex> lockGuard(_wakeUpMutex);
+					if (_stopRequested)
+						break;
+					if (!drained)
+						_wakeUpCondition.wait_for(lockGuard, std::chrono::milliseconds(_options.flushIntervalMilliseconds));
+				}
+			}
+
+			bool AsyncLoggingWorker::drainOnce()
+			{
+				DrainingScope drainingScope;
+				if (_ringsChanged.exchange(false, std::memory_order_acq_rel))
+				{
+					std::lock_guard<std::mutex> lockGuard(_ringsMutex);
+					_drainingRings = _rings;
+				}
+
+				bool drained = false;
+				bool hasClosedRingBuffer = false;
+				for (auto& ringBuffer : _drainingRings)
+				{
+					if (ringBuffer->isClosed())
+						hasClosedRingBuffer = true;
+					while (ringBuffer->tryPopTo(_batch))
+					{
+						_batch.push_back('\n');
+						drained = true;
+						if (_batch.size() >= _options.maxBatchSize)
+							writeBatch();
+					}
+				}
+				writeBatch();
+
+				if (hasClosedRingBuffer)
+				{
+					std::lock_guard<std::mutex> lockGuard(_ringsMutex);
+					for (size_t i = 0; i < _rings.size();)
+					{
+						auto& ringBuffer = _rings[i];
+						if (ringBuffer->isClosed() && ringBuffer->empty())
+						{
+							_retiredStatistics.enqueued += ringBuffer->enqueued.load(std::memory_order_relaxed);
+							_retiredStatistics.droppedNewest += ringBuffer->droppedNewest.load(std::memory_order_relaxed);
+							_retiredStatistics.droppedOldest += ringBuffer->droppedOldest.load(std::memory_order_relaxed);
+							_retiredStatistics.blocked += ringBuffer->blocked.load(std::memory_order_relaxed);
+							_rings.erase(_rings.begin() + i);
+						}
+						else
+							++i;
+					}
+					_drainingRings = _rings;
+				}
+				return drained;
+			}
+
+			void AsyncLoggingWorker::writeBatch()
+			{
+				if (_batch.empty())
+					return;
+				_dispatcher->writeBatch(_batch);
+				_batch.clear();
+				_batches.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			AsyncLoggingStatistics AsyncLoggingWorker::getStatistics()
+			{
+				std::lock_guard<std::mutex> lockGuard(_ringsMutex);
+				AsyncLoggingStatistics statistics = _retiredStatistics;
+				for (auto& ringBuffer : _rings)
+				{
+					statistics.enqueued += ringBuffer->enqueued.load(std::memory_order_relaxed);
+					statistics.droppedNewest += ringBuffer->droppedNewest.load(std::memory_order_relaxed);
+					statistics.droppedOldest += ringBuffer->droppedOldest.load(std::memory_order_relaxed);
+					statistics.blocked += ringBuffer->blocked.load(std::memory_order_relaxed);
+				}
+				statistics.batches = _batches.load(std::memory_order_relaxed);
+				return statistics;
+			}
+		}
+	}
+}
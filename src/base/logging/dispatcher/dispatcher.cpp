@@ -2,12 +2,19 @@
 
 #include <base/logging/sinks/interface.h>
 
+#include <mutex>
+
 namespace Base
 {
 	namespace Logging
 	{
 		namespace Details
 		{
+			LoggingMessageDispatcher::LoggingMessageDispatcher()
+				: _recordOnly(false), _asyncWorker(this)
+			{
+			}
+
 			int LoggingMessageDispatcher::addSink(Sink* sink)
 			{
 				std::unique_lock<std::shared_mutex> lockGuard(_mutex);
@@ -17,16 +24,60 @@ namespace Base
 				else
 					handle = _sinks.rbegin()->first + 1;
 				_sinks.emplace_back(handle, std::unique_ptr<Sink>(sink));
+				updateRecordOnly();
 				return handle;
 			}
 			void LoggingMessageDispatcher::write(std::string_view string)
 			{
+				if (!AsyncLoggingWorker::isDrainingThread() && _asyncWorker.enqueue(string))
+					return;
 				safe_executor([string](const std::unique_ptr<Sink>& sink)
 					{
 						sink->write(string);
 						sink->write("\n");
 					});
 			}
+			void LoggingMessageDispatcher::writeBatch(std::string_view batch)
+			{
+				safe_executor([batch](const std::unique_ptr<Sink>& sink)
+					{
+						sink->write(batch);
+					});
+			}
+			void LoggingMessageDispatcher::writeRecord(const LoggingRecord& record)
+			{
+				std::string text;
+				safe_executor([&record, &text](const std::unique_ptr<Sink>& sink)
+					{
+						if (sink->acceptsRecords())
+							sink->writeRecord(record);
+						else
+						{
+							// a text sink was added while the message was being recorded
+							if (text.empty())
+								formatLoggingRecord(record, text);
+							sink->write(text);
+							sink->write("\n");
+						}
+					});
+			}
+			bool LoggingMessageDispatcher::isRecordOnly() const
+			{
+				return _recordOnly.load(std::memory_order_relaxed);
+			}
+			void LoggingMessageDispatcher::updateRecordOnly()
+			{
+				bool recordOnly = !_sinks.empty();
+				for (auto& _sink : _sinks)
+				{
+					if (!_sink.second->acceptsRecords())
+					{
+						recordOnly = false;
+						break;
+					}
+				}
+				_recordOnly.store(recordOnly, std::memory_order_relaxed);
+			}
 			void LoggingMessageDispatcher::removeSink(int handle)
 			{
 				std::unique_ptr<Sink> sinkToRemove;
@@ -41,17 +92,39 @@ namespace Base
 							break;
 						}
 					}
+					updateRecordOnly();
 				}
 			}
 			void LoggingMessageDispatcher::flush()
 			{
+				if (!AsyncLoggingWorker::isDrainingThread())
+					_asyncWorker.drain();
 				safe_executor([](const std::unique_ptr<Sink>& sink)
 					{
 						sink->flush();
 					});
 			}
+			void LoggingMessageDispatcher::enableAsync(const AsyncLoggingOptions& options)
+			{
+				_asyncWorker.start(options);
+			}
+			void LoggingMessageDispatcher::disableAsync()
+			{
+				_asyncWorker.stop();
+			}
+			bool LoggingMessageDispatcher::isAsyncEnabled() const
+			{
+				return _asyncWorker.isRunning();
+			}
+			AsyncLoggingStatistics LoggingMessageDispatcher::getAsyncStatistics()
+			{
+				return _asyncWorker.getStatistics();
+			}
 			LoggingMessageDispatcher::~LoggingMessageDispatcher()
 			{
+				// stops the background thread and writes out everything still queued
+				_asyncWorker.stop();
+				_asyncWorker.drain();
 				for (auto& _sink : _sinks)
 				{
 					auto& sink = _sink.second;
@@ -107,6 +180,7 @@ namespace Base
 								}
 							}
 						}
+						updateRecordOnly();
 					}
 					for (auto& exceptionMessage : failedSinkMessages)
 					{
@@ -0,0 +1,157 @@
+#include <base/logging/dispatcher/ring_buffer.h>
+
+#include <cstring>
+
+namespace Base
+{
+	namespace Logging
+	{
+		namespace Details
+		{
+			static const uint32_t wrapMarker = 0xFFFFFFFFU;
+			static const size_t recordHeaderSize = sizeof(uint32_t);
+
+			static size_t roundUpToPowerOfTwo(size_t value)
+			{
+				size_t result = 1024;
+				while (result < value)
+					result <<= 1;
+				return result;
+			}
+
+			LoggingRingBuffer::LoggingRingBuffer(size_t capacity)
+				: enqueued(0), droppedNewest(0), droppedOldest(0), blocked(0), producing(false),
+				_capacity(roundUpToPowerOfTwo(capacity)), _mask(_capacity - 1), _closed(false), _head(0), _tail(0)
+			{
+				_buffer.reset(new char[_capacity]);
+			}
+
+			size_t LoggingRingBuffer::capacity() const
+			{
+				return _capacity;
+			}
+
+			size_t LoggingRingBuffer::getMaxMessageSize() const
+			{
+				// keeps (padding before wrap + record) always smaller than the capacity
+				return _capacity / 2 - recordHeaderSize * 2;
+			}
+
+			size_t LoggingRingBuffer::getRecordSize(size_t messageSize) const
+			{
+				return (recordHeaderSize + messageSize + 3) & ~size_t(3);
+			}
+
+			size_t LoggingRingBuffer::getRequiredSpace(uint64_t head, size_t recordSize) const
+			{
+				const size_t contiguous = _capacity - size_t(head & _mask);
+				if (recordSize <= contiguous)
+					return recordSize;
+				return contiguous + recordSize;
+			}
+
+			bool LoggingRingBuffer::tryPush(std::string_view message)
+			{
+				if (message.size() > getMaxMessageSize())
+					message = message.substr(0, getMaxMessageSize());
+				const size_t recordSize = getRecordSize(message.size());
+				uint64_t head = _head.load(std::memory_order_relaxed);
+				const uint64_t tail = _tail.load(std::memory_order_acquire);
+				if (head + getRequiredSpace(head, recordSize) - tail > _capacity)
+					return false;
+
+				size_t offset = size_t(head & _mask);
+				if (recordSize > _capacity - offset)
+				{
+					memcpy(_buffer.get() + offset, &wrapMarker, recordHeaderSize);
+					head += _capacity - offset;
+					offset = 0;
+				}
+				const uint32_t length = uint32_t(message.size());
+				memcpy(_buffer.get() + offset, &length, recordHeaderSize);
+				memcpy(_buffer.get() + offset + recordHeaderSize, message.data(), message.size());
+				_head.store(head + recordSize, std::memory_order_release);
+				enqueued.store(enqueued.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+				return true;
+			}
+
+			uint64_t LoggingRingBuffer::dropOldest(std::string_view message)
+			{
+				if (message.size() > getMaxMessageSize())
+					message = message.substr(0, getMaxMessageSize());
+				const size_t recordSize = getRecordSize(message.size());
+				const uint64_t head = _head.load(std::memory_order_relaxed);
+				const size_t requiredSpace = getRequiredSpace(head, recordSize);
+
+				uint64_t dropped = 0;
+				uint64_t tail = _tail.load(std::memory_order_acquire);
+				while (head + requiredSpace - tail > _capacity)
+				{
+					const size_t offset = size_t(tail & _mask);
+					uint32_t length;
+					memcpy(&length, _buffer.get() + offset, recordHeaderSize);
+					const bool isWrapMarker = length == wrapMarker;
+					const size_t advance = isWrapMarker ? _capacity - offset : getRecordSize(length);
+					// on failure tail is reloaded, the consumer has released some space
+					if (_tail.compare_exchange_weak(tail, tail + advance, std::memory_order_acq_rel, std::memory_order_acquire))
+					{
+						tail += advance;
+						if (!isWrapMarker)
+							++dropped;
+					}
+				}
+				droppedOldest.store(droppedOldest.load(std::memory_order_relaxed) + dropped, std::memory_order_relaxed);
+				return dropped;
+			}
+
+			void LoggingRingBuffer::close()
+			{
+				_closed.store(true, std::memory_order_release);
+			}
+
+			bool LoggingRingBuffer::isClosed() const
+			{
+				return _closed.load(std::memory_order_acquire);
+			}
+
+			bool LoggingRingBuffer::empty() const
+			{
+				return _tail.load(std::memory_order_acquire) == _head.load(std::memory_order_acquire);
+			}
+
+			bool LoggingRingBuffer::tryPopTo(std::string& output)
+			{
+				uint64_t tail = _tail.load(std::memory_order_acquire);
+				while (true)
+				{
+					const uint64_t head = _head.load(std::memory_order_acquire);
+					if (tail == head)
+						return false;
+					const size_t offset = size_t(tail & _mask);
+					uint32_t length;
+					memcpy(&length, _buffer.get() + offset, recordHeaderSize);
+					if (length == wrapMarker)
+					{
+						_tail.compare_exchange_strong(tail, tail + (_capacity - offset), std::memory_order_acq_rel, std::memory_order_acquire);
+						tail = _tail.load(std::memory_order_acquire);
+						continue;
+					}
+					// The producer may be overwriting the record after dropping it, so the length is not trusted
+					// until the CAS below succeeds: it must describe a record inside the buffer before anything is copied.
+					if (length > getMaxMessageSize() || offset + recordHeaderSize + length > _capacity)
+					{
+						// torn read, the record was dropped and overwritten by the producer
+						tail = _tail.load(std::memory_order_acquire);
+						continue;
+					}
+					const size_t originalSize = output.size();
+					output.append(_buffer.get() + offset + recordHeaderSize, length);
+					// the copy is only valid if the producer did not drop the record in the meantime
+					if (_tail.compare_exchange_strong(tail, tail + getRecordSize(length), std::memory_order_acq_rel, std::memory_order_acquire))
+						return true;
+					output.resize(originalSize);
+				}
+			}
+		}
+	}
+}
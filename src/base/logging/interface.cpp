@@ -1,4 +1,5 @@
 #include <base/logging/interface.h>
+#include <base/logging/async.h>
 #include <base/logging/dispatcher/dispatcher.h>
 
 namespace Base::Logging
@@ -15,5 +16,25 @@ namespace Base::Logging
 	{
 		Details::g_dispatcher.write(message);
 	}
+	void flush()
+	{
+		Details::g_dispatcher.flush();
+	}
+	void enableAsyncLogging(const AsyncLoggingOptions& options)
+	{
+		Details::g_dispatcher.enableAsync(options);
+	}
+	void disableAsyncLogging()
+	{
+		Details::g_dispatcher.disableAsync();
+	}
+	bool isAsyncLoggingEnabled()
+	{
+		return Details::g_dispatcher.isAsyncEnabled();
+	}
+	AsyncLoggingStatistics getAsyncLoggingStatistics()
+	{
+		return Details::g_dispatcher.getAsyncStatistics();
+	}
 }
 
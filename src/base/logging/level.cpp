@@ -0,0 +1,97 @@
+#include <base/logging/level.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace Base
+{
+	namespace Logging
+	{
+		namespace Details
+		{
+			struct ModuleLoggingLevel
+			{
+				std::atomic<int> level;
+				bool hasExplicitLevel;
+			};
+
+			struct LoggingLevelRegistry
+			{
+				std::mutex mutex;
+				int level = LOGGING_LEVEL_INFO;
+				std::map<std::string, std::unique_ptr<ModuleLoggingLevel>, std::less<>> modules;
+			};
+
+			static LoggingLevelRegistry& getLoggingLevelRegistry()
+			{
+				// never destroyed, call sites keep references to the slots until process exit
+				static LoggingLevelRegistry* registry = new LoggingLevelRegistry;
+				return *registry;
+			}
+
+			static ModuleLoggingLevel& findOrCreateModuleLoggingLevel(LoggingLevelRegistry& registry, std::string_view module)
+			{
+				auto iterator = registry.modules.find(module);
+				if (iterator == registry.modules.end())
+				{
+					std::unique_ptr<ModuleLoggingLevel> moduleLevel(new ModuleLoggingLevel{ {registry.level}, false });
+					iterator = registry.modules.emplace(std::string(module), std::move(moduleLevel)).first;
+				}
+				return *iterator->second;
+			}
+
+			const std::atomic<int>& getModuleLoggingLevelSlot(const char* module)
+			{
+				LoggingLevelRegistry& registry = getLoggingLevelRegistry();
+				std::lock_guard<std::mutex> lockGuard(registry.mutex);
+				return findOrCreateModuleLoggingLevel(registry, module).level;
+			}
+		}
+
+		void setLoggingLevel(Level level)
+		{
+			Details::LoggingLevelRegistry& registry = Details::getLoggingLevelRegistry();
+			std::lock_guard<std::mutex> lockGuard(registry.mutex);
+			registry.level = int(level);
+			for (auto& module : registry.modules)
+			{
+				if (!module.second->hasExplicitLevel)
+					module.second->level.store(int(level), std::memory_order_relaxed);
+			}
+		}
+
+		Level getLoggingLevel()
+		{
+			Details::LoggingLevelRegistry& registry = Details::getLoggingLevelRegistry();
+			std::lock_guard<std::mutex> lockGuard(registry.mutex);
+			return Level(registry.level);
+		}
+
+		void setModuleLoggingLevel(std::string_view module, Level level)
+		{
+			Details::LoggingLevelRegistry& registry = Details::getLoggingLevelRegistry();
+			std::lock_guard<std::mutex> lockGuard(registry.mutex);
+			Details::ModuleLoggingLevel& moduleLevel = Details::findOrCreateModuleLoggingLevel(registry, module);
+			moduleLevel.hasExplicitLevel = true;
+			moduleLevel.level.store(int(level), std::memory_order_relaxed);
+		}
+
+		void resetModuleLoggingLevel(std::string_view module)
+		{
+			Details::LoggingLevelRegistry& registry = Details::getLoggingLevelRegistry();
+			std::lock_guard<std::mutex> lockGuard(registry.mutex);
+			Details::ModuleLoggingLevel& moduleLevel = Details::findOrCreateModuleLoggingLevel(registry, module);
+			moduleLevel.hasExplicitLevel = false;
+			moduleLevel.level.store(registry.level, std::memory_order_relaxed);
+		}
+
+		Level getModuleLoggingLevel(std::string_view module)
+		{
+			Details::LoggingLevelRegistry& registry = Details::getLoggingLevelRegistry();
+			std::lock_guard<std::mutex> lockGuard(registry.mutex);
+			return Level(Details::findOrCreateModuleLoggingLevel(registry, module).level.load(std::memory_order_relaxed));
+		}
+	}
+}
@@ -0,0 +1,149 @@
+#include <base/logging/record.h>
+
+#include <fmt/format.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iterator>
+
+namespace Base
+{
+	namespace Logging
+	{
+		namespace Details
+		{
+			static std::atomic<uint32_t> g_lastLoggingThreadId(0);
+
+			uint32_t getLoggingThreadId()
+			{
+				static thread_local const uint32_t threadId = ++g_lastLoggingThreadId;
+				return threadId;
+			}
+
+			int64_t getLoggingTimestamp()
+			{
+				return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+			}
+
+			void formatLoggingSite(const LoggingSite& site, std::string& text)
+			{
+				text += '[';
+				text += site.file;
+				text += ':';
+				const fmt::format_int line(site.line);
+				text.append(line.data(), line.size());
+				text += ' ';
+				text += site.function;
+				text += "] ";
+				if (site.type == LoggingSiteType::CHECK)
+				{
+					text += "Check failed: ";
+					text += site.expressions[0];
+				}
+				else if (site.type == LoggingSiteType::BINARY_CHECK)
+				{
+					text += "Check failed: ";
+					text += site.expressions[0];
+					text += ' ';
+					text += site.expressions[1];
+					text += ' ';
+					text += site.expressions[2];
+					text += ' ';
+				}
+			}
+
+			bool readLoggingArgument(std::string_view& arguments, LoggingArgument& argument)
+			{
+				if (arguments.empty())
+					return false;
+				argument.type = LoggingArgumentType(arguments[0]);
+				arguments.remove_prefix(1);
+				switch (argument.type)
+				{
+				case LoggingArgumentType::STRING:
+				{
+					uint64_t size;
+					if (!readVarint(arguments, size) || arguments.size() < size)
+						return false;
+					argument.string = arguments.substr(0, size_t(size));
+					arguments.remove_prefix(size_t(size));
+					return true;
+				}
+				case LoggingArgumentType::CHARACTER:
+				case LoggingArgumentType::BOOLEAN:
+					if (arguments.empty())
+						return false;
+					argument.integer = uint8_t(arguments[0]);
+					arguments.remove_prefix(1);
+					return true;
+				case LoggingArgumentType::UNSIGNED_INTEGER:
+				case LoggingArgumentType::POINTER:
+					return readVarint(arguments, argument.integer);
+				case LoggingArgumentType::SIGNED_INTEGER:
+					if (!readVarint(arguments, argument.integer))
+						return false;
+					argument.integer = uint64_t(decodeZigzag(argument.integer));
+					return true;
+				case LoggingArgumentType::FLOATING_POINT:
+					if (arguments.size() < sizeof(double))
+						return false;
+					memcpy(&argument.floatingPoint, arguments.data(), sizeof(double));
+					arguments.remove_prefix(sizeof(double));
+					return true;
+				default:
+					return false;
+				}
+			}
+
+			bool formatLoggingArguments(std::string_view arguments, std::string& text)
+			{
+				LoggingArgument argument;
+				while (!arguments.empty())
+				{
+					if (!readLoggingArgument(arguments, argument))
+						return false;
+					switch (argument.type)
+					{
+					case LoggingArgumentType::STRING:
+						text.append(argument.string.data(), argument.string.size());
+						break;
+					case LoggingArgumentType::CHARACTER:
+						text += char(argument.integer);
+						break;
+					case LoggingArgumentType::BOOLEAN:
+						text += argument.integer ? '1' : '0';
+						break;
+					case LoggingArgumentType::SIGNED_INTEGER:
+					{
+						const fmt::format_int formatted(int64_t(argument.integer));
+						text.append(formatted.data(), formatted.size());
+						break;
+					}
+					case LoggingArgumentType::UNSIGNED_INTEGER:
+					{
+						const fmt::format_int formatted(argument.integer);
+						text.append(formatted.data(), formatted.size());
+						break;
+					}
+					case LoggingArgumentType::FLOATING_POINT:
+						fmt::format_to(std::back_inserter(text), "{:g}", argument.floatingPoint);
+						break;
+					case LoggingArgumentType::POINTER:
+						// same as the fmt representation of pointers
+						fmt::format_to(std::back_inserter(text), "{:#x}", argument.integer);
+						break;
+					}
+				}
+				return true;
+			}
+
+			void formatLoggingRecord(const LoggingRecord& record, std::string& text)
+			{
+				if (record.site)
+					formatLoggingSite(*record.site, text);
+				if (!formatLoggingArguments(record.arguments, text))
+					text += "(malformed arguments)";
+			}
+		}
+	}
+}
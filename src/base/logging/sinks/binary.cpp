@@ -0,0 +1,354 @@
+#include <base/logging/sinks/binary.h>
+
+#include <fmt/chrono.h>
+#include <fmt/format.h>
+#include <atomic>
+#include <cstring>
+#include <ctime>
+#include <iterator>
+#include <limits>
+#include <tuple>
+#include <vector>
+
+namespace Base
+{
+	namespace Logging {
+		static FileSinkOptions getBinaryFileSinkOptions(FileSinkOptions options)
+		{
+			// the site table is only written once per file
+			options.maxFileSize = 0;
+			options.maxFileAgeSeconds = 0;
+			return options;
+		}
+
+		static uint64_t getBinaryFileSinkNumber()
+		{
+			// 0 marks slots without a cached site id
+			static std::atomic<uint64_t> lastNumber{ 0 };
+			return ++lastNumber;
+		}
+
+		static void appendString(std::string& record, std::string_view value)
+		{
+			Details::appendVarint(record, value.size());
+			record.append(value.data(), value.size());
+		}
+
+		BinaryFileSink::BinaryFileSink(std::string_view path, const FileSinkOptions& options)
+			: FileSink(path, getBinaryFileSinkOptions(options), false), _number(getBinaryFileSinkNumber()), _lastTimestamp(0)
+		{
+			writeHeader();
+		}
+
+#ifdef _WIN32
+		BinaryFileSink::BinaryFileSink(std::wstring_view path, const FileSinkOptions& options)
+			: FileSink(path, getBinaryFileSinkOptions(options), false), _number(getBinaryFileSinkNumber()), _lastTimestamp(0)
+		{
+			writeHeader();
+		}
+#endif
+
+		std::string_view BinaryFileSink::getName()
+		{
+			return "BinaryFile";
+		}
+
+		bool BinaryFileSink::SiteLess::operator()(const Details::LoggingSite& left, const Details::LoggingSite& right) const
+		{
+			return std::tie(left.file, left.line, left.function, left.type, left.expressions[0], left.expressions[1], left.expressions[2]) <
+				std::tie(right.file, right.line, right.function, right.type, right.expressions[0], right.expressions[1], right.expressions[2]);
+		}
+
+		void BinaryFileSink::writeHeader()
+		{
+			std::string header(Details::binaryLogMagic, sizeof(Details::binaryLogMagic));
+			header.append(reinterpret_cast<const char*>(&Details::binaryLogVersion), sizeof(Details::binaryLogVersion));
+			FileSink::write(header);
+		}
+
+		void BinaryFileSink::write(std::string_view message)
+		{
+			std::unique_lock<std::mutex> lock = lockBuffers();
+			// one record per line, messages usually arrive without their line break
+			size_t position;
+			while ((position = message.find('\n')) != std::string_view::npos)
+			{
+				if (_pendingText.empty())
+					writeText(message.substr(0, position), lock);
+				else
+				{
+					_pendingText.append(message.data(), position);
+					writeText(_pendingText, lock);
+					_pendingText.clear();
+				}
+				message.remove_prefix(position + 1);
+			}
+			_pendingText.append(message.data(), message.size());
+		}
+
+		bool BinaryFileSink::acceptsRecords()
+		{
+			return true;
+		}
+
+		void BinaryFileSink::writeRecord(const Details::LoggingRecord& record)
+		{
+			std::unique_lock<std::mutex> lock = lockBuffers();
+			_record.clear();
+			// collects the definition of a new site in _record first
+			const uint32_t siteId = record.site ? getSiteId(*record.site) : 0;
+			_record.push_back(char(Details::BinaryLogRecordType::MESSAGE));
+			Details::appendVarint(_record, siteId);
+			appendTimestamp(record.timestamp);
+			Details::appendVarint(_record, record.threadId);
+			// the arguments hold no addresses, they are stored as encoded by LoggingStream
+			appendString(_record, record.arguments);
+			FileSink::write(_record, lock);
+		}
+
+		BinaryFileSink::~BinaryFileSink()
+		{
+			if (!_pendingText.empty())
+			{
+				try
+				{
+					std::unique_lock<std::mutex> lock = lockBuffers();
+					writeText(_pendingText, lock);
+				}
+				catch (...) {}
+			}
+		}
+
+		void BinaryFileSink::writeText(std::string_view text, std::unique_lock<std::mutex>& lock)
+		{
+			_record.clear();
+			_record.push_back(char(Details::BinaryLogRecordType::TEXT));
+			appendTimestamp(Details::getLoggingTimestamp());
+			Details::appendVarint(_record, Details::getLoggingThreadId());
+			appendString(_record, text);
+			FileSink::write(_record, lock);
+		}
+
+		void BinaryFileSink::appendTimestamp(int64_t timestamp)
+		{
+			Details::appendVarint(_record, Details::encodeZigzag(timestamp - _lastTimestamp));
+			_lastTimestamp = timestamp;
+		}
+
+		uint32_t BinaryFileSink::getSiteId(const Details::LoggingSite& site)
+		{
+			// the slot holds the number of the sink in the upper half and the site id in the lower half,
+			// call sites alternating between several binary sinks fall back to the map
+			if (site.slot)
+			{
+				const uint64_t value = site.slot->value.load(std::memory_order_relaxed);
+				if (value >> 32 == _number)
+					return uint32_t(value);
+			}
+
+			uint32_t siteId;
+			auto iterator = _siteIds.find(site);
+			if (iterator != _siteIds.end())
+				siteId = iterator->second;
+			else
+			{
+				siteId = uint32_t(_siteIds.size() + 1);
+				_siteIds.emplace(site, siteId);
+				appendSite(site, siteId);
+			}
+			if (site.slot)
+				site.slot->value.store(_number << 32 | siteId, std::memory_order_relaxed);
+			return siteId;
+		}
+
+		void BinaryFileSink::appendSite(const Details::LoggingSite& site, uint32_t siteId)
+		{
+			_record.push_back(char(Details::BinaryLogRecordType::SITE));
+			Details::appendVarint(_record, siteId);
+			_record.push_back(char(site.type));
+			Details::appendVarint(_record, uint32_t(site.line));
+			appendString(_record, site.file);
+			appendString(_record, site.function);
+			const int numberOfExpressions = site.type == Details::LoggingSiteType::CHECK ? 1 : site.type == Details::LoggingSiteType::BINARY_CHECK ? 3 : 0;
+			for (int index = 0; index < numberOfExpressions; ++index)
+				appendString(_record, site.expressions[index]);
+		}
+
+		namespace
+		{
+			struct DecodedSite
+			{
+				Details::LoggingSiteType type;
+				uint32_t line;
+				std::string file;
+				std::string function;
+				std::string expressions[3];
+			};
+
+			class BinaryLogReader
+			{
+			public:
+				explicit BinaryLogReader(std::string_view data) : _data(data) {}
+				bool empty() const { return _data.empty(); }
+
+				bool read(uint8_t& value)
+				{
+					if (_data.empty())
+						return false;
+					value = uint8_t(_data[0]);
+					_data.remove_prefix(1);
+					return true;
+				}
+
+				template <typename Type>
+				bool readVarint(Type& value)
+				{
+					uint64_t encoded;
+					if (!Details::readVarint(_data, encoded) || encoded > uint64_t(std::numeric_limits<Type>::max()))
+						return false;
+					value = Type(encoded);
+					return true;
+				}
+
+				bool readTimestampDifference(int64_t& value)
+				{
+					uint64_t encoded;
+					if (!Details::readVarint(_data, encoded))
+						return false;
+					value = Details::decodeZigzag(encoded);
+					return true;
+				}
+
+				bool readString(std::string_view& value)
+				{
+					uint64_t size;
+					if (!Details::readVarint(_data, size) || _data.size() < size)
+						return false;
+					value = _data.substr(0, size_t(size));
+					_data.remove_prefix(size_t(size));
+					return true;
+				}
+
+				bool readHeader()
+				{
+					if (!atHeader())
+						return false;
+					_data.remove_prefix(sizeof(Details::binaryLogMagic));
+					uint32_t version;
+					if (_data.size() < sizeof(version))
+						return false;
+					memcpy(&version, _data.data(), sizeof(version));
+					_data.remove_prefix(sizeof(version));
+					return version == Details::binaryLogVersion;
+				}
+
+				bool atHeader() const
+				{
+					return _data.size() >= sizeof(Details::binaryLogMagic) &&
+						memcmp(_data.data(), Details::binaryLogMagic, sizeof(Details::binaryLogMagic)) == 0;
+				}
+			private:
+				std::string_view _data;
+			};
+
+			void appendTimestamp(std::string& text, int64_t timestamp, uint32_t threadId)
+			{
+				const int64_t seconds = timestamp / 1000000000;
+				const int64_t microseconds = timestamp % 1000000000 / 1000;
+				fmt::format_to(std::back_inserter(text), "{:%Y-%m-%d %H:%M:%S}.{:06} T{} ", fmt::gmtime(std::time_t(seconds)), microseconds, threadId);
+			}
+		}
+
+		bool decodeBinaryLog(std::string_view data, bool printTimestamps, const std::function<void(std::string_view)>& writeLine)
+		{
+			BinaryLogReader reader(data);
+			std::vector<DecodedSite> sites;
+			int64_t timestamp = 0;
+			std::string text;
+			if (!reader.atHeader())
+				return false;
+			while (!reader.empty())
+			{
+				// files opened in append mode contain a header for every session, the site table restarts with it
+				if (reader.atHeader())
+				{
+					if (!reader.readHeader())
+						return false;
+					sites.clear();
+					timestamp = 0;
+					continue;
+				}
+				uint8_t type;
+				if (!reader.read(type))
+					return false;
+				text.clear();
+				switch (Details::BinaryLogRecordType(type))
+				{
+				case Details::BinaryLogRecordType::SITE:
+				{
+					uint32_t siteId;
+					uint8_t siteType;
+					DecodedSite site;
+					std::string_view file, function;
+					if (!reader.readVarint(siteId) || !reader.read(siteType) || !reader.readVarint(site.line) ||
+						!reader.readString(file) || !reader.readString(function) || siteId != sites.size() + 1 ||
+						siteType > uint8_t(Details::LoggingSiteType::BINARY_CHECK))
+						return false;
+					site.type = Details::LoggingSiteType(siteType);
+					site.file = file;
+					site.function = function;
+					const int numberOfExpressions = site.type == Details::LoggingSiteType::CHECK ? 1 : site.type == Details::LoggingSiteType::BINARY_CHECK ? 3 : 0;
+					for (int index = 0; index < numberOfExpressions; ++index)
+					{
+						std::string_view expression;
+						if (!reader.readString(expression))
+							return false;
+						site.expressions[index] = expression;
+					}
+					sites.push_back(std::move(site));
+					continue;
+				}
+				case Details::BinaryLogRecordType::MESSAGE:
+				{
+					uint32_t siteId, threadId;
+					int64_t timestampDifference;
+					std::string_view arguments;
+					if (!reader.readVarint(siteId) || !reader.readTimestampDifference(timestampDifference) || !reader.readVarint(threadId) ||
+						!reader.readString(arguments) || siteId > sites.size())
+						return false;
+					timestamp += timestampDifference;
+					if (printTimestamps)
+						appendTimestamp(text, timestamp, threadId);
+					if (siteId != 0)
+					{
+						const DecodedSite& decodedSite = sites[siteId - 1];
+						const Details::LoggingSite site{ decodedSite.type, decodedSite.file.c_str(), int(decodedSite.line), decodedSite.function.c_str(),
+							{ decodedSite.expressions[0].c_str(), decodedSite.expressions[1].c_str(), decodedSite.expressions[2].c_str() }, nullptr };
+						Details::formatLoggingSite(site, text);
+					}
+					if (!Details::formatLoggingArguments(arguments, text))
+						return false;
+					break;
+				}
+				case Details::BinaryLogRecordType::TEXT:
+				{
+					uint32_t threadId;
+					int64_t timestampDifference;
+					std::string_view message;
+					if (!reader.readTimestampDifference(timestampDifference) || !reader.readVarint(threadId) || !reader.readString(message))
+						return false;
+					timestamp += timestampDifference;
+					if (printTimestamps)
+						appendTimestamp(text, timestamp, threadId);
+					text += message;
+					break;
+				}
+				default:
+					return false;
+				}
+				writeLine(text);
+			}
+			return true;
+		}
+	}
+}
@@ -1,9 +1,18 @@
 #include <base/logging/sinks/file.h>
 
+#include <base/logging.h>
+
 #ifdef _WIN32
 #include <base/logging/win32/utils.h>
+#include <base/error_codes/win32/stringify.h>
+#include <algorithm>
 #else
+#include <cerrno>
 #include <cstdio>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
 #endif
 
 namespace Base
@@ -14,37 +23,389 @@ namespace Base
 			return "File";
 		}
 
+		void FileSink::initialize()
+		{
+			if (_options.maxPendingBuffers == 0)
+				_options.maxPendingBuffers = 1;
+			_submittedBuffers = 0;
+			_writtenBuffers = 0;
+			_stopRequested = false;
+			_error = 0;
+			_fileSize = 0;
+			_endsWithNewLine = true;
+			_hasUnsyncedData = false;
+			_activeBuffer.reserve(_options.bufferSize);
+#ifdef _WIN32
+			L_CHECK_WIN32API(openFile(_options.truncate));
+#else
+			L_CHECK_STDCAPI(openFile(_options.truncate)) << "Failed to open log file " << _path;
+#endif
+			_lastSyncTime = _fileOpenTime;
+			_writer = std::thread(&FileSink::run, this);
+		}
+
 		void FileSink::write(std::string_view message)
 		{
-			fwrite(message.data(), 1, message.size(), _file);
+			std::unique_lock<std::mutex> lock(_mutex);
+			write(message, lock);
+		}
+
+		std::unique_lock<std::mutex> FileSink::lockBuffers()
+		{
+			return std::unique_lock<std::mutex>(_mutex);
+		}
+
+		void FileSink::write(std::string_view message, std::unique_lock<std::mutex>& lock)
+		{
+			throwIfFailed();
+			_activeBuffer.append(message.data(), message.size());
+			// only complete lines are handed over, so a rotation never splits a line
+			if (_activeBuffer.size() >= _options.bufferSize && (!_lineBased || _activeBuffer.back() == '\n'))
+				submitActiveBuffer(lock);
 		}
 
 		void FileSink::flush()
 		{
-			fflush(_file);
+			std::unique_lock<std::mutex> lock(_mutex);
+			throwIfFailed();
+			if (!_activeBuffer.empty())
+				submitActiveBuffer(lock);
+			const uint64_t submittedBuffers = _submittedBuffers;
+			_producerCondition.wait(lock, [this, submittedBuffers]() { return _writtenBuffers >= submittedBuffers || _error != 0; });
+			throwIfFailed();
 		}
 
 		FileSink::~FileSink()
 		{
-			fclose(_file);
+			{
+				std::lock_guard<std::mutex> lockGuard(_mutex);
+				if (!_activeBuffer.empty())
+				{
+					_pendingBuffers.push_back(std::move(_activeBuffer));
+					++_submittedBuffers;
+				}
+				_stopRequested = true;
+			}
+			_writerCondition.notify_one();
+			_writer.join();
+			if (_options.syncIntervalMilliseconds != 0 && _hasUnsyncedData)
+				syncFile();
+			closeFile();
+		}
+
+		void FileSink::submitActiveBuffer(std::unique_lock<std::mutex>& lock)
+		{
+			_producerCondition.wait(lock, [this]() { return _pendingBuffers.size() < _options.maxPendingBuffers || _error != 0; });
+			_pendingBuffers.push_back(std::move(_activeBuffer));
+			_activeBuffer = takeFreeBuffer();
+			++_submittedBuffers;
+			_writerCondition.notify_one();
+		}
+
+		std::string FileSink::takeFreeBuffer()
+		{
+			std::string buffer;
+			if (_freeBuffers.empty())
+				buffer.reserve(_options.bufferSize);
+			else
+			{
+				buffer = std::move(_freeBuffers.back());
+				_freeBuffers.pop_back();
+			}
+			return buffer;
+		}
+
+		void FileSink::throwIfFailed()
+		{
+			if (_error == 0)
+				return;
+#ifdef _WIN32
+			throw RuntimeException("Failed to write log file: " + getWin32ErrorString(DWORD(_error)), _error, ErrorCodeType::WIN32API);
+#else
+			throw RuntimeException("Failed to write log file: " + getStdCApiErrorString(int(_error)), _error, ErrorCodeType::STDCAPI);
+#endif
+		}
+
+		void FileSink::run()
+		{
+			std::vector<std::string> buffers;
+			std::unique_lock<std::mutex> lock(_mutex);
+			while (true)
+			{
+				if (!_writerCondition.wait_for(lock, std::chrono::milliseconds(_options.flushIntervalMilliseconds),
+					[this]() { return !_pendingBuffers.empty() || _stopRequested; }))
+				{
+					// flush interval elapsed, write out the partially filled buffer
+					if (!_activeBuffer.empty())
+					{
+						_pendingBuffers.push_back(std::move(_activeBuffer));
+						_activeBuffer = takeFreeBuffer();
+						++_submittedBuffers;
+					}
+				}
+				const bool stopRequested = _stopRequested;
+				const uint64_t submittedBuffers = _submittedBuffers;
+				buffers.swap(_pendingBuffers);
+				lock.unlock();
+
+				int64_t error = 0;
+				if (_error == 0)
+				{
+					const auto now = std::chrono::steady_clock::now();
+					if (!buffers.empty() && !writeToFile(buffers))
+					{
+#ifdef _WIN32
+						error = GetLastError();
+#else
+						error = errno;
+#endif
+					}
+					else if (_endsWithNewLine && _fileSize != 0 &&
+						((_options.maxFileSize != 0 && _fileSize >= _options.maxFileSize) ||
+							(_options.maxFileAgeSeconds != 0 && now - _fileOpenTime >= std::chrono::seconds(_options.maxFileAgeSeconds))))
+					{
+						rotate();
+						if (!openFile(true))
+						{
+#ifdef _WIN32
+							error = GetLastError();
+#else
+							error = errno;
+#endif
+						}
+					}
+					if (error == 0 && _hasUnsyncedData && _options.syncIntervalMilliseconds != 0 &&
+						now - _lastSyncTime >= std::chrono::milliseconds(_options.syncIntervalMilliseconds))
+						syncFile();
+				}
+
+				lock.lock();
+				for (auto& buffer : buffers)
+				{
+					if (_freeBuffers.size() < _options.maxPendingBuffers && buffer.capacity() >= _options.bufferSize)
+					{
+						buffer.clear();
+						_freeBuffers.push_back(std::move(buffer));
+					}
+				}
+				buffers.clear();
+				_writtenBuffers = submittedBuffers;
+				if (error != 0)
+					_error = error;
+				_producerCondition.notify_all();
+				if (stopRequested && _pendingBuffers.empty())
+					break;
+			}
+		}
+
+		void FileSink::rotate()
+		{
+			closeFile();
+			if (_options.maxRotatedFiles == 0)
+				return;
+#ifdef _WIN32
+			auto getRotatedPath = [this](unsigned index) { return _path + L"." + std::to_wstring(index); };
+			for (unsigned index = _options.maxRotatedFiles - 1; index != 0; --index)
+				MoveFileExW(getRotatedPath(index).c_str(), getRotatedPath(index + 1).c_str(), MOVEFILE_REPLACE_EXISTING);
+			MoveFileExW(_path.c_str(), getRotatedPath(1).c_str(), MOVEFILE_REPLACE_EXISTING);
+#else
+			auto getRotatedPath = [this](unsigned index) { return _path + "." + std::to_string(index); };
+			for (unsigned index = _options.maxRotatedFiles - 1; index != 0; --index)
+				::rename(getRotatedPath(index).c_str(), getRotatedPath(index + 1).c_str());
+			::rename(_path.c_str(), getRotatedPath(1).c_str());
+#endif
 		}
 
 #ifdef _WIN32
-		FileSink::FileSink(std::string_view path)
+		FileSink::FileSink(std::string_view path, const FileSinkOptions& options)
+			: FileSink(path, options, true)
+		{
+		}
+
+		FileSink::FileSink(std::wstring_view path, const FileSinkOptions& options)
+			: FileSink(path, options, true)
+		{
+		}
+
+		FileSink::FileSink(std::string_view path, const FileSinkOptions& options, bool lineBased)
+			: _path(Details::UTF8ToUTF16(path)), _file(INVALID_HANDLE_VALUE), _options(options), _lineBased(lineBased)
+		{
+			initialize();
+		}
+
+		FileSink::FileSink(std::wstring_view path, const FileSinkOptions& options, bool lineBased)
+			: _path(path), _file(INVALID_HANDLE_VALUE), _options(options), _lineBased(lineBased)
+		{
+			initialize();
+		}
+
+		bool FileSink::openFile(bool truncate)
+		{
+			// FILE_APPEND_DATA without FILE_WRITE_DATA makes every write an atomic append
+			HANDLE file = CreateFileW(_path.c_str(), truncate ? GENERIC_WRITE : FILE_APPEND_DATA,
+				FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+				truncate ? CREATE_ALWAYS : OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+				return false;
+			LARGE_INTEGER fileSize;
+			if (!GetFileSizeEx(file, &fileSize))
+			{
+				DWORD error = GetLastError();
+				CloseHandle(file);
+				SetLastError(error);
+				return false;
+			}
+			_file = file;
+			_fileSize = uint64_t(fileSize.QuadPart);
+			_fileOpenTime = std::chrono::steady_clock::now();
+			return true;
+		}
+
+		void FileSink::closeFile()
+		{
+			if (_file != INVALID_HANDLE_VALUE)
+			{
+				CloseHandle(_file);
+				_file = INVALID_HANDLE_VALUE;
+			}
+		}
+
+		bool FileSink::writeToFile(const std::vector<std::string>& buffers)
 		{
-			std::wstring UTF16Path = Details::UTF8ToUTF16(path);
-			_wfopen_s(&_file, UTF16Path.data(), L"wb");
+			for (const auto& buffer : buffers)
+			{
+				size_t offset = 0;
+				while (offset < buffer.size())
+				{
+					DWORD numberOfBytesWritten;
+					const DWORD numberOfBytesToWrite = DWORD(std::min<size_t>(buffer.size() - offset, 0x40000000));
+					if (!WriteFile(_file, buffer.data() + offset, numberOfBytesToWrite, &numberOfBytesWritten, nullptr))
+						return false;
+					offset += numberOfBytesWritten;
+					_fileSize += numberOfBytesWritten;
+				}
+				if (!buffer.empty())
+				{
+					_endsWithNewLine = buffer.back() == '\n';
+					_hasUnsyncedData = true;
+				}
+			}
+			return true;
 		}
 
-		FileSink::FileSink(std::wstring_view path)
+		void FileSink::syncFile()
 		{
-			_wfopen_s(&_file, path.data(), L"wb");
+			FlushFileBuffers(_file);
+			_hasUnsyncedData = false;
+			_lastSyncTime = std::chrono::steady_clock::now();
 		}
 #else
-		FileSink::FileSink(std::string_view path)
+		FileSink::FileSink(std::string_view path, const FileSinkOptions& options)
+			: FileSink(path, options, true)
 		{
-			_file = fopen(path.data(), "w");
+		}
+
+		FileSink::FileSink(std::string_view path, const FileSinkOptions& options, bool lineBased)
+			: _path(path), _file(-1), _options(options), _lineBased(lineBased)
+		{
+			initialize();
+		}
+
+		bool FileSink::openFile(bool truncate)
+		{
+			// O_APPEND makes every write an atomic append, even with other writers on the same file
+			int file = ::open(_path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC | (truncate ? O_TRUNC : 0), 0644);
+			if (file == -1)
+				return false;
+			struct stat fileStatus;
+			if (fstat(file, &fileStatus) != 0)
+			{
+				int error = errno;
+				::close(file);
+				errno = error;
+				return false;
+			}
+			_file = file;
+			_fileSize = uint64_t(fileStatus.st_size);
+			_fileOpenTime = std::chrono::steady_clock::now();
+			return true;
+		}
+
+		void FileSink::closeFile()
+		{
+			if (_file != -1)
+			{
+				::close(_file);
+				_file = -1;
+			}
+		}
+
+		bool FileSink::writeToFile(const std::vector<std::string>& buffers)
+		{
+			const size_t maxNumberOfVectors = 64;
+			size_t index = 0;
+			size_t offset = 0;
+			while (true)
+			{
+				while (index < buffers.size() && offset == buffers[index].size())
+				{
+					++index;
+					offset = 0;
+				}
+				if (index == buffers.size())
+					break;
+
+				iovec vectors[maxNumberOfVectors];
+				int numberOfVectors = 0;
+				for (size_t bufferIndex = index; bufferIndex < buffers.size() && numberOfVectors < int(maxNumberOfVectors); ++bufferIndex)
+				{
+					const size_t start = bufferIndex == index ? offset : 0;
+					if (buffers[bufferIndex].size() == start)
+						continue;
+					vectors[numberOfVectors].iov_base = const_cast<char*>(buffers[bufferIndex].data() + start);
+					vectors[numberOfVectors].iov_len = buffers[bufferIndex].size() - start;
+					++numberOfVectors;
+				}
+
+				ssize_t numberOfBytesWritten = ::writev(_file, vectors, numberOfVectors);
+				if (numberOfBytesWritten < 0)
+				{
+					if (errno == EINTR)
+						continue;
+					return false;
+				}
+				_fileSize += uint64_t(numberOfBytesWritten);
+				_hasUnsyncedData = true;
+
+				size_t remaining = size_t(numberOfBytesWritten);
+				while (remaining != 0)
+				{
+					const size_t available = buffers[index].size() - offset;
+					if (remaining < available)
+					{
+						offset += remaining;
+						break;
+					}
+					remaining -= available;
+					if (!buffers[index].empty())
+						_endsWithNewLine = buffers[index].back() == '\n';
+					++index;
+					offset = 0;
+				}
+			}
+			return true;
+		}
+
+		void FileSink::syncFile()
+		{
+#ifdef __APPLE__
+			fsync(_file);
+#else
+			fdatasync(_file);
+#endif
+			_hasUnsyncedData = false;
+			_lastSyncTime = std::chrono::steady_clock::now();
 		}
 #endif
 	}
-}
\ No newline at end of file
+}
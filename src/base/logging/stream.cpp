@@ -0,0 +1,428 @@
+#include <base/logging/stream.h>
+
+#include <base/logging/dispatcher/dispatcher.h>
+
+#include <fmt/format.h>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+
+namespace Base
+{
+	namespace Logging
+	{
+		namespace Details
+		{
+			class LoggingStreamBuffer : public std::streambuf
+			{
+			public:
+				explicit LoggingStreamBuffer(fmt::basic_memory_buffer<char, 4096>& buffer)
+					: _buffer(buffer) {}
+			protected:
+				int_type overflow(int_type character) override
+				{
+					if (!traits_type::eq_int_type(character, traits_type::eof()))
+						_buffer.push_back(traits_type::to_char_type(character));
+					return traits_type::not_eof(character);
+				}
+				std::streamsize xsputn(const char_type* string, std::streamsize count) override
+				{
+					_buffer.append(string, string + count);
+					return count;
+				}
+			private:
+				fmt::basic_memory_buffer<char, 4096>& _buffer;
+			};
+
+			struct LoggingOStream
+			{
+				explicit LoggingOStream(fmt::basic_memory_buffer<char, 4096>& buffer)
+					: streamBuffer(buffer), stream(&streamBuffer) {}
+				LoggingStreamBuffer streamBuffer;
+				std::ostream stream;
+			};
+
+			struct LoggingBuffer
+			{
+				fmt::basic_memory_buffer<char, 4096> buffer;
+				// created on first use only, most messages never need it
+				std::unique_ptr<LoggingOStream> oStream;
+			};
+
+			static const size_t maxPooledBufferCount = 8;
+			// buffers grown above this size are released instead of being kept by the thread
+			static const size_t maxPooledBufferCapacity = 64 * 1024;
+
+			// trivially destructible, so still usable by messages logged from other thread local destructors
+			static thread_local LoggingBuffer* t_freeBuffers[maxPooledBufferCount];
+			static thread_local size_t t_numberOfFreeBuffers = 0;
+			static thread_local bool t_bufferPoolReleased = false;
+
+			struct LoggingBufferPoolReleaser
+			{
+				~LoggingBufferPoolReleaser()
+				{
+					for (size_t index = 0; index < t_numberOfFreeBuffers; ++index)
+						delete t_freeBuffers[index];
+					t_numberOfFreeBuffers = 0;
+					t_bufferPoolReleased = true;
+				}
+			};
+
+			static thread_local LoggingBufferPoolReleaser t_bufferPoolReleaser;
+
+			static LoggingBuffer* acquireLoggingBuffer()
+			{
+				if (t_numberOfFreeBuffers != 0)
+					return t_freeBuffers[--t_numberOfFreeBuffers];
+				if (!t_bufferPoolReleased)
+					(void)&t_bufferPoolReleaser;
+				return new LoggingBuffer;
+			}
+
+			static void releaseLoggingBuffer(LoggingBuffer* buffer)
+			{
+				if (t_bufferPoolReleased || t_numberOfFreeBuffers == maxPooledBufferCount || buffer->buffer.capacity() > maxPooledBufferCapacity)
+				{
+					delete buffer;
+					return;
+				}
+				buffer->buffer.clear();
+				t_freeBuffers[t_numberOfFreeBuffers++] = buffer;
+			}
+
+			template <typename Type>
+			static void appendInteger(fmt::basic_memory_buffer<char, 4096>& buffer, Type value)
+			{
+				const fmt::format_int formatted(value);
+				buffer.append(formatted.data(), formatted.data() + formatted.size());
+			}
+
+			static void appendString(fmt::basic_memory_buffer<char, 4096>& buffer, std::string_view value)
+			{
+				buffer.append(value.data(), value.data() + value.size());
+			}
+
+			static void appendArgument(fmt::basic_memory_buffer<char, 4096>& buffer, LoggingArgumentType type, uint64_t value)
+			{
+				buffer.push_back(char(type));
+				appendVarint(buffer, value);
+			}
+
+			static void appendCharacterArgument(fmt::basic_memory_buffer<char, 4096>& buffer, LoggingArgumentType type, char value)
+			{
+				buffer.push_back(char(type));
+				buffer.push_back(value);
+			}
+
+			static void appendFloatingPointArgument(fmt::basic_memory_buffer<char, 4096>& buffer, double value)
+			{
+				buffer.push_back(char(LoggingArgumentType::FLOATING_POINT));
+				const char* bytes = reinterpret_cast<const char*>(&value);
+				buffer.append(bytes, bytes + sizeof(value));
+			}
+
+			static void appendStringArgument(fmt::basic_memory_buffer<char, 4096>& buffer, std::string_view value)
+			{
+				appendArgument(buffer, LoggingArgumentType::STRING, value.size());
+				appendString(buffer, value);
+			}
+
+			LoggingStream::LoggingStream()
+				: _buffer(acquireLoggingBuffer()), _useOStream(false), _record(g_dispatcher.isRecordOnly()), _hasSite(false),
+				_site(), _oStreamArgumentOffset(0)
+			{
+			}
+
+			LoggingStream::~LoggingStream()
+			{
+				releaseLoggingBuffer(_buffer);
+			}
+
+			LoggingStream& LoggingStream::operator<<(std::string_view value)
+			{
+				if (_record)
+					appendStringArgument(_buffer->buffer, value);
+				else
+					appendString(_buffer->buffer, value);
+				return *this;
+			}
+
+			LoggingStream& LoggingStream::writeString(const char* value)
+			{
+				if (value == nullptr)
+					return *this << std::string_view("(null)", 6);
+				return *this << std::string_view(value);
+			}
+
+			LoggingStream& LoggingStream::operator<<(const std::string& value)
+			{
+				return *this << std::string_view(value);
+			}
+
+			LoggingStream& LoggingStream::operator<<(char value)
+			{
+				if (_useOStream)
+				{
+					beginOStreamWrite() << value;
+					endOStreamWrite();
+				}
+				else if (_record)
+					appendCharacterArgument(_buffer->buffer, LoggingArgumentType::CHARACTER, value);
+				else
+					_buffer->buffer.push_back(value);
+				return *this;
+			}
+
+			LoggingStream& LoggingStream::operator<<(signed char value)
+			{
+				return *this << char(value);
+			}
+
+			LoggingStream& LoggingStream::operator<<(unsigned char value)
+			{
+				return *this << char(value);
+			}
+
+			LoggingStream& LoggingStream::operator<<(bool value)
+			{
+				if (_useOStream)
+				{
+					beginOStreamWrite() << value;
+					endOStreamWrite();
+				}
+				else if (_record)
+					appendCharacterArgument(_buffer->buffer, LoggingArgumentType::BOOLEAN, char(value));
+				else
+					_buffer->buffer.push_back(value ? '1' : '0');
+				return *this;
+			}
+
+#define _LOGGING_STREAM_INTEGER_OPERATOR(Type) \
+			LoggingStream& LoggingStream::operator<<(Type value) \
+			{ \
+				if (_useOStream) \
+				{ \
+					beginOStreamWrite() << value; \
+					endOStreamWrite(); \
+				} \
+				else if (_record) \
+				{ \
+					if (std::is_signed<Type>::value) \
+						appendArgument(_buffer->buffer, LoggingArgumentType::SIGNED_INTEGER, encodeZigzag(int64_t(value))); \
+					else \
+						appendArgument(_buffer->buffer, LoggingArgumentType::UNSIGNED_INTEGER, uint64_t(value)); \
+				} \
+				else \
+					appendInteger(_buffer->buffer, value); \
+				return *this; \
+			}
+
+			_LOGGING_STREAM_INTEGER_OPERATOR(short)
+			_LOGGING_STREAM_INTEGER_OPERATOR(unsigned short)
+			_LOGGING_STREAM_INTEGER_OPERATOR(int)
+			_LOGGING_STREAM_INTEGER_OPERATOR(unsigned int)
+			_LOGGING_STREAM_INTEGER_OPERATOR(long)
+			_LOGGING_STREAM_INTEGER_OPERATOR(unsigned long)
+			_LOGGING_STREAM_INTEGER_OPERATOR(long long)
+			_LOGGING_STREAM_INTEGER_OPERATOR(unsigned long long)
+
+#undef _LOGGING_STREAM_INTEGER_OPERATOR
+
+#define _LOGGING_STREAM_FLOATING_POINT_OPERATOR(Type) \
+			LoggingStream& LoggingStream::operator<<(Type value) \
+			{ \
+				if (_useOStream) \
+				{ \
+					beginOStreamWrite() << value; \
+					endOStreamWrite(); \
+				} \
+				else if (_record) \
+					appendFloatingPointArgument(_buffer->buffer, double(value)); \
+				else \
+					fmt::format_to(std::back_inserter(_buffer->buffer), "{:g}", value); \
+				return *this; \
+			}
+
+			// {:g} matches the default std::ostream representation (precision 6)
+			_LOGGING_STREAM_FLOATING_POINT_OPERATOR(float)
+			_LOGGING_STREAM_FLOATING_POINT_OPERATOR(double)
+			_LOGGING_STREAM_FLOATING_POINT_OPERATOR(long double)
+
+#undef _LOGGING_STREAM_FLOATING_POINT_OPERATOR
+
+			LoggingStream& LoggingStream::operator<<(const void* value)
+			{
+				if (_useOStream)
+				{
+					beginOStreamWrite() << value;
+					endOStreamWrite();
+				}
+				else if (_record)
+					appendArgument(_buffer->buffer, LoggingArgumentType::POINTER, uint64_t(reinterpret_cast<uintptr_t>(value)));
+				else
+					fmt::format_to(std::back_inserter(_buffer->buffer), "{}", value);
+				return *this;
+			}
+
+			LoggingStream& LoggingStream::operator<<(std::nullptr_t)
+			{
+				return *this << "nullptr";
+			}
+
+			void LoggingStream::setSite(const LoggingSite& site)
+			{
+				if (!_hasSite && _buffer->buffer.size() == 0)
+				{
+					_site = site;
+					_hasSite = true;
+				}
+				else
+				{
+					// not at the beginning of the message, kept as text
+					std::string text;
+					formatLoggingSite(site, text);
+					appendStringArgument(_buffer->buffer, text);
+				}
+			}
+
+			LoggingStream& LoggingStream::operator<<(const LoggingHeader& header)
+			{
+				if (_record)
+				{
+					setSite(LoggingSite{ LoggingSiteType::MESSAGE, header.file, header.line, header.function, {}, header.slot });
+					return *this;
+				}
+				auto& buffer = _buffer->buffer;
+				buffer.push_back('[');
+				appendString(buffer, header.file);
+				buffer.push_back(':');
+				appendInteger(buffer, header.line);
+				buffer.push_back(' ');
+				appendString(buffer, header.function);
+				appendString(buffer, "] ");
+				return *this;
+			}
+
+			LoggingStream& LoggingStream::operator<<(const LoggingCheckHeader& header)
+			{
+				if (_record)
+				{
+					setSite(LoggingSite{ LoggingSiteType::CHECK, header.header.file, header.header.line, header.header.function,
+						{ header.expression }, header.header.slot });
+					return *this;
+				}
+				*this << header.header;
+				appendString(_buffer->buffer, "Check failed: ");
+				appendString(_buffer->buffer, header.expression);
+				return *this;
+			}
+
+			LoggingStream& LoggingStream::operator<<(const LoggingBinaryCheckHeader& header)
+			{
+				if (_record)
+				{
+					setSite(LoggingSite{ LoggingSiteType::BINARY_CHECK, header.header.file, header.header.line, header.header.function,
+						{ header.leftExpression, header.op, header.rightExpression }, header.header.slot });
+					return *this;
+				}
+				auto& buffer = _buffer->buffer;
+				*this << header.header;
+				appendString(buffer, "Check failed: ");
+				appendString(buffer, header.leftExpression);
+				buffer.push_back(' ');
+				appendString(buffer, header.op);
+				buffer.push_back(' ');
+				appendString(buffer, header.rightExpression);
+				buffer.push_back(' ');
+				return *this;
+			}
+
+			LoggingStream& LoggingStream::operator<<(std::ostream& (*manipulator)(std::ostream&))
+			{
+				beginOStreamWrite() << manipulator;
+				endOStreamWrite();
+				return *this;
+			}
+
+			LoggingStream& LoggingStream::operator<<(std::ios_base& (*manipulator)(std::ios_base&))
+			{
+				beginOStreamWrite() << manipulator;
+				endOStreamWrite();
+				return *this;
+			}
+
+			std::ostream& LoggingStream::beginOStreamWrite()
+			{
+				auto& oStream = _buffer->oStream;
+				if (!oStream)
+					oStream = std::make_unique<LoggingOStream>(_buffer->buffer);
+				else if (!_useOStream)
+				{
+					// a previous message might have left a modified formatting state
+					oStream->stream.flags(std::ios_base::skipws | std::ios_base::dec);
+					oStream->stream.precision(6);
+					oStream->stream.width(0);
+					oStream->stream.fill(' ');
+					oStream->stream.clear();
+				}
+				// in record mode the formatted text becomes a string argument once its size is known
+				_oStreamArgumentOffset = _buffer->buffer.size();
+				return oStream->stream;
+			}
+
+			void LoggingStream::endOStreamWrite()
+			{
+				auto& buffer = _buffer->buffer;
+				if (_record && buffer.size() != _oStreamArgumentOffset)
+				{
+					struct
+					{
+						void push_back(char value) { data[size++] = value; }
+						char data[16];
+						size_t size = 0;
+					} prefix;
+					const size_t size = buffer.size() - _oStreamArgumentOffset;
+					prefix.push_back(char(LoggingArgumentType::STRING));
+					appendVarint(prefix, size);
+					buffer.resize(buffer.size() + prefix.size);
+					memmove(buffer.data() + _oStreamArgumentOffset + prefix.size, buffer.data() + _oStreamArgumentOffset, size);
+					memcpy(buffer.data() + _oStreamArgumentOffset, prefix.data, prefix.size);
+				}
+				if (_useOStream)
+					return;
+				const std::ostream& stream = _buffer->oStream->stream;
+				_useOStream = stream.flags() != (std::ios_base::skipws | std::ios_base::dec) ||
+					stream.precision() != 6 || stream.width() != 0 || stream.fill() != ' ';
+			}
+
+			bool LoggingStream::isRecord() const
+			{
+				return _record;
+			}
+
+			LoggingRecord LoggingStream::record() const
+			{
+				return LoggingRecord{ _hasSite ? &_site : nullptr, getLoggingTimestamp(), getLoggingThreadId(),
+					std::string_view(_buffer->buffer.data(), _buffer->buffer.size()) };
+			}
+
+			std::string_view LoggingStream::view() const
+			{
+				return std::string_view(_buffer->buffer.data(), _buffer->buffer.size());
+			}
+
+			std::string LoggingStream::str() const
+			{
+				if (_record)
+				{
+					std::string text;
+					formatLoggingRecord(record(), text);
+					return text;
+				}
+				return std::string(_buffer->buffer.data(), _buffer->buffer.size());
+			}
+		}
+	}
+}
@@ -0,0 +1,33 @@
+#include "pch.h"
+
+#include <base/ext/img_codecs/processing/transform.h>
+
+extern "C" {
+#include <libavutil/imgutils.h>
+}
+
+#include <vector>
+
+TEST(IMAGE_FORMAT_TRANSFORMER, BANDED)
+{
+	// the height is no multiple of the bands, which are no multiple of the dither period unless rounded
+	const uint32_t width = 157, height = 203;
+	std::vector<uint8_t> source(width * height * 3);
+	for (size_t index = 0; index < source.size(); ++index)
+		source[index] = (uint8_t)(index * 7 / 3 + index % 5 * 40);
+	Base::WorkStealingThreadPool threadPool(3);
+	for (AVPixelFormat format : { AV_PIX_FMT_RGB565, AV_PIX_FMT_RGB555, AV_PIX_FMT_RGB444, AV_PIX_FMT_MONOBLACK, AV_PIX_FMT_BGRA })
+		for (bool flip : { false, true })
+		{
+			const int size = av_image_get_buffer_size(format, int(width), int(height), 1);
+			ASSERT_GT(size, 0);
+			std::vector<uint8_t> reference(size);
+			std::vector<uint8_t> banded(size);
+			Base::ImageFormatTransformer transformer;
+			transformer.setNativeScalingEnabled(false);
+			transformer.transform(width, height, AV_PIX_FMT_RGB24, 0, 0, width, height, width, height, format, 0, 0, width, height, flip, source.data(), reference.data());
+			transformer.setThreadPool(&threadPool);
+			transformer.transform(width, height, AV_PIX_FMT_RGB24, 0, 0, width, height, width, height, format, 0, 0, width, height, flip, source.data(), banded.data());
+			EXPECT_EQ(banded, reference) << "format " << int(format) << (flip ? ", flipped" : "");
+		}
+}
@@ -0,0 +1,1112 @@
+#include "pch.h"
+
+#ifdef HAVE_LIB_JPEG
+#include <base/ext/img_codecs/batch_decoder.h>
+#include <base/ext/img_codecs/batch_encoder.h>
+#include <base/ext/img_codecs/encoder/jpeg.h>
+#include <base/ext/img_codecs/format_detection.h>
+#include <base/ext/img_codecs/jpeg_transformer.h>
+#include <base/ext/img_codecs/object_pool.h>
+#include <base/ext/img_codecs/pixel_format.h>
+#include <base/ext/img_codecs/processing/tensor.h>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <thread>
+#include <vector>
+
+// Encodes a width x height RGB image whose sample at index is pattern(index)
+static std::vector<unsigned char> encodeJPEG(unsigned width, unsigned height, const std::function<unsigned char(size_t index)>& pattern,
+	const Base::JPEGEncodeOptions& options = Base::JPEGEncodeOptions())
+{
+	std::vector<unsigned char> image(size_t(width) * height * 3);
+	for (size_t index = 0; index < image.size(); ++index)
+		image[index] = pattern(index);
+	Base::JPEGEncoder encoder;
+	encoder.setOptions(options);
+	auto encodedImage = encoder.encode(image.data(), width, height);
+	return std::vector<unsigned char>((unsigned char*)encodedImage.get(), (unsigned char*)encodedImage.get() + encodedImage.size());
+}
+
+static unsigned char getGradientSample(size_t index)
+{
+	return (unsigned char)(index * 7 / 3);
+}
+
+// x * 2 + y + channel * 20 at (x, y) of an image of width pixels
+static std::function<unsigned char(size_t index)> getRampPattern(unsigned width)
+{
+	return [width](size_t index)
+	{
+		const size_t pixel = index / 3;
+		return (unsigned char)(pixel % width * 2 + pixel / width + index % 3 * 20);
+	};
+}
+
+TEST(BATCH_IMAGE_DECODER, JPEG)
+{
+	const unsigned width = 96, height = 64;
+	const std::vector<unsigned char> jpegFile = encodeJPEG(width, height, getGradientSample);
+
+	Base::ImageDecoder decoder;
+	decoder.load(jpegFile.data(), jpegFile.size(), Base::ImageFormatType::JPEG);
+	const uint64_t decompressedSize = decoder.getDecompressedSize();
+	std::vector<unsigned char> reference(decompressedSize);
+	decoder.decode(reference.data());
+
+	const size_t numberOfImages = 64;
+	std::vector<std::vector<unsigned char>> outputs(numberOfImages, std::vector<unsigned char>(decompressedSize));
+	std::vector<Base::ImageDecodeJob> jobs(numberOfImages);
+	for (size_t index = 0; index < numberOfImages; ++index)
+		jobs[index] = { jpegFile.data(), jpegFile.size(), index % 2 ? Base::ImageFormatType::JPEG : Base::ImageFormatType::UNKNOWN, outputs[index].data(), decompressedSize };
+	// a truncated image and a too small output buffer fail without affecting the others
+	jobs[3].size = 64;
+	jobs[5].outputSize = decompressedSize - 1;
+
+	Base::BatchImageDecoder batchDecoder(4);
+	std::vector<Base::ImageDecodeResult> results;
+	const Base::BatchImageDecodeStatistics statistics = batchDecoder.decode(jobs, results);
+	EXPECT_EQ(statistics.numberOfImages, numberOfImages);
+	EXPECT_EQ(statistics.numberOfFailures, 2);
+	EXPECT_EQ(statistics.decompressedBytes, decompressedSize * (numberOfImages - 2));
+	for (size_t index = 0; index < numberOfImages; ++index)
+	{
+		if (index == 3 || index == 5)
+		{
+			EXPECT_FALSE(results[index].succeeded);
+			EXPECT_FALSE(results[index].error.empty());
+			continue;
+		}
+		EXPECT_TRUE(results[index].succeeded) << results[index].error;
+		EXPECT_EQ(results[index].width, width);
+		EXPECT_EQ(outputs[index], reference);
+	}
+	EXPECT_GT(statistics.getImagesPerSecond(), 0);
+}
+
+TEST(JPEG_ENCODER, OPTIONS_AND_BATCH)
+{
+	const unsigned width = 80, height = 48;
+	std::vector<unsigned char> image(width * height * 3);
+	for (size_t index = 0; index < image.size(); ++index)
+		image[index] = (unsigned char)(index * 5 / 7);
+
+	Base::JPEGEncoder encoder;
+	Base::JPEGEncodeOptions options;
+	options.quality = 95;
+	options.subsampling = Base::JPEGChromaSubsampling::YUV444;
+	options.optimizeCoding = true;
+	options.progressive = true;
+	encoder.setOptions(options);
+	std::vector<unsigned char> buffer(Base::JPEGEncoder::getMaximumEncodedSize(width, height));
+	const size_t size = encoder.encode(image.data(), width, height, buffer.data(), buffer.size());
+	auto encodedImage = encoder.encode(image.data(), width, height);
+	ASSERT_EQ(encodedImage.size(), size);
+	EXPECT_EQ(memcmp(encodedImage.get(), buffer.data(), size), 0);
+
+	Base::ImageDecoder decoder;
+	decoder.load(buffer.data(), size, Base::ImageFormatType::JPEG);
+	ASSERT_EQ(decoder.getWidth(), width);
+	std::vector<unsigned char> decoded(decoder.getDecompressedSize());
+	decoder.decode(decoded.data());
+	double error = 0;
+	for (size_t index = 0; index < image.size(); ++index)
+		error += std::abs(int(decoded[index]) - int(image[index]));
+	EXPECT_LT(error / image.size(), 4.);
+
+	// the encoder stays usable after running out of space
+	EXPECT_ANY_THROW(encoder.encode(image.data(), width, height, buffer.data(), size / 2));
+	EXPECT_EQ(encoder.encode(image.data(), width, height, buffer.data(), buffer.size()), size);
+
+	const size_t numberOfImages = 16;
+	std::vector<std::vector<unsigned char>> outputs(numberOfImages, std::vector<unsigned char>(buffer.size()));
+	std::vector<Base::JPEGEncodeJob> jobs(numberOfImages);
+	for (size_t index = 0; index < numberOfImages; ++index)
+		jobs[index] = { image.data(), width, height, outputs[index].data(), outputs[index].size() };
+	jobs[7].outputSize = 16;
+
+	Base::BatchJPEGEncoder batchEncoder(4);
+	batchEncoder.setOptions(options);
+	std::vector<Base::JPEGEncodeResult> results;
+	const Base::BatchJPEGEncodeStatistics statistics = batchEncoder.encode(jobs, results);
+	EXPECT_EQ(statistics.numberOfFailures, 1);
+	EXPECT_EQ(statistics.compressedBytes, size * (numberOfImages - 1));
+	for (size_t index = 0; index < numberOfImages; ++index)
+	{
+		if (index == 7)
+		{
+			EXPECT_FALSE(results[index].succeeded);
+			continue;
+		}
+		EXPECT_TRUE(results[index].succeeded) << results[index].error;
+		ASSERT_EQ(results[index].size, size);
+		EXPECT_EQ(memcmp(outputs[index].data(), buffer.data(), size), 0);
+	}
+	EXPECT_GT(statistics.getImagesPerSecond(), 0);
+}
+
+TEST(JPEG_TRANSFORMER, OPERATIONS)
+{
+	const unsigned width = 75, height = 53;
+	Base::JPEGEncodeOptions encodeOptions;
+	encodeOptions.quality = 90;
+	encodeOptions.subsampling = Base::JPEGChromaSubsampling::YUV444;
+	const std::vector<unsigned char> jpegFile = encodeJPEG(width, height, getRampPattern(width), encodeOptions);
+
+	Base::ImageDecoder decoder;
+	decoder.load(jpegFile.data(), jpegFile.size());
+	std::vector<unsigned char> reference(decoder.getDecompressedSize());
+	decoder.decode(reference.data());
+
+	struct Case
+	{
+		Base::JPEGTransformOptions options;
+		unsigned width, height;
+		// source pixel of the transformed pixel (x, y)
+		std::function<std::pair<unsigned, unsigned>(unsigned x, unsigned y)> source;
+	};
+	std::vector<Case> cases(5);
+	// the partial iMCU row at the bottom is dropped
+	cases[0].options.operation = Base::JPEGTransformOperation::ROTATE_90;
+	cases[0] = { cases[0].options, 48, 75, [](unsigned x, unsigned y) { return std::make_pair(y, 47 - x); } };
+	cases[1].options.operation = Base::JPEGTransformOperation::FLIP_HORIZONTAL;
+	cases[1] = { cases[1].options, 72, 53, [](unsigned x, unsigned y) { return std::make_pair(71 - x, y); } };
+	cases[2].options.operation = Base::JPEGTransformOperation::TRANSPOSE;
+	cases[2] = { cases[2].options, 53, 75, [](unsigned x, unsigned y) { return std::make_pair(y, x); } };
+	cases[3].options.operation = Base::JPEGTransformOperation::ROTATE_180;
+	cases[3] = { cases[3].options, 72, 48, [](unsigned x, unsigned y) { return std::make_pair(71 - x, 47 - y); } };
+	// the corner moves to (16, 8)
+	cases[4].options.cropX = 20;
+	cases[4].options.cropY = 10;
+	cases[4].options.cropWidth = 30;
+	cases[4].options.cropHeight = 20;
+	cases[4] = { cases[4].options, 34, 22, [](unsigned x, unsigned y) { return std::make_pair(16 + x, 8 + y); } };
+
+	Base::JPEGTransformer transformer;
+	for (const Case& testCase : cases)
+	{
+		auto transformedImage = transformer.transform(jpegFile.data(), jpegFile.size(), testCase.options);
+		EXPECT_EQ(transformer.getWidth(), testCase.width);
+		decoder.load(transformedImage.get(), transformedImage.size());
+		ASSERT_EQ(decoder.getWidth(), testCase.width);
+		ASSERT_EQ(decoder.getHeight(), testCase.height);
+		std::vector<unsigned char> transformed(decoder.getDecompressedSize());
+		decoder.decode(transformed.data());
+		// only the rounding of the inverse DCT differs
+		int maximumDifference = 0;
+		for (unsigned y = 0; y < testCase.height; ++y)
+			for (unsigned x = 0; x < testCase.width; ++x)
+			{
+				const auto source = testCase.source(x, y);
+				for (unsigned channel = 0; channel < 3; ++channel)
+					maximumDifference = std::max(maximumDifference, std::abs(int(transformed[(y * testCase.width + x) * 3 + channel]) - int(reference[(source.second * width + source.first) * 3 + channel])));
+			}
+		EXPECT_LE(maximumDifference, 1) << int(testCase.options.operation);
+	}
+
+	Base::JPEGTransformOptions perfectOptions;
+	perfectOptions.operation = Base::JPEGTransformOperation::ROTATE_270;
+	perfectOptions.perfect = true;
+	EXPECT_ANY_THROW((void)transformer.transform(jpegFile.data(), jpegFile.size(), perfectOptions));
+}
+
+TEST(JPEG_TRANSFORMER, YUV420_TRANSPOSING)
+{
+	const unsigned width = 75, height = 53;
+	Base::JPEGEncodeOptions encodeOptions;
+	encodeOptions.quality = 90;
+	encodeOptions.subsampling = Base::JPEGChromaSubsampling::YUV420;
+	std::vector<unsigned char> jpegFile = encodeJPEG(width, height, getRampPattern(width), encodeOptions);
+	// an APP1 segment with a little-endian IFD0 holding the orientation tag only, set to ROTATE_90, right after SOI
+	const unsigned char exif[] = { 0xFF, 0xE1, 0, 34, 'E', 'x', 'i', 'f', 0, 0, 'I', 'I', 0x2A, 0, 8, 0, 0, 0,
+		1, 0, 0x12, 0x01, 3, 0, 1, 0, 0, 0, 6, 0, 0, 0, 0, 0, 0, 0 };
+	jpegFile.insert(jpegFile.begin() + 2, exif, exif + sizeof(exif));
+	ASSERT_EQ(Base::getImageOrientation(jpegFile.data(), jpegFile.size()), Base::ImageOrientation::ROTATE_90);
+
+	Base::ImageDecoder decoder;
+	decoder.load(jpegFile.data(), jpegFile.size());
+	std::vector<unsigned char> reference(decoder.getDecompressedSize());
+	decoder.decode(reference.data());
+
+	struct Case
+	{
+		Base::JPEGTransformOperation operation;
+		unsigned width, height;
+		// source pixel of the transformed pixel (x, y)
+		std::function<std::pair<unsigned, unsigned>(unsigned x, unsigned y)> source;
+	};
+	// the iMCUs are 16 x 16 pixels, partial ones a flip moves into the image are dropped
+	const Case cases[] = {
+		{ Base::JPEGTransformOperation::ROTATE_90, 48, 75, [](unsigned x, unsigned y) { return std::make_pair(y, 47 - x); } },
+		{ Base::JPEGTransformOperation::TRANSVERSE, 48, 64, [](unsigned x, unsigned y) { return std::make_pair(63 - y, 47 - x); } }
+	};
+	Base::JPEGTransformer transformer;
+	for (const Case& testCase : cases)
+	{
+		Base::JPEGTransformOptions options;
+		options.operation = testCase.operation;
+		auto transformedImage = transformer.transform(jpegFile.data(), jpegFile.size(), options);
+		EXPECT_EQ(Base::getImageOrientation(transformedImage.get(), transformedImage.size()), Base::ImageOrientation::NORMAL);
+		decoder.load(transformedImage.get(), transformedImage.size());
+		ASSERT_EQ(decoder.getWidth(), testCase.width);
+		ASSERT_EQ(decoder.getHeight(), testCase.height);
+		std::vector<unsigned char> transformed(decoder.getDecompressedSize());
+		decoder.decode(transformed.data());
+		// the inverse DCT and the chroma upsampling round differently, the upsampling also replicates other edges
+		double error = 0;
+		for (unsigned y = 0; y < testCase.height; ++y)
+			for (unsigned x = 0; x < testCase.width; ++x)
+			{
+				const auto source = testCase.source(x, y);
+				for (unsigned channel = 0; channel < 3; ++channel)
+					error += std::abs(int(transformed[(y * testCase.width + x) * 3 + channel]) - int(reference[(source.second * width + source.first) * 3 + channel]));
+			}
+		EXPECT_LT(error / transformed.size(), 1.) << int(testCase.operation);
+
+		options.resetOrientation = false;
+		auto orientedImage = transformer.transform(jpegFile.data(), jpegFile.size(), options);
+		EXPECT_EQ(Base::getImageOrientation(orientedImage.get(), orientedImage.size()), Base::ImageOrientation::ROTATE_90);
+	}
+}
+
+TEST(IMAGE_DECODER, EXIF_ORIENTATION)
+{
+	const unsigned width = 40, height = 24;
+	std::vector<unsigned char> jpegFile = encodeJPEG(width, height, getGradientSample);
+
+	Base::ImageDecoder decoder;
+	decoder.load(jpegFile.data(), jpegFile.size());
+	std::vector<unsigned char> reference(decoder.getDecompressedSize());
+	decoder.decode(reference.data());
+
+	// an APP1 segment with a big-endian IFD0 holding the orientation tag only, right after SOI
+	const unsigned char exif[] = { 0xFF, 0xE1, 0, 34, 'E', 'x', 'i', 'f', 0, 0, 'M', 'M', 0, 0x2A, 0, 0, 0, 8,
+		0, 1, 0x01, 0x12, 0, 3, 0, 0, 0, 1, 0, 1, 0, 0, 0, 0, 0, 0 };
+	jpegFile.insert(jpegFile.begin() + 2, exif, exif + sizeof(exif));
+	const size_t orientationOffset = 2 + 29;
+
+	Base::ImageDecodeOptions options;
+	options.applyOrientation = true;
+	decoder.setOptions(options);
+	for (unsigned value = 1; value <= 8; ++value)
+	{
+		const auto orientation = Base::ImageOrientation(value);
+		jpegFile[orientationOffset] = (unsigned char)value;
+		EXPECT_EQ(Base::getImageOrientation(jpegFile.data(), jpegFile.size()), orientation);
+		decoder.load(jpegFile.data(), jpegFile.size());
+		ASSERT_EQ(decoder.getOrientation(), orientation);
+		const bool isTransposed = value >= 5;
+		const unsigned orientedWidth = isTransposed ? height : width, orientedHeight = isTransposed ? width : height;
+		ASSERT_EQ(decoder.getWidth(), orientedWidth);
+		ASSERT_EQ(decoder.getHeight(), orientedHeight);
+		std::vector<unsigned char> oriented(decoder.getDecompressedSize());
+		decoder.decode(oriented.data());
+		for (unsigned y = 0; y < height; ++y)
+			for (unsigned x = 0; x < width; ++x)
+			{
+				// the upright position of the stored pixel (x, y)
+				unsigned orientedX = isTransposed ? y : x, orientedY = isTransposed ? x : y;
+				if (value == 2 || value == 3 || value == 6 || value == 7)
+					orientedX = orientedWidth - 1 - orientedX;
+				if (value == 3 || value == 4 || value == 7 || value == 8)
+					orientedY = orientedHeight - 1 - orientedY;
+				ASSERT_EQ(memcmp(oriented.data() + (orientedY * orientedWidth + orientedX) * 3, reference.data() + (y * width + x) * 3, 3), 0)
+					<< "orientation " << value << ", pixel " << x << ", " << y;
+			}
+
+		const unsigned x = 3, y = 5, regionWidth = 11, regionHeight = 7;
+		std::vector<unsigned char> region(regionWidth * regionHeight * 3);
+		decoder.load(jpegFile.data(), jpegFile.size());
+		decoder.decodeRegion(x, y, regionWidth, regionHeight, region.data());
+		for (unsigned row = 0; row < regionHeight; ++row)
+			EXPECT_EQ(memcmp(region.data() + row * regionWidth * 3, oriented.data() + ((y + row) * orientedWidth + x) * 3, regionWidth * 3), 0)
+				<< "orientation " << value << ", row " << row;
+	}
+}
+
+TEST(IMAGE_DECODER_BACKEND_REGISTRY, JPEG_SELECTION)
+{
+	const unsigned width = 40, height = 24;
+	const std::vector<unsigned char> jpegFile = encodeJPEG(width, height, getGradientSample);
+
+	Base::ImageDecoderBackendRegistry& registry = Base::ImageDecoderBackendRegistry::getInstance();
+	const auto candidates = registry.getBackends(Base::ImageFormatType::JPEG);
+	ASSERT_FALSE(candidates->empty());
+	for (size_t index = 1; index < candidates->size(); ++index)
+		EXPECT_GE((*candidates)[index - 1]->priority, (*candidates)[index]->priority);
+#ifdef HAVE_LIB_JPEG_TURBO
+	EXPECT_EQ(candidates->front()->name, "turbojpeg");
+#else
+	EXPECT_EQ(candidates->front()->name, "libjpeg");
+#endif
+
+	Base::ImageDecoder decoder;
+	decoder.load(jpegFile.data(), jpegFile.size());
+	EXPECT_EQ(decoder.getBackendInfo().name, candidates->front()->name);
+	std::vector<unsigned char> reference(decoder.getDecompressedSize());
+	decoder.decode(reference.data());
+
+	// a copy of libjpeg preferred over the built-in backends
+	Base::ImageDecoderBackendInfo info = *registry.getBackend("libjpeg");
+	info.name = "preferred";
+	info.priority = 100;
+	registry.registerBackend(info);
+	EXPECT_EQ(registry.getBackends(Base::ImageFormatType::JPEG)->front()->name, "preferred");
+	// the list handed out before is not modified
+	EXPECT_EQ(candidates->front()->name, decoder.getBackendInfo().name);
+	decoder.load(jpegFile.data(), jpegFile.size());
+	EXPECT_EQ(decoder.getBackendInfo().name, "preferred");
+	std::vector<unsigned char> decoded(decoder.getDecompressedSize());
+	decoder.decode(decoded.data());
+	int maximumDifference = 0;
+	for (size_t index = 0; index < decoded.size(); ++index)
+		maximumDifference = std::max(maximumDifference, std::abs(int(decoded[index]) - int(reference[index])));
+	EXPECT_LE(maximumDifference, 1);
+
+	// registering the name again replaces the instance the decoder keeps for it
+	int numberOfCreatedBackends = 0;
+	const auto libjpegFactory = info.factory;
+	info.factory = [&numberOfCreatedBackends, libjpegFactory]() {
+		++numberOfCreatedBackends;
+		return libjpegFactory();
+	};
+	registry.registerBackend(info);
+	decoder.load(jpegFile.data(), jpegFile.size());
+	decoder.load(jpegFile.data(), jpegFile.size());
+	EXPECT_EQ(numberOfCreatedBackends, 1);
+	EXPECT_EQ(decoder.getBackendInfo().name, "preferred");
+
+	// the lowest priority
+	decoder.setBackendSelector([](Base::ImageFormatType, const void*, uint64_t, const Base::ImageDecoderBackendList& candidates) { return candidates.size() - 1; });
+	decoder.load(jpegFile.data(), jpegFile.size());
+	EXPECT_EQ(decoder.getBackendInfo().name, registry.getBackends(Base::ImageFormatType::JPEG)->back()->name);
+	decoder.setBackendSelector(nullptr);
+
+	decoder.setBackend(Base::ImageFormatType::JPEG, "libjpeg");
+	decoder.load(jpegFile.data(), jpegFile.size());
+	EXPECT_EQ(decoder.getBackendInfo().name, "libjpeg");
+	decoder.setBackend(Base::ImageFormatType::JPEG, "missing");
+	EXPECT_ANY_THROW(decoder.load(jpegFile.data(), jpegFile.size()));
+	decoder.setBackend(Base::ImageFormatType::JPEG, "");
+
+	registry.unregisterBackend("preferred");
+	EXPECT_EQ(registry.getBackend("preferred"), nullptr);
+	decoder.load(jpegFile.data(), jpegFile.size());
+	EXPECT_EQ(decoder.getBackendInfo().name, candidates->front()->name);
+}
+
+TEST(OBJECT_POOL, IMAGE_DECODER)
+{
+	const unsigned width = 32, height = 16;
+	const std::vector<unsigned char> jpegFile = encodeJPEG(width, height, [](size_t) { return (unsigned char)200; });
+
+	Base::ObjectPool<Base::ImageDecoder> decoderPool(2);
+	auto handle = decoderPool.acquire();
+	Base::ImageDecoder* decoder = handle.get();
+	handle->load(jpegFile.data(), jpegFile.size());
+	std::unique_ptr<Base::ImageDecoder> otherDecoder;
+	std::thread([&]() { otherDecoder = decoderPool.acquireObject(); }).join();
+	handle.reset();
+	std::thread([&]() { decoderPool.release(std::move(otherDecoder)); }).join();
+	{
+		// the thread gets the instance it released rather than the most recently released one
+		auto first = decoderPool.acquire(), second = decoderPool.acquire(), third = decoderPool.acquire();
+		EXPECT_EQ(first.get(), decoder);
+		first->load(jpegFile.data(), jpegFile.size());
+		EXPECT_EQ(first->getWidth(), width);
+	}
+	EXPECT_EQ(decoderPool.getSize(), 2);
+	EXPECT_EQ(decoderPool.getNumberOfHits(), 2);
+	EXPECT_EQ(decoderPool.getNumberOfMisses(), 3);
+
+	// the settings of one user do not carry over to the next
+	Base::ObjectPool<Base::JPEGEncoder> encoderPool(1);
+	{
+		auto configured = decoderPool.acquire();
+		configured->setOutputFormat(Base::PixelFormat::BGRA, 4);
+		configured->setBackend(Base::ImageFormatType::JPEG, "missing");
+		auto encoder = encoderPool.acquire();
+		Base::JPEGEncodeOptions options;
+		options.quality = 10;
+		encoder->setOptions(options);
+	}
+	{
+		auto reused = decoderPool.acquire();
+		EXPECT_EQ(reused->getOutputFormat(), Base::PixelFormat::RGB);
+		EXPECT_EQ(reused->getOptions().rowAlignment, 1);
+		reused->load(jpegFile.data(), jpegFile.size());
+		EXPECT_EQ(reused->getWidth(), width);
+		EXPECT_EQ(encoderPool.acquire()->getOptions().quality, Base::JPEGEncodeOptions().quality);
+	}
+	EXPECT_EQ(encoderPool.getSize(), 1);
+
+	// objects the resetter fails for are not kept
+	Base::ObjectPool<Base::ImageDecoder> failingPool(1, []() { return std::unique_ptr<Base::ImageDecoder>(new Base::ImageDecoder); },
+		[](Base::ImageDecoder&) { throw std::runtime_error("reset failed"); });
+	failingPool.acquire().reset();
+	EXPECT_EQ(failingPool.getSize(), 0);
+}
+
+TEST(JPEG_DECODER, SCALED)
+{
+	const unsigned width = 96, height = 64;
+	const std::vector<unsigned char> jpegFile = encodeJPEG(width, height, [](size_t) { return (unsigned char)128; });
+
+	Base::ImageDecoder decoder;
+	decoder.load(jpegFile.data(), jpegFile.size());
+	decoder.setTargetSize(20, 20);
+	// 3/8 is the smallest scale keeping both sides at least 20
+	EXPECT_EQ(decoder.getWidth(), 36);
+	EXPECT_EQ(decoder.getHeight(), 24);
+	std::vector<unsigned char> output(decoder.getDecompressedSize());
+	decoder.decode(output.data());
+	EXPECT_NEAR(output[output.size() / 2], 128, 2);
+
+	decoder.load(jpegFile.data(), jpegFile.size());
+	decoder.setTargetSize(1000, 1);
+	EXPECT_EQ(decoder.getWidth(), width);
+}
+
+TEST(JPEG_DECODER, REGION)
+{
+	const unsigned width = 160, height = 120;
+	const std::vector<unsigned char> jpegFile = encodeJPEG(width, height, getGradientSample);
+
+	Base::ImageDecoder decoder;
+	decoder.load(jpegFile.data(), jpegFile.size());
+	std::vector<unsigned char> reference(decoder.getDecompressedSize());
+	decoder.decode(reference.data());
+
+	const unsigned x = 37, y = 21, regionWidth = 50, regionHeight = 61;
+	decoder.load(jpegFile.data(), jpegFile.size());
+	std::vector<unsigned char> region(regionWidth * regionHeight * 3);
+	decoder.decodeRegion(x, y, regionWidth, regionHeight, region.data());
+	for (unsigned row = 0; row < regionHeight; ++row)
+		EXPECT_EQ(memcmp(region.data() + row * regionWidth * 3, reference.data() + ((y + row) * width + x) * 3, regionWidth * 3), 0) << "row " << row;
+	// the size of the image, not of the cropped columns
+	EXPECT_EQ(decoder.getWidth(), width);
+	EXPECT_EQ(decoder.getRowStride(), width * 3);
+	EXPECT_EQ(decoder.getDecompressedSize(), reference.size());
+}
+
+TEST(JPEG_DECODER, PIXEL_FORMATS)
+{
+	const unsigned width = 45, height = 30, rowAlignment = 64;
+	const std::vector<unsigned char> jpegFile = encodeJPEG(width, height, getGradientSample);
+
+	Base::ImageDecoder decoder;
+	decoder.load(jpegFile.data(), jpegFile.size());
+	std::vector<unsigned char> reference(decoder.getDecompressedSize());
+	decoder.decode(reference.data());
+
+	for (Base::PixelFormat format : { Base::PixelFormat::BGR, Base::PixelFormat::RGBA, Base::PixelFormat::BGRA, Base::PixelFormat::GRAY, Base::PixelFormat::RGB_PLANAR })
+	{
+		decoder.setOutputFormat(format, rowAlignment);
+		decoder.load(jpegFile.data(), jpegFile.size());
+		const size_t rowStride = decoder.getRowStride();
+		EXPECT_EQ(rowStride % rowAlignment, 0);
+		EXPECT_EQ(decoder.getDecompressedSize(), rowStride * height * Base::getNumberOfPlanes(format));
+		std::vector<unsigned char> output(decoder.getDecompressedSize());
+		decoder.decode(output.data());
+
+		std::vector<unsigned char> expected(output.size());
+		for (unsigned row = 0; row < height; ++row)
+			Base::convertRGBRow(reference.data() + row * width * 3, width, format, expected.data() + row * rowStride, rowStride * height);
+		const int tolerance = format == Base::PixelFormat::GRAY ? 2 : 0;
+		for (unsigned plane = 0; plane < Base::getNumberOfPlanes(format); ++plane)
+			for (unsigned row = 0; row < height; ++row)
+				for (size_t column = 0; column < width * Base::getPixelSize(format); ++column)
+				{
+					const size_t offset = (plane * height + row) * rowStride + column;
+					ASSERT_NEAR(output[offset], expected[offset], tolerance) << int(format) << " " << row << " " << column;
+				}
+	}
+}
+
+TEST(IMAGE_TENSOR_CONVERTER, JPEG)
+{
+	const unsigned width = 75, height = 50;
+	const std::vector<unsigned char> jpegFile = encodeJPEG(width, height, getGradientSample);
+
+	Base::ImageDecoder decoder;
+	decoder.load(jpegFile.data(), jpegFile.size());
+	std::vector<unsigned char> decoded(decoder.getDecompressedSize());
+	decoder.decode(decoded.data());
+
+	Base::ImageTensorOptions options;
+	options.width = 33;
+	options.height = 21;
+	options.mean[0] = 0.485f; options.mean[1] = 0.456f; options.mean[2] = 0.406f;
+	options.std[0] = 0.229f; options.std[1] = 0.224f; options.std[2] = 0.225f;
+	// reference bilinear interpolation with aligned pixel centers
+	auto getSourcePosition = [](unsigned index, unsigned size, unsigned sourceSize, unsigned& first, unsigned& second, double& weight)
+	{
+		const double position = std::min(std::max((index + 0.5) * sourceSize / size - 0.5, 0.), double(sourceSize - 1));
+		first = unsigned(position);
+		second = std::min(first + 1, sourceSize - 1);
+		weight = position - first;
+	};
+
+	for (Base::TensorLayout layout : { Base::TensorLayout::CHW, Base::TensorLayout::HWC })
+		for (Base::TensorDataType dataType : { Base::TensorDataType::FLOAT32, Base::TensorDataType::FLOAT16 })
+		{
+			options.layout = layout;
+			options.dataType = dataType;
+			Base::ImageTensorConverter converter(options);
+			std::vector<unsigned char> tensor(converter.getTensorSize());
+			decoder.load(jpegFile.data(), jpegFile.size());
+			decoder.decode(converter, tensor.data());
+			EXPECT_TRUE(converter.isComplete());
+
+			for (unsigned row = 0; row < options.height; ++row)
+			{
+				unsigned top, bottom;
+				double rowWeight;
+				getSourcePosition(row, options.height, height, top, bottom, rowWeight);
+				for (unsigned column = 0; column < options.width; ++column)
+				{
+					unsigned left, right;
+					double columnWeight;
+					getSourcePosition(column, options.width, width, left, right, columnWeight);
+					for (unsigned channel = 0; channel < 3; ++channel)
+					{
+						auto pixel = [&](unsigned y, unsigned x) { return double(decoded[(y * width + x) * 3 + channel]); };
+						const double upper = pixel(top, left) + (pixel(top, right) - pixel(top, left)) * columnWeight;
+						const double lower = pixel(bottom, left) + (pixel(bottom, right) - pixel(bottom, left)) * columnWeight;
+						const double expected = ((upper + (lower - upper) * rowWeight) / 255 - options.mean[channel]) / options.std[channel];
+						const size_t index = layout == Base::TensorLayout::CHW ? (channel * options.height + row) * options.width + column : (row * options.width + column) * 3 + channel;
+						if (dataType == Base::TensorDataType::FLOAT32)
+							ASSERT_NEAR(((const float*)tensor.data())[index], expected, 1e-4) << row << " " << column;
+						else
+						{
+							// positive normal halves keep 10 mantissa bits
+							const uint16_t half = ((const uint16_t*)tensor.data())[index];
+							const double magnitude = std::ldexp(1. + (half & 0x3FF) / 1024., ((half >> 10) & 0x1F) - 15);
+							ASSERT_NEAR((half & 0x8000) ? -magnitude : magnitude, expected, std::abs(expected) / 1024 + 1e-3) << row << " " << column;
+						}
+					}
+				}
+			}
+		}
+}
+#endif
+
+#ifdef HAVE_LIB_PNG
+#include <base/ext/img_codecs/decoder.h>
+#include <base/ext/img_codecs/pixel_format.h>
+#include <png.h>
+
+TEST(PNG_DECODER, PIXEL_FORMATS)
+{
+	const unsigned width = 7, height = 5;
+	std::vector<unsigned char> image(width * height * 4);
+	for (size_t index = 0; index < image.size(); ++index)
+		image[index] = (unsigned char)(index * 11);
+	png_image pngImage;
+	memset(&pngImage, 0, sizeof(pngImage));
+	pngImage.version = PNG_IMAGE_VERSION;
+	pngImage.width = width;
+	pngImage.height = height;
+	pngImage.format = PNG_FORMAT_RGBA;
+	png_alloc_size_t encodedSize = 0;
+	ASSERT_TRUE(png_image_write_to_memory(&pngImage, nullptr, &encodedSize, 0, image.data(), 0, nullptr));
+	std::vector<unsigned char> encodedImage(encodedSize);
+	ASSERT_TRUE(png_image_write_to_memory(&pngImage, encodedImage.data(), &encodedSize, 0, image.data(), 0, nullptr));
+
+	Base::ImageDecoder decoder;
+	for (Base::PixelFormat format : { Base::PixelFormat::RGBA, Base::PixelFormat::BGRA, Base::PixelFormat::RGB, Base::PixelFormat::BGR, Base::PixelFormat::RGB_PLANAR })
+	{
+		decoder.setOutputFormat(format, 16);
+		decoder.load(encodedImage.data(), encodedImage.size());
+		const size_t rowStride = decoder.getRowStride();
+		EXPECT_EQ(rowStride, format == Base::PixelFormat::RGB_PLANAR ? 16 : 32);
+		std::vector<unsigned char> output(decoder.getDecompressedSize());
+		decoder.decode(output.data());
+		for (unsigned row = 0; row < height; ++row)
+			for (unsigned column = 0; column < width; ++column)
+			{
+				const unsigned char* rgba = image.data() + (row * width + column) * 4;
+				const unsigned char* pixel = output.data() + row * rowStride + column * Base::getPixelSize(format);
+				switch (format)
+				{
+				case Base::PixelFormat::RGBA:
+					EXPECT_EQ(memcmp(pixel, rgba, 4), 0);
+					break;
+				case Base::PixelFormat::BGRA:
+					EXPECT_TRUE(pixel[0] == rgba[2] && pixel[1] == rgba[1] && pixel[2] == rgba[0] && pixel[3] == rgba[3]);
+					break;
+				case Base::PixelFormat::RGB:
+					EXPECT_EQ(memcmp(pixel, rgba, 3), 0);
+					break;
+				case Base::PixelFormat::BGR:
+					EXPECT_TRUE(pixel[0] == rgba[2] && pixel[1] == rgba[1] && pixel[2] == rgba[0]);
+					break;
+				default:
+					EXPECT_TRUE(pixel[0] == rgba[0] && pixel[rowStride * height] == rgba[1] && pixel[rowStride * height * 2] == rgba[2]);
+					break;
+				}
+			}
+	}
+}
+
+static std::vector<unsigned char> encodePNG(const unsigned char* samples, unsigned width, unsigned height, bool interlaced, int colorType = PNG_COLOR_TYPE_RGB, int bitDepth = 8)
+{
+	std::vector<unsigned char> encodedImage;
+	png_structp png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+	png_infop info_ptr = png_create_info_struct(png_ptr);
+	png_set_write_fn(png_ptr, &encodedImage, [](png_structp png_ptr, png_bytep data, png_size_t length)
+	{
+		std::vector<unsigned char>* encodedImage = (std::vector<unsigned char>*)png_get_io_ptr(png_ptr);
+		encodedImage->insert(encodedImage->end(), data, data + length);
+	}, nullptr);
+	png_set_IHDR(png_ptr, info_ptr, width, height, bitDepth, colorType, interlaced ? PNG_INTERLACE_ADAM7 : PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	std::vector<png_bytep> rows(height);
+	for (unsigned row = 0; row < height; ++row)
+		rows[row] = (png_bytep)samples + png_get_rowbytes(png_ptr, info_ptr) * row;
+	png_set_rows(png_ptr, info_ptr, rows.data());
+	png_write_png(png_ptr, info_ptr, PNG_TRANSFORM_IDENTITY, nullptr);
+	png_destroy_write_struct(&png_ptr, &info_ptr);
+	return encodedImage;
+}
+
+TEST(PNG_STREAM_DECODER, CHUNKS)
+{
+	const unsigned width = 61, height = 43;
+	std::vector<unsigned char> image(width * height * 3);
+	for (size_t index = 0; index < image.size(); ++index)
+		image[index] = (unsigned char)(index * 13 + index / 97);
+	Base::PNGStreamDecoder decoder;
+	decoder.setOutputFormat(Base::PixelFormat::BGR);
+	for (bool interlaced : { false, true })
+	{
+		const std::vector<unsigned char> encodedImage = encodePNG(image.data(), width, height, interlaced);
+		unsigned nextRow = 0;
+		decoder.reset();
+		decoder.setRowFunction([&](unsigned row, const unsigned char* data)
+		{
+			EXPECT_EQ(row, nextRow++);
+			for (unsigned column = 0; column < width; ++column)
+			{
+				const unsigned char* rgb = image.data() + (size_t(row) * width + column) * 3;
+				EXPECT_TRUE(data[column * 3] == rgb[2] && data[column * 3 + 1] == rgb[1] && data[column * 3 + 2] == rgb[0]);
+			}
+		});
+		for (size_t offset = 0; offset < encodedImage.size(); offset += 100)
+		{
+			EXPECT_FALSE(decoder.isComplete());
+			decoder.feed(encodedImage.data() + offset, std::min<size_t>(100, encodedImage.size() - offset));
+		}
+		EXPECT_TRUE(decoder.isHeaderComplete());
+		EXPECT_TRUE(decoder.isComplete());
+		EXPECT_EQ(decoder.getWidth(), width);
+		EXPECT_EQ(nextRow, height);
+	}
+}
+
+TEST(PNG_DECODER, INTERLACED_AND_TRUNCATED)
+{
+	const unsigned width = 29, height = 17;
+	std::vector<unsigned char> image(width * height * 3);
+	for (size_t index = 0; index < image.size(); ++index)
+		image[index] = (unsigned char)(index * 5 + index / 31);
+	Base::PNGDecoder decoder;
+	for (bool interlaced : { false, true })
+	{
+		std::vector<unsigned char> encodedImage = encodePNG(image.data(), width, height, interlaced);
+		decoder.load(encodedImage.data(), encodedImage.size());
+		std::vector<unsigned char> output(decoder.getDecompressedSize());
+		decoder.decode(output.data());
+		EXPECT_EQ(output, image);
+
+		decoder.setOutputFormat(Base::PixelFormat::RGB_PLANAR);
+		decoder.load(encodedImage.data(), encodedImage.size());
+		decoder.decode(output.data());
+		EXPECT_TRUE(output[0] == image[0] && output[width * height] == image[1] && output[width * height * 2 + 1] == image[5]);
+		decoder.setOutputFormat(Base::PixelFormat::RGB);
+
+		// ends within the IDAT chunk
+		decoder.load(encodedImage.data(), encodedImage.size() - 40);
+		EXPECT_ANY_THROW(decoder.decode(output.data()));
+		EXPECT_ANY_THROW(decoder.load(encodedImage.data(), 40));
+	}
+}
+
+TEST(PNG_DECODER, PRESERVE_16_BIT)
+{
+	const unsigned width = 9, height = 6;
+	// big-endian gray and alpha samples
+	std::vector<unsigned char> image(width * height * 4);
+	for (size_t index = 0; index < image.size(); ++index)
+		image[index] = (unsigned char)(index * 37 + 3);
+	const std::vector<unsigned char> encodedImage = encodePNG(image.data(), width, height, false, PNG_COLOR_TYPE_GRAY_ALPHA, 16);
+	Base::ImageDecodeOptions options;
+	options.preserve16Bit = true;
+	Base::ImageDecoder decoder;
+	for (Base::PixelFormat format : { Base::PixelFormat::GRAY, Base::PixelFormat::RGBA })
+	{
+		options.format = format;
+		decoder.setOptions(options);
+		decoder.load(encodedImage.data(), encodedImage.size());
+		ASSERT_EQ(decoder.getBytesPerChannel(), 2);
+		EXPECT_EQ(decoder.getRowStride(), width * Base::getPixelSize(format) * 2);
+		std::vector<uint16_t> output(decoder.getDecompressedSize() / 2);
+		decoder.decode(output.data());
+		for (unsigned pixel = 0; pixel < width * height; ++pixel)
+		{
+			const uint16_t gray = uint16_t(image[pixel * 4] << 8 | image[pixel * 4 + 1]), alpha = uint16_t(image[pixel * 4 + 2] << 8 | image[pixel * 4 + 3]);
+			if (format == Base::PixelFormat::GRAY)
+				EXPECT_EQ(output[pixel], gray);
+			else
+				EXPECT_TRUE(output[pixel * 4] == gray && output[pixel * 4 + 1] == gray && output[pixel * 4 + 2] == gray && output[pixel * 4 + 3] == alpha);
+		}
+	}
+	options.preserve16Bit = false;
+	decoder.setOptions(options);
+	decoder.load(encodedImage.data(), encodedImage.size());
+	EXPECT_EQ(decoder.getBytesPerChannel(), 1);
+	EXPECT_EQ(decoder.getDecompressedSize(), width * height * 4);
+}
+
+// decodes every image to a 2x2 RGB image of a constant value
+class ConstantImageDecoderBackend : public Base::ImageDecoderBackend
+{
+public:
+	void setOptions(const Base::ImageDecodeOptions&) override {}
+	void load(const void*, uint64_t) override {}
+	unsigned getWidth() const override { return 2; }
+	unsigned getHeight() const override { return 2; }
+	uint64_t getDecompressedSize() const override { return 12; }
+	Base::PixelFormat getOutputFormat() const override { return Base::PixelFormat::RGB; }
+	size_t getRowStride() const override { return 6; }
+	void decode(void* buffer) override { memset(buffer, 7, 12); }
+};
+
+TEST(IMAGE_DECODER_BACKEND_REGISTRY, SELECTION)
+{
+	Base::ImageDecoderBackendRegistry& registry = Base::ImageDecoderBackendRegistry::getInstance();
+	ASSERT_FALSE(registry.getBackends(Base::ImageFormatType::PNG)->empty());
+	EXPECT_EQ(registry.getBackends(Base::ImageFormatType::PNG)->front()->name, "libpng");
+	Base::ImageDecoderBackendInfo info;
+	info.name = "constant";
+	info.format = Base::ImageFormatType::PNG;
+	info.priority = -1;
+	info.factory = []() { return std::unique_ptr<Base::ImageDecoderBackend>(new ConstantImageDecoderBackend); };
+	registry.registerBackend(info);
+
+	const unsigned char image[4 * 3] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12 };
+	const std::vector<unsigned char> encodedImage = encodePNG(image, 2, 2, false);
+	Base::ImageDecoder decoder;
+	decoder.load(encodedImage.data(), encodedImage.size());
+	EXPECT_EQ(decoder.getBackendInfo().name, "libpng");
+	unsigned char output[12];
+	decoder.decode(output);
+	EXPECT_EQ(memcmp(output, image, 12), 0);
+
+	decoder.setBackend(Base::ImageFormatType::PNG, "constant");
+	decoder.load(encodedImage.data(), encodedImage.size());
+	EXPECT_EQ(decoder.getBackendInfo().name, "constant");
+	decoder.decode(output);
+	EXPECT_EQ(output[11], 7);
+
+	// small images to the last candidate
+	decoder.setBackend(Base::ImageFormatType::PNG, "");
+	decoder.setBackendSelector([](Base::ImageFormatType, const void*, uint64_t size, const Base::ImageDecoderBackendList& candidates)
+	{
+		return size < 1024 ? candidates.size() - 1 : 0;
+	});
+	decoder.load(encodedImage.data(), encodedImage.size());
+	EXPECT_EQ(decoder.getBackendInfo().name, "constant");
+
+	registry.unregisterBackend("constant");
+	decoder.load(encodedImage.data(), encodedImage.size());
+	EXPECT_EQ(decoder.getBackendInfo().name, "libpng");
+}
+#endif
+
+#ifdef HAVE_LIB_WEBP
+#include <base/ext/img_codecs/decoder/webp.h>
+#include <base/ext/img_codecs/encoder/webp.h>
+
+static Base::WebPEncoder::WebPImageContainer encodeWebP(const std::vector<unsigned char>& image, unsigned width, unsigned height, bool lossless)
+{
+	Base::WebPEncoder encoder;
+	Base::WebPEncodeOptions options;
+	options.lossless = lossless;
+	options.quality = 90;
+	encoder.setOptions(options);
+	return encoder.encode(image.data(), width, height);
+}
+
+TEST(WEBP_DECODER, SCALED)
+{
+	const unsigned width = 96, height = 64;
+	const std::vector<unsigned char> image(width * height * 3, 128);
+	auto encodedImage = encodeWebP(image, width, height, true);
+
+	Base::WebPDecoder decoder;
+	decoder.load(encodedImage.get(), encodedImage.size());
+	decoder.setTargetSize(20, 20);
+	EXPECT_EQ(decoder.getWidth(), 30);
+	EXPECT_EQ(decoder.getHeight(), 20);
+	std::vector<unsigned char> output(decoder.getDecompressedSize());
+	decoder.decode(output.data());
+	EXPECT_EQ(*std::min_element(output.begin(), output.end()), 128);
+	EXPECT_EQ(*std::max_element(output.begin(), output.end()), 128);
+
+	decoder.setTargetSize(1000, 1);
+	EXPECT_EQ(decoder.getWidth(), width);
+	EXPECT_EQ(decoder.getHeight(), height);
+}
+
+TEST(WEBP_DECODER, REGION)
+{
+	const unsigned width = 160, height = 120;
+	std::vector<unsigned char> image(width * height * 3);
+	for (size_t index = 0; index < image.size(); ++index)
+		image[index] = (unsigned char)(index * 7 / 3);
+	for (bool lossless : { true, false })
+	{
+		auto encodedImage = encodeWebP(image, width, height, lossless);
+		Base::WebPDecoder decoder;
+		decoder.load(encodedImage.get(), encodedImage.size());
+		decoder.setOutputFormat(Base::PixelFormat::BGRA);
+		std::vector<unsigned char> reference(decoder.getDecompressedSize());
+		decoder.decode(reference.data());
+		if (lossless)
+		{
+			EXPECT_TRUE(reference[0] == image[2] && reference[1] == image[1] && reference[2] == image[0] && reference[3] == 255);
+		}
+
+		// odd coordinates are cropped from the even ones libwebp decodes, lossy regions match the upsampled chroma too
+		const unsigned x = 37, y = 21, regionWidth = 51, regionHeight = 61;
+		std::vector<unsigned char> region(regionWidth * regionHeight * 4);
+		decoder.decodeRegion(x, y, regionWidth, regionHeight, region.data());
+		for (unsigned row = 0; row < regionHeight; ++row)
+			EXPECT_EQ(memcmp(region.data() + row * regionWidth * 4, reference.data() + ((y + row) * width + x) * 4, regionWidth * 4), 0) << "row " << row << (lossless ? " lossless" : " lossy");
+	}
+}
+
+TEST(WEBP_DECODER, YUV420)
+{
+	// odd sizes round the chroma planes up
+	const unsigned width = 37, height = 21;
+	std::vector<unsigned char> image(width * height * 3);
+	for (size_t index = 0; index < image.size(); index += 3)
+	{
+		image[index] = 200;
+		image[index + 1] = 100;
+		image[index + 2] = 50;
+	}
+	auto encodedImage = encodeWebP(image, width, height, false);
+
+	Base::WebPDecoder decoder;
+	decoder.load(encodedImage.get(), encodedImage.size());
+	const unsigned yStride = 40, uvStride = 24, chromaHeight = 11;
+	std::vector<unsigned char> y(yStride * height, 0), u(uvStride * chromaHeight, 0), v(uvStride * chromaHeight, 0);
+	Base::YUV420Planes planes{ y.data(), u.data(), v.data(), yStride, uvStride };
+	decoder.decodeYUV420(planes);
+	// BT.601 studio range of the color
+	for (unsigned row = 0; row < height; ++row)
+		for (unsigned column = 0; column < width; ++column)
+			EXPECT_NEAR(y[row * yStride + column], 123, 3);
+	for (unsigned row = 0; row < chromaHeight; ++row)
+		for (unsigned column = 0; column < 19; ++column)
+		{
+			EXPECT_NEAR(u[row * uvStride + column], 91, 3);
+			EXPECT_NEAR(v[row * uvStride + column], 176, 3);
+		}
+	// the padding is not written
+	EXPECT_EQ(y[yStride - 1], 0);
+	EXPECT_EQ(u[uvStride - 1], 0);
+}
+
+TEST(WEBP_STREAM_DECODER, CHUNKS)
+{
+	const unsigned width = 61, height = 43;
+	std::vector<unsigned char> image(width * height * 3);
+	for (size_t index = 0; index < image.size(); ++index)
+		image[index] = (unsigned char)(index * 13 + index / 97);
+	auto encodedImage = encodeWebP(image, width, height, true);
+
+	// the format set before the first feed applies to the first image too
+	Base::WebPStreamDecoder decoder;
+	for (Base::PixelFormat format : { Base::PixelFormat::BGRA, Base::PixelFormat::RGB, Base::PixelFormat::GRAY })
+	{
+		decoder.reset();
+		decoder.setOutputFormat(format);
+		EXPECT_EQ(decoder.getOutputFormat(), format);
+		unsigned nextRow = 0;
+		decoder.setRowFunction([&](unsigned row, const unsigned char* data)
+		{
+			EXPECT_EQ(row, nextRow++);
+			for (unsigned column = 0; column < width; ++column)
+			{
+				const unsigned char* rgb = image.data() + (size_t(row) * width + column) * 3;
+				if (format == Base::PixelFormat::BGRA)
+				{
+					EXPECT_TRUE(data[column * 4] == rgb[2] && data[column * 4 + 1] == rgb[1] && data[column * 4 + 2] == rgb[0] && data[column * 4 + 3] == 255);
+				}
+				else if (format == Base::PixelFormat::RGB)
+				{
+					EXPECT_EQ(memcmp(data + column * 3, rgb, 3), 0);
+				}
+				else
+				{
+					EXPECT_NEAR(data[column], (rgb[0] * 299 + rgb[1] * 587 + rgb[2] * 114) / 1000, 1);
+				}
+			}
+		});
+		for (size_t offset = 0; offset < encodedImage.size(); offset += 100)
+		{
+			EXPECT_FALSE(decoder.isComplete());
+			decoder.feed((const unsigned char*)encodedImage.get() + offset, std::min<size_t>(100, encodedImage.size() - offset));
+			// fixed for the image once it is started
+			decoder.setOutputFormat(Base::PixelFormat::RGBA);
+			EXPECT_EQ(decoder.getOutputFormat(), format);
+		}
+		EXPECT_TRUE(decoder.isHeaderComplete());
+		EXPECT_TRUE(decoder.isComplete());
+		EXPECT_EQ(decoder.getWidth(), width);
+		EXPECT_EQ(nextRow, height);
+	}
+}
+#endif
+
+#include <base/ext/img_codecs/processing/scaler.h>
+#include <base/ext/img_codecs/thread_pool.h>
+
+TEST(IMAGE_SCALER, CONVERT_AND_RESIZE)
+{
+	const unsigned width = 37, height = 23;
+	std::vector<uint8_t> rgb(width * height * 3);
+	for (size_t index = 0; index < rgb.size(); ++index)
+		rgb[index] = (uint8_t)(index * 7 / 3 + index % 5 * 40);
+	Base::ImageScaler scaler;
+	const Base::ScalerImage source = Base::getScalerImage(Base::ScalerPixelFormat::RGB24, width, height, rgb.data());
+
+	// conversion and flip only
+	std::vector<uint8_t> bgra(width * height * 4);
+	scaler.scale(source, Base::getScalerImage(Base::ScalerPixelFormat::BGRA, width, height, bgra.data()), true);
+	for (unsigned row = 0; row < height; ++row)
+		for (unsigned column = 0; column < width; ++column)
+		{
+			const uint8_t* pixel = bgra.data() + ((height - 1 - row) * width + column) * 4;
+			const uint8_t* expected = rgb.data() + (row * width + column) * 3;
+			ASSERT_TRUE(pixel[0] == expected[2] && pixel[1] == expected[1] && pixel[2] == expected[0] && pixel[3] == 0xFF);
+		}
+
+	// BT.601 limited range of a flat I420 image
+	std::vector<uint8_t> i420(width * height + 2 * ((width + 1) / 2) * ((height + 1) / 2));
+	memset(i420.data(), 81, width * height);
+	memset(i420.data() + width * height, 90, i420.size() - width * height);
+	std::vector<uint8_t> converted(width * height * 3);
+	scaler.scale(Base::getScalerImage(Base::ScalerPixelFormat::I420, width, height, i420.data()), Base::getScalerImage(Base::ScalerPixelFormat::RGB24, width, height, converted.data()));
+	EXPECT_NEAR(converted[0], 15, 1);
+	EXPECT_NEAR(converted[1], 121, 1);
+	EXPECT_NEAR(converted[2], 0, 1);
+
+	// bilinear against a floating point reference
+	const unsigned scaledWidth = 60, scaledHeight = 11;
+	std::vector<uint8_t> scaled(scaledWidth * scaledHeight * 3);
+	scaler.scale(source, Base::getScalerImage(Base::ScalerPixelFormat::RGB24, scaledWidth, scaledHeight, scaled.data()));
+	auto getSourcePosition = [](unsigned index, unsigned size, unsigned sourceSize, unsigned& first, unsigned& second, double& weight)
+	{
+		const double position = std::min(std::max((index + 0.5) * sourceSize / size - 0.5, 0.), double(sourceSize - 1));
+		first = unsigned(position);
+		second = std::min(first + 1, sourceSize - 1);
+		weight = position - first;
+	};
+	for (unsigned row = 0; row < scaledHeight; ++row)
+		for (unsigned column = 0; column < scaledWidth; ++column)
+			for (unsigned channel = 0; channel < 3; ++channel)
+			{
+				unsigned top, bottom, left, right;
+				double rowWeight, columnWeight;
+				getSourcePosition(row, scaledHeight, height, top, bottom, rowWeight);
+				getSourcePosition(column, scaledWidth, width, left, right, columnWeight);
+				auto pixel = [&](unsigned y, unsigned x) { return double(rgb[(y * width + x) * 3 + channel]); };
+				const double upper = pixel(top, left) + (pixel(top, right) - pixel(top, left)) * columnWeight;
+				const double lower = pixel(bottom, left) + (pixel(bottom, right) - pixel(bottom, left)) * columnWeight;
+				ASSERT_NEAR(scaled[(row * scaledWidth + column) * 3 + channel], upper + (lower - upper) * rowWeight, 1.) << row << " " << column;
+			}
+
+	// halving by area averages 2x2 blocks
+	scaler.setResizeMethod(Base::ImageResizeMethod::AREA);
+	std::vector<uint8_t> halved((width / 2) * (height / 2) * 3);
+	const Base::ScalerImage evenSource = { Base::ScalerPixelFormat::RGB24, width / 2 * 2, height / 2 * 2, { rgb.data() }, { width * 3 } };
+	scaler.scale(evenSource, Base::getScalerImage(Base::ScalerPixelFormat::RGB24, width / 2, height / 2, halved.data()));
+	for (unsigned row = 0; row < height / 2; ++row)
+		for (unsigned column = 0; column < width / 2; ++column)
+			for (unsigned channel = 0; channel < 3; ++channel)
+			{
+				auto pixel = [&](unsigned y, unsigned x) { return unsigned(rgb[(y * width + x) * 3 + channel]); };
+				const unsigned sum = pixel(row * 2, column * 2) + pixel(row * 2, column * 2 + 1) + pixel(row * 2 + 1, column * 2) + pixel(row * 2 + 1, column * 2 + 1);
+				ASSERT_EQ(halved[(row * (width / 2) + column) * 3 + channel], (sum + 2) / 4) << row << " " << column;
+			}
+}
+
+// timings are reported by apps/image_scaler_benchmark
+TEST(IMAGE_SCALER, PARALLEL)
+{
+	const unsigned width = 1280, height = 720, scaledWidth = 853, scaledHeight = 480;
+	std::vector<uint8_t> image(width * height * 4);
+	for (size_t index = 0; index < image.size(); ++index)
+		image[index] = (uint8_t)(index * 7 / 3 + index % 5 * 40);
+	const Base::ScalerImage source = Base::getScalerImage(Base::ScalerPixelFormat::RGBA, width, height, image.data());
+	for (Base::ImageResizeMethod method : { Base::ImageResizeMethod::BILINEAR, Base::ImageResizeMethod::AREA })
+	{
+		Base::ImageScaler scaler;
+		scaler.setResizeMethod(method);
+		std::vector<uint8_t> reference(scaledWidth * scaledHeight * 3);
+		scaler.scale(source, Base::getScalerImage(Base::ScalerPixelFormat::BGR24, scaledWidth, scaledHeight, reference.data()), true);
+		for (unsigned numberOfThreads : { 2, 4, 8 })
+		{
+			Base::WorkStealingThreadPool threadPool(numberOfThreads);
+			std::vector<uint8_t> output(reference.size());
+			scaler.scale(source, Base::getScalerImage(Base::ScalerPixelFormat::BGR24, scaledWidth, scaledHeight, output.data()), true, threadPool);
+			ASSERT_EQ(output, reference) << numberOfThreads << " threads";
+		}
+	}
+}
+
+#include <base/ext/img_codecs/format_detection.h>
+
+TEST(IMAGE_FORMAT_DETECTION, SIGNATURES)
+{
+	const unsigned char jpeg[] = { 0xFF, 0xD8, 0xFF, 0xE0 };
+	const unsigned char png[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	const char webp[] = "RIFF\x24\0\0\0WEBPVP8 ";
+	const char gif[] = "GIF89a";
+	const unsigned char bmp[] = { 'B', 'M', 0x36, 0, 0, 0, 0, 0, 0, 0 };
+	EXPECT_EQ(Base::detectImageFormat(jpeg, sizeof(jpeg)), Base::ImageFormatType::JPEG);
+	EXPECT_EQ(Base::detectImageFormat(png, sizeof(png)), Base::ImageFormatType::PNG);
+	EXPECT_EQ(Base::detectImageFormat(webp, sizeof(webp) - 1), Base::ImageFormatType::WEBP);
+	EXPECT_EQ(Base::detectImageFormat(gif, sizeof(gif) - 1), Base::ImageFormatType::GIF);
+	EXPECT_EQ(Base::detectImageFormat(bmp, sizeof(bmp)), Base::ImageFormatType::BMP);
+	EXPECT_EQ(Base::detectImageFormat(png, 4), Base::ImageFormatType::UNKNOWN);
+	EXPECT_EQ(Base::detectImageFormat(webp, 8), Base::ImageFormatType::UNKNOWN);
+	EXPECT_EQ(Base::detectImageFormat(nullptr, 0), Base::ImageFormatType::UNKNOWN);
+}
+
+TEST(IMAGE_FORMAT_DETECTION, PROBE)
+{
+	// SOI, APP0 and a progressive frame header of a 32x16 3-component image
+	const unsigned char jpeg[] = { 0xFF, 0xD8, 0xFF, 0xE0, 0x00, 0x04, 0x00, 0x00, 0xFF, 0xFF, 0xC2, 0x00, 0x11, 0x08, 0x00, 0x10, 0x00, 0x20, 0x03 };
+	// IHDR of a 640x480 interlaced palette image followed by a tRNS chunk
+	const unsigned char png[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n', 0, 0, 0, 13, 'I', 'H', 'D', 'R', 0, 0, 2, 128, 0, 0, 1, 224, 8, 3, 0, 0, 1, 0, 0, 0, 0,
+		0, 0, 0, 1, 't', 'R', 'N', 'S', 0, 0, 0, 0, 0 };
+	// lossless 100x50 with alpha
+	const unsigned char webp[] = { 'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'E', 'B', 'P', 'V', 'P', '8', 'L', 0, 0, 0, 0, 0x2F, 99, 0x40, 12, 0x10 };
+	const unsigned char bmp[] = { 'B', 'M', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 40, 0, 0, 0, 7, 0, 0, 0, 0xFB, 0xFF, 0xFF, 0xFF, 1, 0, 24, 0 };
+	const void* buffers[] = { jpeg, png, webp, bmp, jpeg };
+	const size_t sizes[] = { sizeof(jpeg), sizeof(png), sizeof(webp), sizeof(bmp), sizeof(jpeg) - 1 };
+	Base::ImageInfo infos[5];
+	Base::WorkStealingThreadPool threadPool(2);
+	EXPECT_EQ(Base::probeImages(buffers, sizes, 5, infos, &threadPool), 4);
+	EXPECT_TRUE(infos[0].format == Base::ImageFormatType::JPEG && infos[0].width == 32 && infos[0].height == 16 && infos[0].numberOfChannels == 3 && infos[0].isProgressive);
+	EXPECT_TRUE(infos[1].format == Base::ImageFormatType::PNG && infos[1].width == 640 && infos[1].height == 480 && infos[1].numberOfChannels == 4 && infos[1].hasAlpha && infos[1].isProgressive);
+	EXPECT_TRUE(infos[2].format == Base::ImageFormatType::WEBP && infos[2].width == 100 && infos[2].height == 50 && infos[2].hasAlpha);
+	EXPECT_TRUE(infos[3].format == Base::ImageFormatType::BMP && infos[3].width == 7 && infos[3].height == 5 && infos[3].numberOfChannels == 3);
+	// truncated frame header
+	EXPECT_EQ(infos[4].format, Base::ImageFormatType::UNKNOWN);
+}
@@ -0,0 +1,453 @@
+#include "pch.h"
+
+#include <base/logging.h>
+#include <base/exception.h>
+#include <base/logging/sinks/binary.h>
+#include <base/logging/sinks/file.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	class CaptureSink : public Base::Logging::Sink
+	{
+	public:
+		std::string_view getName() override { return "capture"; }
+		void write(std::string_view message) override
+		{
+			if (message != "\n")
+				lastMessage.assign(message.data(), message.size());
+		}
+		void flush() override {}
+		std::string lastMessage;
+	};
+
+	class RecordCaptureSink : public CaptureSink
+	{
+	public:
+		bool acceptsRecords() override { return true; }
+		void writeRecord(const Base::Logging::Details::LoggingRecord& record) override
+		{
+			lastMessage.clear();
+			Base::Logging::Details::formatLoggingRecord(record, lastMessage);
+			++numberOfRecords;
+		}
+		int numberOfRecords = 0;
+	};
+
+	// counts how often it is written to a stream
+	struct FormatCounter
+	{
+		int* calls;
+	};
+
+	std::ostream& operator<<(std::ostream& stream, const FormatCounter& counter)
+	{
+		++*counter.calls;
+		return stream << "counted";
+	}
+
+	std::string getPayload(int index);
+
+	// collects the lines "producer <p> message <i> <payload>" of logMessage, from batches and single messages
+	class ProducerLineSink : public Base::Logging::Sink
+	{
+	public:
+		ProducerLineSink(size_t numberOfProducers, std::chrono::microseconds writeDelay = std::chrono::microseconds(0))
+			: messages(numberOfProducers), _writeDelay(writeDelay) {}
+		std::string_view getName() override { return "producer lines"; }
+		void write(std::string_view message) override
+		{
+			if (_writeDelay.count())
+				std::this_thread::sleep_for(_writeDelay);
+			std::lock_guard<std::mutex> lockGuard(_mutex);
+			while (!message.empty())
+			{
+				const size_t end = std::min(message.find('\n'), message.size());
+				parseLine(message.substr(0, end));
+				message.remove_prefix(std::min(end + 1, message.size()));
+			}
+		}
+		void flush() override {}
+		// the indices received from each producer, in order
+		std::vector<std::vector<int>> messages;
+		int numberOfCorruptLines = 0;
+		int numberOfFatalLines = 0;
+	private:
+		void parseLine(std::string_view line)
+		{
+			if (line.find("fatal error marker") != std::string_view::npos)
+				++numberOfFatalLines;
+			const size_t position = line.find("producer ");
+			if (position == std::string_view::npos)
+				return;
+			int producer, index, length;
+			if (sscanf(std::string(line.substr(position)).c_str(), "producer %d message %d %n", &producer, &index, &length) != 2 ||
+				producer < 0 || producer >= int(messages.size()) || line.substr(position + length) != getPayload(index))
+			{
+				++numberOfCorruptLines;
+				return;
+			}
+			messages[producer].push_back(index);
+		}
+
+		std::mutex _mutex;
+		std::chrono::microseconds _writeDelay;
+	};
+
+	// of varying length, so that the records wrap around the ring buffers at different offsets
+	std::string getPayload(int index)
+	{
+		return std::string(index % 173, char('a' + index % 26));
+	}
+
+	void logMessage(int producer, int index)
+	{
+		L_LOG_ERROR << "producer " << producer << " message " << index << ' ' << getPayload(index);
+	}
+
+	void logMessages(size_t numberOfProducers, size_t numberOfMessages)
+	{
+		std::vector<std::thread> producers;
+		for (size_t producer = 0; producer < numberOfProducers; ++producer)
+			producers.emplace_back([producer, numberOfMessages]()
+			{
+				for (size_t index = 0; index < numberOfMessages; ++index)
+					logMessage(int(producer), int(index));
+			});
+		for (auto& thread : producers)
+			thread.join();
+	}
+
+	bool isInOrder(const std::vector<int>& indices)
+	{
+		return std::adjacent_find(indices.begin(), indices.end(), [](int left, int right) { return left >= right; }) == indices.end();
+	}
+}
+
+TEST(LOGGING, FORMAT)
+{
+	auto* sink = new CaptureSink;
+	int handle = Base::Logging::addSink(sink);
+
+	L_LOG_ERROR << "value " << 42 << ' ' << -7LL << ' ' << 1.5 << ' ' << true << ' ' << std::string("str");
+	std::string_view message = sink->lastMessage;
+	EXPECT_EQ(message.substr(0, 18), "[test_logging.cpp:");
+	EXPECT_EQ(message.substr(message.find("] ") + 2), "value 42 -7 1.5 1 str");
+
+	L_LOG_ERROR << std::hex << 255 << ' ' << std::setw(4) << std::setfill('0') << 7;
+	message = sink->lastMessage;
+	EXPECT_EQ(message.substr(message.find("] ") + 2), "ff 0007");
+
+	// formatting state does not leak into the next message
+	L_LOG_ERROR << 255;
+	message = sink->lastMessage;
+	EXPECT_EQ(message.substr(message.find("] ") + 2), "255");
+
+	int left = 1, right = 2;
+	L_LOG_IF_NOT_EQ(left, right) << "tail";
+	message = sink->lastMessage;
+	EXPECT_EQ(message.substr(message.find("] ") + 2), "Check failed: left == right (1 vs. 2) tail");
+
+	Base::Logging::removeSink(handle);
+}
+
+TEST(LOGGING, RECORD)
+{
+	auto* sink = new RecordCaptureSink;
+	int handle = Base::Logging::addSink(sink);
+
+	L_LOG_ERROR << "value " << 42 << ' ' << -7LL << ' ' << 1.5 << ' ' << true << ' ' << std::string("str");
+	std::string_view message = sink->lastMessage;
+	EXPECT_EQ(message.substr(0, 18), "[test_logging.cpp:");
+	EXPECT_EQ(message.substr(message.find("] ") + 2), "value 42 -7 1.5 1 str");
+
+	L_LOG_ERROR << std::hex << 255 << ' ' << std::setw(4) << std::setfill('0') << 7;
+	message = sink->lastMessage;
+	EXPECT_EQ(message.substr(message.find("] ") + 2), "ff 0007");
+
+	int left = 1, right = 2;
+	L_LOG_IF_NOT_EQ(left, right) << "tail";
+	message = sink->lastMessage;
+	EXPECT_EQ(message.substr(message.find("] ") + 2), "Check failed: left == right (1 vs. 2) tail");
+	EXPECT_EQ(sink->numberOfRecords, 3);
+
+	// a text sink turns the formatting back on
+	auto* textSink = new CaptureSink;
+	int textHandle = Base::Logging::addSink(textSink);
+	L_LOG_ERROR << "text";
+	EXPECT_EQ(sink->numberOfRecords, 3);
+	EXPECT_EQ(sink->lastMessage, textSink->lastMessage);
+	Base::Logging::removeSink(textHandle);
+
+	Base::Logging::removeSink(handle);
+}
+
+TEST(LOGGING, LEVEL)
+{
+	auto* sink = new CaptureSink;
+	int handle = Base::Logging::addSink(sink);
+
+	L_LOG_DEBUG << "debug";
+	EXPECT_TRUE(sink->lastMessage.empty());
+	L_LOG_WARNING << "warning";
+	EXPECT_NE(sink->lastMessage.find("warning"), std::string::npos);
+
+	Base::Logging::setModuleLoggingLevel(LOGGING_MODULE_NAME, Base::Logging::Level::LEVEL_DEBUG);
+	L_LOG_DEBUG << "debug";
+	EXPECT_NE(sink->lastMessage.find("debug"), std::string::npos);
+
+	// the condition keeps its side effects when the message is filtered
+	Base::Logging::setModuleLoggingLevel(LOGGING_MODULE_NAME, Base::Logging::Level::LEVEL_OFF);
+	sink->lastMessage.clear();
+	int calls = 0;
+	auto call = [&calls]() { return ++calls; };
+	L_LOG_IF_FAILED(call() == 0) << "filtered";
+	L_LOG_IF_NOT_EQ(call(), 0) << "filtered";
+	L_LOG_ERROR << "filtered";
+	EXPECT_EQ(calls, 2);
+	EXPECT_TRUE(sink->lastMessage.empty());
+
+	Base::Logging::resetModuleLoggingLevel(LOGGING_MODULE_NAME);
+	EXPECT_EQ(Base::Logging::getModuleLoggingLevel(LOGGING_MODULE_NAME), Base::Logging::getLoggingLevel());
+	Base::Logging::removeSink(handle);
+}
+
+TEST(LOGGING, FILTERED)
+{
+	auto* sink = new CaptureSink;
+	int handle = Base::Logging::addSink(sink);
+
+	// arguments of messages below the logging level are never formatted
+	int calls = 0;
+	L_LOG_DEBUG << "filtered " << FormatCounter{ &calls } << ' ' << 1.5;
+	EXPECT_EQ(calls, 0);
+	EXPECT_TRUE(sink->lastMessage.empty());
+
+	L_LOG_ERROR << "written " << FormatCounter{ &calls } << ' ' << 1.5;
+	EXPECT_EQ(calls, 1);
+	std::string_view message = sink->lastMessage;
+	EXPECT_EQ(message.substr(message.find("] ") + 2), "written counted 1.5");
+
+	Base::Logging::removeSink(handle);
+}
+
+TEST(LOGGING, ASYNC_WRAP_AROUND)
+{
+	auto* sink = new ProducerLineSink(1);
+	int handle = Base::Logging::addSink(sink);
+	const auto before = Base::Logging::getAsyncLoggingStatistics();
+	Base::Logging::AsyncLoggingOptions options;
+	// the smallest ring, records of up to 250 bytes wrap around every few messages
+	options.threadBufferSize = 1024;
+	options.flushIntervalMilliseconds = 1;
+	Base::Logging::enableAsyncLogging(options);
+	const size_t numberOfMessages = 20000;
+	logMessages(1, numberOfMessages);
+	Base::Logging::disableAsyncLogging();
+
+	EXPECT_EQ(Base::Logging::getAsyncLoggingStatistics().enqueued - before.enqueued, numberOfMessages);
+	EXPECT_EQ(sink->numberOfCorruptLines, 0);
+	ASSERT_EQ(sink->messages[0].size(), numberOfMessages);
+	for (size_t index = 0; index < numberOfMessages; ++index)
+		ASSERT_EQ(sink->messages[0][index], int(index));
+	Base::Logging::removeSink(handle);
+}
+
+TEST(LOGGING, ASYNC_OVERFLOW_POLICIES)
+{
+	const size_t numberOfProducers = 4, numberOfMessages = 2000;
+	for (auto policy : { Base::Logging::AsyncOverflowPolicy::BLOCK, Base::Logging::AsyncOverflowPolicy::DROP_NEWEST, Base::Logging::AsyncOverflowPolicy::DROP_OLDEST })
+	{
+		// a slow sink and small batches make the producers overflow their rings
+		auto* sink = new ProducerLineSink(numberOfProducers, std::chrono::microseconds(20));
+		int handle = Base::Logging::addSink(sink);
+		const auto before = Base::Logging::getAsyncLoggingStatistics();
+		Base::Logging::AsyncLoggingOptions options;
+		options.threadBufferSize = 1024;
+		options.overflowPolicy = policy;
+		options.flushIntervalMilliseconds = 1;
+		options.maxBatchSize = 256;
+		Base::Logging::enableAsyncLogging(options);
+		logMessages(numberOfProducers, numberOfMessages);
+		Base::Logging::disableAsyncLogging();
+		const auto after = Base::Logging::getAsyncLoggingStatistics();
+		const uint64_t enqueued = after.enqueued - before.enqueued;
+		const uint64_t droppedNewest = after.droppedNewest - before.droppedNewest;
+		const uint64_t droppedOldest = after.droppedOldest - before.droppedOldest;
+
+		// records overwritten while the background thread copies them are discarded, never passed on torn
+		EXPECT_EQ(sink->numberOfCorruptLines, 0);
+		size_t received = 0;
+		for (auto& indices : sink->messages)
+		{
+			EXPECT_TRUE(isInOrder(indices));
+			received += indices.size();
+		}
+		switch (policy)
+		{
+		case Base::Logging::AsyncOverflowPolicy::BLOCK:
+			EXPECT_GT(after.blocked - before.blocked, 0u);
+			EXPECT_EQ(received, numberOfProducers * numberOfMessages);
+			break;
+		case Base::Logging::AsyncOverflowPolicy::DROP_NEWEST:
+			EXPECT_GT(droppedNewest, 0u);
+			EXPECT_EQ(droppedOldest, 0u);
+			EXPECT_EQ(enqueued + droppedNewest, numberOfProducers * numberOfMessages);
+			EXPECT_EQ(received, enqueued);
+			break;
+		case Base::Logging::AsyncOverflowPolicy::DROP_OLDEST:
+			EXPECT_GT(droppedOldest, 0u);
+			EXPECT_EQ(enqueued + droppedNewest, numberOfProducers * numberOfMessages);
+			EXPECT_EQ(received, enqueued - droppedOldest);
+			// the newest messages are kept
+			for (auto& indices : sink->messages)
+				EXPECT_EQ(indices.back(), int(numberOfMessages) - 1);
+			break;
+		}
+		Base::Logging::removeSink(handle);
+	}
+}
+
+TEST(LOGGING, ASYNC_FLUSH_ON_FATAL_ERROR)
+{
+	auto* sink = new ProducerLineSink(1);
+	int handle = Base::Logging::addSink(sink);
+	Base::Logging::AsyncLoggingOptions options;
+	// the background thread does not wake up on its own during the test
+	options.flushIntervalMilliseconds = 60000;
+	Base::Logging::enableAsyncLogging(options);
+	const size_t numberOfMessages = 100;
+	logMessages(1, numberOfMessages);
+	bool isThrown = false;
+	try
+	{
+		const bool isFailed = true;
+		L_ENSURE(!isFailed) << "fatal error marker";
+	}
+	catch (const Base::FatalError&)
+	{
+		isThrown = true;
+		// the pending messages and the fatal error reach the sinks before the exception propagates
+		EXPECT_EQ(sink->messages[0].size(), numberOfMessages);
+		EXPECT_EQ(sink->numberOfFatalLines, 1);
+	}
+	EXPECT_TRUE(isThrown);
+	Base::Logging::disableAsyncLogging();
+	Base::Logging::removeSink(handle);
+}
+
+TEST(LOGGING, ASYNC_DISABLE_WHILE_PRODUCING)
+{
+	const size_t numberOfProducers = 4, numberOfMessages = 20000;
+	auto* sink = new ProducerLineSink(numberOfProducers);
+	int handle = Base::Logging::addSink(sink);
+	Base::Logging::AsyncLoggingOptions options;
+	options.threadBufferSize = 4096;
+	options.flushIntervalMilliseconds = 1;
+	Base::Logging::enableAsyncLogging(options);
+	std::thread toggler([&options]()
+	{
+		for (int i = 0; i < 10; ++i)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+			Base::Logging::disableAsyncLogging();
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			Base::Logging::enableAsyncLogging(options);
+		}
+		Base::Logging::disableAsyncLogging();
+	});
+	logMessages(numberOfProducers, numberOfMessages);
+	toggler.join();
+
+	// without a flush, every message arrives exactly once and in order across the switches
+	EXPECT_EQ(sink->numberOfCorruptLines, 0);
+	for (auto& indices : sink->messages)
+	{
+		ASSERT_EQ(indices.size(), numberOfMessages);
+		for (size_t index = 0; index < numberOfMessages; ++index)
+			ASSERT_EQ(indices[index], int(index));
+	}
+	Base::Logging::removeSink(handle);
+}
+
+TEST(LOGGING, FILE_SINK_ROTATION)
+{
+	const std::string path = (std::filesystem::temp_directory_path() / "base_logging_rotation.log").string();
+	Base::Logging::FileSinkOptions options;
+	options.bufferSize = 4096;
+	options.maxFileSize = 64 * 1024;
+	options.maxRotatedFiles = 2;
+	{
+		Base::Logging::FileSink sink(path, options);
+		const std::string line(99, 'x');
+		for (int i = 0; i < 5000; ++i)
+		{
+			sink.write(line);
+			sink.write("\n");
+		}
+	}
+	for (const std::string& file : { path, path + ".1", path + ".2" })
+	{
+		EXPECT_TRUE(std::filesystem::exists(file));
+		// rotation happens at line boundaries only
+		EXPECT_EQ(std::filesystem::file_size(file) % 100, 0u);
+		std::filesystem::remove(file);
+	}
+	EXPECT_FALSE(std::filesystem::exists(path + ".3"));
+}
+
+TEST(LOGGING, BINARY_FILE_SINK_ROUND_TRIP)
+{
+	const std::string path = (std::filesystem::temp_directory_path() / "base_logging_round_trip.log").string();
+	auto readFile = [&path]()
+	{
+		std::ifstream file(path, std::ios::binary);
+		return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	};
+	// the same sites for both sinks, formatting is only skipped while all sinks are binary
+	auto logMessages = [](Base::Logging::Sink* sink)
+	{
+		int handle = Base::Logging::addSink(sink);
+		int left = 1, right = 2;
+		L_LOG_ERROR << "value " << 42 << ' ' << -7LL << ' ' << 1.5 << ' ' << true << ' ' << 'c' << ' ' << std::string("str");
+		L_LOG_ERROR << std::hex << 255 << ' ' << std::setw(4) << std::setfill('0') << 7 << ' ' << static_cast<const void*>(&left);
+		L_LOG_IF_NOT_EQ(left, right) << "tail";
+		L_LOG_IF_FAILED(left == right) << "failed";
+		for (int i = 0; i < 3; ++i)
+			L_LOG_WARNING << "repeated " << i << " of " << 3u << ", ratio " << i / 3.0;
+		Base::Logging::log("plain text");
+		Base::Logging::removeSink(handle);
+	};
+
+	logMessages(new Base::Logging::FileSink(path));
+	std::vector<std::string> lines;
+	std::istringstream text(readFile());
+	for (std::string line; std::getline(text, line);)
+		lines.push_back(line);
+	ASSERT_EQ(lines.size(), 8u);
+
+	logMessages(new Base::Logging::BinaryFileSink(path));
+	const std::string data = readFile();
+	std::filesystem::remove(path);
+	std::vector<std::string> decodedLines;
+	EXPECT_TRUE(Base::Logging::decodeBinaryLog(data, false, [&decodedLines](std::string_view line) { decodedLines.emplace_back(line); }));
+	ASSERT_EQ(decodedLines.size(), lines.size());
+	for (size_t index = 0; index < lines.size(); ++index)
+		EXPECT_EQ(decodedLines[index], lines[index]) << "line " << index;
+
+	// the lines before the damage are still decoded
+	decodedLines.clear();
+	EXPECT_FALSE(Base::Logging::decodeBinaryLog(std::string_view(data).substr(0, data.size() - 1), false, [&decodedLines](std::string_view line) { decodedLines.emplace_back(line); }));
+	EXPECT_EQ(decodedLines.size(), lines.size() - 1);
+}